@@ -16,6 +16,7 @@ typedef struct mc_fhl_struct
 {
     mc_config_t *config;
     GPtrArray *filters;
+    unsigned int id;            /* identifier of rules, for colors cached in file_entry */
 } mc_fhl_t;
 
 /*** global variables defined in .c file *********************************************************/
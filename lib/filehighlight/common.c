@@ -48,6 +48,8 @@ mc_fhl_filter_free (void *data)
     g_free (filter->fgcolor);
     g_free (filter->bgcolor);
     mc_search_free (filter->search_condition);
+    if (filter->extensions != NULL)
+        g_hash_table_destroy (filter->extensions);
     g_free (filter);
 }
 
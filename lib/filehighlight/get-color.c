@@ -245,20 +245,31 @@ mc_fhl_get_color_regexp (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry
 
 /* --------------------------------------------------------------------------------------------- */
 
-/* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
+static int
+mc_fhl_get_color_extension (mc_fhl_filter_t * mc_filter, mc_fhl_t * fhl, file_entry * fe)
+{
+    const char *dot;
+
+    (void) fhl;
+
+    /* extension can contain dots itself, like "tar.gz";
+       the table itself ignores the case if extensions_case is off */
+    for (dot = strchr (fe->fname, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
+        if (g_hash_table_lookup (mc_filter->extensions, dot + 1) != NULL)
+            return mc_filter->color_pair_index;
+
+    return -1;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
-int
-mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
+static int
+mc_fhl_get_color_int (mc_fhl_t * fhl, file_entry * fe)
 {
     guint i;
     mc_fhl_filter_t *mc_filter;
     int ret;
 
-    if (fhl == NULL)
-        return NORMAL_COLOR;
-
     for (i = 0; i < fhl->filters->len; i++)
     {
         mc_filter = (mc_fhl_filter_t *) g_ptr_array_index (fhl->filters, i);
@@ -270,6 +281,10 @@ mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
                 return -ret;
             break;
         case MC_FLHGH_T_EXT:
+            ret = mc_fhl_get_color_extension (mc_filter, fhl, fe);
+            if (ret > 0)
+                return -ret;
+            break;
         case MC_FLHGH_T_FREGEXP:
             ret = mc_fhl_get_color_regexp (mc_filter, fhl, fe);
             if (ret > 0)
@@ -281,3 +296,27 @@ mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Get color of file. The color is cached in file entry until the rules are changed
+ * (see mc_fhl_parse_ini_file()) or the entry is reloaded.
+ */
+
+int
+mc_fhl_get_color (mc_fhl_t * fhl, file_entry * fe)
+{
+    if (fhl == NULL)
+        return NORMAL_COLOR;
+
+    if (fhl->id == 0 || fe->fhl_id != fhl->id)
+    {
+        fe->fhl_color = mc_fhl_get_color_int (fhl, fe);
+        fe->fhl_id = fhl->id;
+    }
+
+    return fe->fhl_color;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -29,7 +29,6 @@
 
 #include "lib/global.h"
 #include "lib/fileloc.h"
-#include "lib/strescape.h"
 #include "lib/skin.h"
 #include "lib/util.h"           /* exist_file() */
 #include "lib/filehighlight.h"
@@ -46,7 +45,36 @@ extern mc_skin_t mc_skin__default;
 
 /*** file scope variables ************************************************************************/
 
+/* identifier of the last parsed rules */
+static unsigned int mc_fhl_last_id = 0;
+
 /*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Case insensitive hash and comparison of extensions. Only ASCII letters are folded:
+ * file names are not always valid UTF-8, and any bytes must be handled safely.
+ */
+
+static guint
+mc_fhl_ext_hash_nocase (gconstpointer key)
+{
+    const unsigned char *p;
+    guint h = 5381;
+
+    for (p = (const unsigned char *) key; *p != '\0'; p++)
+        h = (h << 5) + h + (guint) g_ascii_tolower (*p);
+
+    return h;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mc_fhl_ext_equal_nocase (gconstpointer a, gconstpointer b)
+{
+    return g_ascii_strcasecmp ((const char *) a, (const char *) b) == 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -133,7 +161,6 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
     mc_fhl_filter_t *mc_filter;
     gchar **exts, **exts_orig;
     gsize exts_size;
-    GString *buf;
 
     exts_orig = exts =
         mc_config_get_string_list (fhl->config, group_name, "extensions", &exts_size);
@@ -144,32 +171,24 @@ mc_fhl_parse_get_extensions (mc_fhl_t * fhl, const gchar * group_name)
         return FALSE;
     }
 
-    buf = g_string_sized_new (64);
-    for (exts = exts_orig; *exts != NULL; exts++)
-    {
-        char *esc_ext;
-
-        esc_ext = strutils_regex_escape (*exts);
-        if (buf->len != 0)
-            g_string_append_c (buf, '|');
-        g_string_append (buf, esc_ext);
-        g_free (esc_ext);
-    }
-    g_strfreev (exts_orig);
-
-    g_string_prepend (buf, ".*\\.(");
-    g_string_append (buf, ")$");
-
     mc_filter = g_new0 (mc_fhl_filter_t, 1);
-    mc_filter->type = MC_FLHGH_T_FREGEXP;
-    mc_filter->search_condition = mc_search_new (buf->str, -1);
-    mc_filter->search_condition->is_case_sensitive =
+    mc_filter->type = MC_FLHGH_T_EXT;
+    mc_filter->extensions_case =
         mc_config_get_bool (fhl->config, group_name, "extensions_case", TRUE);
-    mc_filter->search_condition->search_type = MC_SEARCH_T_REGEX;
+
+    /* set of extensions instead of regexp ".*\\.(ext1|ext2|...)$": one lookup
+       for every dot in file name */
+    if (mc_filter->extensions_case)
+        mc_filter->extensions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    else
+        mc_filter->extensions =
+            g_hash_table_new_full (mc_fhl_ext_hash_nocase, mc_fhl_ext_equal_nocase, g_free, NULL);
+    for (exts = exts_orig; *exts != NULL; exts++)
+        g_hash_table_insert (mc_filter->extensions, g_strdup (*exts), GINT_TO_POINTER (1));
+    g_strfreev (exts_orig);
 
     mc_fhl_parse_fill_color_info (mc_filter, fhl, group_name);
     g_ptr_array_add (fhl->filters, (gpointer) mc_filter);
-    g_string_free (buf, TRUE);
     return TRUE;
 }
 
@@ -229,6 +248,11 @@ mc_fhl_parse_ini_file (mc_fhl_t * fhl)
     mc_fhl_array_free (fhl);
     fhl->filters = g_ptr_array_new ();
 
+    /* colors cached with the previous rules are not valid anymore */
+    if (++mc_fhl_last_id == 0)
+        mc_fhl_last_id = 1;
+    fhl->id = mc_fhl_last_id;
+
     orig_group_names = group_names = mc_config_get_groups (fhl->config, NULL);
 
     if (group_names == NULL)
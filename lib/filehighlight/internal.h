@@ -42,6 +42,8 @@ typedef struct mc_fhl_filter_struct
     mc_flhgh_filter_type type;
     mc_search_t *search_condition;
     mc_flhgh_ftype_type file_type;
+    GHashTable *extensions;     /* for MC_FLHGH_T_EXT: set of extensions */
+    gboolean extensions_case;
 
 } mc_fhl_filter_t;
 
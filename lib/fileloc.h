@@ -58,6 +58,10 @@
 #define MC_HOTLIST_FILE         "hotlist"
 #define MC_USERMENU_FILE        "menu"
 #define MC_TREESTORE_FILE       "Tree"
+#define MC_FINDINDEX_DIR        "findindex"
+#define MC_EXTFS_CACHE_DIR      "extfs"
+#define MC_UNDELFS_CACHE_DIR    "undelfs"
+#define MC_FILETYPES_CACHE_FILE "filetypes"
 #define MC_PANELS_FILE          "panels.ini"
 #define MC_FHL_INI_FILE         "filehighlight.ini"
 #define MC_SKINS_SUBDIR         "skins"
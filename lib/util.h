@@ -58,6 +58,9 @@ typedef struct
     char *sort_key;
     /* key used for comparing extensions */
     char *second_sort_key;
+    /* color computed by mc_fhl_get_color() with the rules of this identifier, 0 if none */
+    int fhl_color;
+    unsigned int fhl_id;
 
     /* Flags */
     struct
@@ -83,6 +83,9 @@
 
 #define CALL(x) if (MEDATA->x) MEDATA->x
 
+/* Size of the buffer of network connection reader */
+#define VFS_S_READER_SIZE (64 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 struct dirhandle
@@ -98,6 +101,28 @@ static volatile int total_inodes = 0, total_entries = 0;
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+#ifdef ENABLE_VFS_NET
+/** Refill the empty buffer of reader. Returns the result of read() */
+
+static ssize_t
+vfs_s_reader_fill (vfs_s_reader_t * reader)
+{
+    ssize_t n;
+
+    if (reader->buf == NULL)
+        reader->buf = g_malloc (VFS_S_READER_SIZE);
+
+    reader->pos = reader->len = 0;
+    n = read (reader->fd, reader->buf, VFS_S_READER_SIZE);
+    if (n > 0)
+        reader->len = (size_t) n;
+
+    return n;
+}
+#endif /* ENABLE_VFS_NET */
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 vfs_s_entry_compare (const void *a, const void *b)
 {
@@ -233,6 +258,8 @@ vfs_s_find_entry_tree (struct vfs_class *me, struct vfs_s_inode *root,
         for (pseg = 0; path[pseg] != '\0' && path[pseg] != PATH_SEP; pseg++)
             ;
 
+        vfs_s_index_expand_dir (me, root);
+
         for (iter = root->subdir; iter != NULL; iter = g_list_next (iter))
         {
             ent = (struct vfs_s_entry *) iter->data;
@@ -375,6 +402,10 @@ vfs_s_new_super (struct vfs_class *me)
 
     super = g_new0 (struct vfs_s_super, 1);
     super->me = me;
+#ifdef ENABLE_VFS_NET
+    if ((MEDATA->flags & VFS_S_REMOTE) != 0)
+        super->reader = vfs_s_reader_new (-1);
+#endif
     return super;
 }
 
@@ -397,6 +428,9 @@ vfs_s_free_super (struct vfs_class *me, struct vfs_s_super *super)
         super->root = NULL;
     }
 
+    vfs_s_index_free (super->index);
+    super->index = NULL;
+
 #if 0
     /* FIXME: We currently leak small ammount of memory, sometimes. Fix it if you can. */
     if (super->ino_usage)
@@ -412,6 +446,7 @@ vfs_s_free_super (struct vfs_class *me, struct vfs_s_super *super)
     CALL (free_archive) (me, super);
 #ifdef ENABLE_VFS_NET
     vfs_path_element_free (super->path_element);
+    vfs_s_reader_free (super->reader);
 #endif
     g_free (super->name);
     g_free (super);
@@ -467,6 +502,8 @@ vfs_s_opendir (const vfs_path_t * vpath)
         return NULL;
     }
 
+    vfs_s_index_expand_dir (path_element->class, dir);
+
     dir->st.st_nlink++;
 #if 0
     if (dir->subdir == NULL)    /* This can actually happen if we allow empty directories */
@@ -1456,82 +1493,199 @@ vfs_s_select_on_two (int fd1, int fd2)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Create the buffered reader of the network connection.
+ * All data from this connection should be read through the reader since then.
+ */
+
+vfs_s_reader_t *
+vfs_s_reader_new (int fd)
+{
+    vfs_s_reader_t *reader;
+
+    reader = g_new0 (vfs_s_reader_t, 1);
+    reader->fd = fd;
+
+    return reader;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_s_reader_free (vfs_s_reader_t * reader)
+{
+    if (reader != NULL)
+    {
+        g_free (reader->buf);
+        g_free (reader);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Switch the reader to the new connection. Data buffered from the old one are dropped */
+
+void
+vfs_s_reader_set_fd (vfs_s_reader_t * reader, int fd)
+{
+    reader->fd = fd;
+    reader->pos = reader->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the raw data from the connection. The buffered data are returned first,
+ * otherwise the data are read directly into buf.
+ */
+
+ssize_t
+vfs_s_reader_read (vfs_s_reader_t * reader, void *buf, size_t len)
+{
+    size_t avail;
+
+    avail = reader->len - reader->pos;
+    if (avail == 0)
+        return read (reader->fd, buf, len);
+
+    len = min (len, avail);
+    memcpy (buf, reader->buf + reader->pos, len);
+    reader->pos += len;
+
+    return (ssize_t) len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the line terminated by term. The terminator is not stored.
+ * The rest of too long line is discarded up to '\n'.
+ * Returns 0 if the connection is closed or broken, 1 otherwise.
+ */
+
 int
-vfs_s_get_line (struct vfs_class *me, int sock, char *buf, int buf_len, char term)
+vfs_s_get_line (struct vfs_class *me, vfs_s_reader_t * reader, char *buf, int buf_len, char term)
 {
     FILE *logfile = MEDATA->logfile;
-    int i;
-    char c;
+    size_t got = 0;
+    gboolean overflow = FALSE;
 
-    for (i = 0; i < buf_len - 1; i++, buf++)
+    while (TRUE)
     {
-        if (read (sock, buf, sizeof (char)) <= 0)
+        const char *start, *end;
+        size_t avail, n;
+
+        if (reader->pos == reader->len && vfs_s_reader_fill (reader) <= 0)
+        {
+            if (!overflow)
+                buf[got] = '\0';
             return 0;
-        if (logfile)
+        }
+
+        start = reader->buf + reader->pos;
+        avail = reader->len - reader->pos;
+
+        if (!overflow)
         {
-            size_t ret1;
-            int ret2;
-            ret1 = fwrite (buf, 1, 1, logfile);
-            ret2 = fflush (logfile);
+            avail = min (avail, (size_t) buf_len - 1 - got);
+            end = memchr (start, term, avail);
+            n = (end != NULL) ? (size_t) (end - start) + 1 : avail;
+            memcpy (buf + got, start, n);
+            got += n;
         }
-        if (*buf == term)
+        else
         {
-            *buf = 0;
-            return 1;
+            end = memchr (start, '\n', avail);
+            n = (end != NULL) ? (size_t) (end - start) + 1 : avail;
         }
-    }
 
-    /* Line is too long - terminate buffer and discard the rest of line */
-    *buf = 0;
-    while (read (sock, &c, sizeof (c)) > 0)
-    {
-        if (logfile)
+        reader->pos += n;
+
+        if (logfile != NULL)
         {
             size_t ret1;
             int ret2;
-            ret1 = fwrite (&c, 1, 1, logfile);
+
+            ret1 = fwrite (start, 1, n, logfile);
             ret2 = fflush (logfile);
+            (void) ret1;
+            (void) ret2;
         }
-        if (c == '\n')
+
+        if (end != NULL)
+        {
+            if (!overflow)
+                buf[got - 1] = '\0';
             return 1;
+        }
+
+        if (!overflow && got == (size_t) buf_len - 1)
+        {
+            /* Line is too long - terminate buffer and discard the rest of line */
+            buf[got] = '\0';
+            overflow = TRUE;
+        }
     }
-    return 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the line terminated by '\n'. The terminator is not stored.
+ * Returns 1 if the line is read, EINTR if reading was interrupted by user
+ * and 0 otherwise.
+ */
 
 int
-vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size, int fd)
+vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size,
+                              vfs_s_reader_t * reader)
 {
-    int n;
-    int i;
+    int i = 0;
 
     (void) me;
 
-    tty_enable_interrupt_key ();
-    for (i = 0; i < size - 1; i++)
+    while (i < size - 1)
     {
-        n = read (fd, buffer + i, 1);
-        tty_disable_interrupt_key ();
-        if (n == -1 && errno == EINTR)
-        {
-            buffer[i] = 0;
-            return EINTR;
-        }
-        if (n == 0)
+        const char *start, *end;
+        size_t n;
+
+        if (reader->pos == reader->len)
         {
-            buffer[i] = 0;
-            return 0;
+            ssize_t res;
+
+            tty_enable_interrupt_key ();
+            res = vfs_s_reader_fill (reader);
+            tty_disable_interrupt_key ();
+
+            if (res == -1 && errno == EINTR)
+            {
+                buffer[i] = '\0';
+                return EINTR;
+            }
+            if (res <= 0)
+            {
+                buffer[i] = '\0';
+                return 0;
+            }
         }
-        if (buffer[i] == '\n')
+
+        start = reader->buf + reader->pos;
+        n = min (reader->len - reader->pos, (size_t) (size - 1 - i));
+        end = memchr (start, '\n', n);
+        if (end != NULL)
+            n = (size_t) (end - start) + 1;
+
+        memcpy (buffer + i, start, n);
+        reader->pos += n;
+        i += n;
+
+        if (end != NULL)
         {
-            buffer[i] = 0;
+            buffer[i - 1] = '\0';
             return 1;
         }
     }
-    buffer[size - 1] = 0;
+
+    buffer[size - 1] = '\0';
     return 0;
 }
+
 #endif /* ENABLE_VFS_NET */
 
 /* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,625 @@
+/*
+   Virtual File System: compact index of archive entries.
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \file
+ * \brief Source: Virtual File System: compact index of archive entries
+ *
+ * Archive file systems (tarfs, cpiofs) keep the listing of archive as the flat array of
+ * fixed-size records and the single arena of names instead of the tree of vfs_s_inode and
+ * vfs_s_entry structures. Entries and inodes of the directory are created when the directory
+ * is visited for the first time (see vfs_s_index_expand_dir()).
+ *
+ * Usage: vfs_s_index_init() in open_archive method, then vfs_s_index_add() and
+ * vfs_s_index_add_link() for every member and vfs_s_index_finish() at the end.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+
+#include "vfs.h"
+#include "xdirentry.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* not found or not a directory */
+#define VFS_S_INDEX_NONE ((guint32) (-1))
+
+/* initial number of slots in the lookup table, must be a power of 2 */
+#define VFS_S_INDEX_TABLE_MIN 256
+
+#define VFS_S_INDEX_IS_DEVICE(mode) (S_ISCHR (mode) || S_ISBLK (mode))
+
+/*** file scope type declarations ****************************************************************/
+
+struct vfs_s_index
+{
+    vfs_s_index_record_t *records;      /* the first record is the root directory */
+    guint32 count;
+    guint32 records_size;
+
+    char *names;                /* zero-terminated names and symlink targets */
+    gsize names_len;
+    gsize names_size;
+
+    /* Lookup of records by parent and name, exists while the archive is being read.
+       Slots contain record numbers, 0 is an empty slot */
+    guint32 *table;
+    guint32 table_size;
+
+    /* parent directory of the last added record: archive members are usually
+       grouped by directories */
+    char *last_dir;
+    size_t last_dir_len;
+    guint32 last_dir_num;
+
+    GHashTable *links;          /* created inodes of records with VFS_S_INDEX_LINKED flag */
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static guint
+vfs_s_index_hash (guint32 parent, const char *name, size_t len)
+{
+    guint h;
+    size_t i;
+
+    h = parent * 2654435761U;
+    for (i = 0; i < len; i++)
+        h = (h << 5) + h + (unsigned char) name[i];
+
+    return h;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find the slot of record with given parent and name, or the empty slot for it */
+
+static guint32 *
+vfs_s_index_slot (vfs_s_index_t * index, guint32 parent, const char *name, size_t len)
+{
+    guint32 mask = index->table_size - 1;
+    guint32 i;
+
+    for (i = vfs_s_index_hash (parent, name, len) & mask;; i = (i + 1) & mask)
+    {
+        const vfs_s_index_record_t *rec;
+        const char *rec_name;
+
+        if (index->table[i] == 0)
+            break;
+
+        rec = &index->records[index->table[i]];
+        rec_name = index->names + rec->name;
+        if (rec->parent == parent && strncmp (rec_name, name, len) == 0 && rec_name[len] == '\0')
+            break;
+    }
+
+    return &index->table[i];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_index_grow_table (vfs_s_index_t * index)
+{
+    guint32 num;
+
+    g_free (index->table);
+    index->table_size *= 2;
+    index->table = g_new0 (guint32, index->table_size);
+
+    /* latest of the duplicated records wins, like in tar */
+    for (num = 1; num < index->count; num++)
+    {
+        const vfs_s_index_record_t *rec = &index->records[num];
+
+        *vfs_s_index_slot (index, rec->parent, index->names + rec->name,
+                           strlen (index->names + rec->name)) = num;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Store the string in the arena. Return its offset */
+
+static guint32
+vfs_s_index_add_name (vfs_s_index_t * index, const char *name, size_t len)
+{
+    guint32 offset;
+
+    if (index->names_len + len + 1 > index->names_size)
+    {
+        index->names_size = MAX (index->names_size * 2, index->names_len + len + 1);
+        index->names = g_realloc (index->names, index->names_size);
+    }
+
+    offset = (guint32) index->names_len;
+    memcpy (index->names + offset, name, len);
+    index->names[offset + len] = '\0';
+    index->names_len += len + 1;
+
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_index_set_stat (vfs_s_index_record_t * rec, const struct stat *st)
+{
+    rec->mode = st->st_mode;
+    rec->uid = st->st_uid;
+    rec->gid = st->st_gid;
+    rec->size = st->st_size;
+    rec->mtime = st->st_mtime;
+    rec->atime = st->st_atime;
+    rec->ctime = st->st_ctime;
+    if (VFS_S_INDEX_IS_DEVICE (st->st_mode))
+        rec->offset = st->st_rdev;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add the record to the directory. Entries are prepended to the list of directory
+ * and lists are reversed in vfs_s_index_finish().
+ * Return number of new record.
+ */
+
+static guint32
+vfs_s_index_new_record (vfs_s_index_t * index, guint32 parent, const char *name, size_t len,
+                        const struct stat *st)
+{
+    vfs_s_index_record_t *rec;
+    guint32 num;
+
+    if (index->count == index->records_size)
+    {
+        index->records_size *= 2;
+        index->records = g_renew (vfs_s_index_record_t, index->records, index->records_size);
+    }
+
+    num = index->count++;
+    rec = &index->records[num];
+    memset (rec, 0, sizeof (*rec));
+    rec->name = vfs_s_index_add_name (index, name, len);
+    rec->parent = parent;
+    rec->offset = -1;
+    if (st != NULL)
+        vfs_s_index_set_stat (rec, st);
+
+    rec->next = index->records[parent].first;
+    index->records[parent].first = num;
+
+    if (index->count * 2 > index->table_size)
+        vfs_s_index_grow_table (index);
+    else
+        *vfs_s_index_slot (index, parent, name, len) = num;
+
+    return num;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the directory by path. If make_dirs is TRUE, missing directories are created.
+ * Return VFS_S_INDEX_NONE if the path doesn't lead to directory.
+ */
+
+static guint32
+vfs_s_index_find_dir (struct vfs_class *me, vfs_s_index_t * index, const char *path, size_t len,
+                      gboolean make_dirs)
+{
+    const char *p, *end;
+    guint32 dir = 0;
+
+    if (index->last_dir != NULL && len == index->last_dir_len
+        && strncmp (path, index->last_dir, len) == 0)
+        return index->last_dir_num;
+
+    end = path + len;
+    for (p = path; p < end;)
+    {
+        const char *q;
+
+        for (q = p; q < end && *q != PATH_SEP; q++)
+            ;
+
+        if (q - p == 2 && p[0] == '.' && p[1] == '.')
+            return VFS_S_INDEX_NONE;
+
+        if (q != p && !(q - p == 1 && p[0] == '.'))
+        {
+            guint32 num;
+
+            num = *vfs_s_index_slot (index, dir, p, q - p);
+            if (num == 0)
+            {
+                if (!make_dirs)
+                    return VFS_S_INDEX_NONE;
+                num = vfs_s_index_new_record (index, dir, p, q - p,
+                                              vfs_s_default_stat (me, S_IFDIR | 0777));
+            }
+            else if (!S_ISDIR (index->records[num].mode)
+                     || (index->records[num].flags & VFS_S_INDEX_HARDLINK) != 0)
+                return VFS_S_INDEX_NONE;
+
+            dir = num;
+        }
+
+        p = q + 1;
+    }
+
+    g_free (index->last_dir);
+    index->last_dir = g_strndup (path, len);
+    index->last_dir_len = len;
+    index->last_dir_num = dir;
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split the path to the parent directory and name.
+ * Return FALSE if the name cannot be used in the directory listing.
+ */
+
+static gboolean
+vfs_s_index_split (const char *path, size_t * dir_len, const char **name, size_t * name_len)
+{
+    size_t len;
+    const char *p;
+
+    len = strlen (path);
+    while (len != 0 && path[len - 1] == PATH_SEP)
+        len--;
+
+    for (p = path + len; p > path && p[-1] != PATH_SEP; p--)
+        ;
+
+    *dir_len = p - path;
+    *name = p;
+    *name_len = path + len - p;
+
+    return !(*name_len == 0 || (*name_len == 1 && p[0] == '.')
+             || (*name_len == 2 && p[0] == '.' && p[1] == '.'));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Create new record for path, directories in the path are created if missing */
+
+static guint32
+vfs_s_index_add_path (struct vfs_class *me, vfs_s_index_t * index, const char *path,
+                      const struct stat *st)
+{
+    const char *name;
+    size_t dir_len, name_len;
+    guint32 dir;
+
+    if (!vfs_s_index_split (path, &dir_len, &name, &name_len))
+        return 0;
+
+    dir = vfs_s_index_find_dir (me, index, path, dir_len, TRUE);
+    if (dir == VFS_S_INDEX_NONE)
+        return 0;
+
+    if (st != NULL && S_ISDIR (st->st_mode))
+    {
+        guint32 num;
+
+        /* directory could be created already for its contents */
+        num = *vfs_s_index_slot (index, dir, name, name_len);
+        if (num != 0 && S_ISDIR (index->records[num].mode)
+            && (index->records[num].flags & VFS_S_INDEX_HARDLINK) == 0)
+        {
+            vfs_s_index_set_stat (&index->records[num], st);
+            return num;
+        }
+    }
+
+    return vfs_s_index_new_record (index, dir, name, name_len, st);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static struct vfs_s_inode *
+vfs_s_index_get_inode (struct vfs_class *me, struct vfs_s_super *super, guint32 num)
+{
+    vfs_s_index_t *index = super->index;
+    const vfs_s_index_record_t *rec;
+    struct vfs_s_inode *ino;
+    struct stat st;
+
+    if ((index->records[num].flags & VFS_S_INDEX_HARDLINK) != 0)
+        num = index->records[num].first;
+    rec = &index->records[num];
+
+    if ((rec->flags & VFS_S_INDEX_LINKED) != 0 && index->links != NULL)
+    {
+        ino = (struct vfs_s_inode *) g_hash_table_lookup (index->links, GUINT_TO_POINTER (num));
+        if (ino != NULL)
+            return ino;
+    }
+
+    memset (&st, 0, sizeof (st));
+    st.st_mode = rec->mode;
+    st.st_uid = rec->uid;
+    st.st_gid = rec->gid;
+    st.st_size = rec->size;
+    st.st_mtime = rec->mtime;
+    st.st_atime = rec->atime;
+    st.st_ctime = rec->ctime;
+    if (VFS_S_INDEX_IS_DEVICE (rec->mode))
+        st.st_rdev = rec->offset;
+
+    ino = vfs_s_new_inode (me, super, &st);
+    if (ino == NULL)
+        return NULL;
+
+    ino->data_offset = VFS_S_INDEX_IS_DEVICE (rec->mode) ? -1 : rec->offset;
+    if (rec->linkname != 0)
+        ino->linkname = g_strdup (index->names + rec->linkname);
+    if (S_ISDIR (rec->mode))
+        ino->index_dir = num;
+
+    if ((rec->flags & VFS_S_INDEX_LINKED) != 0)
+    {
+        if (index->links == NULL)
+            index->links = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (index->links, GUINT_TO_POINTER (num), ino);
+    }
+
+    return ino;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+vfs_s_index_fill_dir (struct vfs_class *me, struct vfs_s_inode *dir, guint32 dir_num)
+{
+    vfs_s_index_t *index = dir->super->index;
+    GList *list = NULL;
+    guint32 num;
+
+    for (num = index->records[dir_num].first; num != 0; num = index->records[num].next)
+    {
+        struct vfs_s_inode *ino;
+        struct vfs_s_entry *ent;
+
+        ino = vfs_s_index_get_inode (me, dir->super, num);
+        if (ino == NULL)
+            continue;
+
+        /* like vfs_s_insert_entry(), but without appending to the list one by one */
+        ent = vfs_s_new_entry (me, index->names + index->records[num].name, ino);
+        ent->dir = dir;
+        ino->st.st_nlink++;
+        list = g_list_prepend (list, ent);
+    }
+
+    dir->subdir = g_list_concat (dir->subdir, g_list_reverse (list));
+    dir->index_dir = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Start indexing of archive. super->root should be created already */
+
+void
+vfs_s_index_init (struct vfs_s_super *super)
+{
+    vfs_s_index_t *index;
+
+    index = g_new0 (vfs_s_index_t, 1);
+
+    index->records_size = 64;
+    index->records = g_new (vfs_s_index_record_t, index->records_size);
+    index->names_size = BUF_1K;
+    index->names = g_malloc (index->names_size);
+    index->table_size = VFS_S_INDEX_TABLE_MIN;
+    index->table = g_new0 (guint32, index->table_size);
+
+    /* root directory: its name is also the empty link name at offset 0 */
+    index->count = 1;
+    memset (&index->records[0], 0, sizeof (index->records[0]));
+    index->records[0].name = vfs_s_index_add_name (index, "", 0);
+    index->records[0].mode = S_IFDIR;
+    index->records[0].offset = -1;
+
+    super->index = index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add archive member. Missing parent directories are created with default attributes.
+ * If the directory exists already, its attributes are replaced.
+ *
+ * @param path path of member inside archive
+ * @param linkname symlink target or NULL
+ * @param data_offset position of member data in the archive
+ *
+ * @return number of record, 0 if the member is skipped
+ */
+
+guint32
+vfs_s_index_add (struct vfs_class *me, struct vfs_s_super *super, const char *path,
+                 const struct stat *st, const char *linkname, off_t data_offset)
+{
+    vfs_s_index_t *index = super->index;
+    guint32 num;
+
+    num = vfs_s_index_add_path (me, index, path, st);
+    if (num == 0)
+        return 0;
+
+    if (!VFS_S_INDEX_IS_DEVICE (st->st_mode))
+        index->records[num].offset = data_offset;
+
+    if (linkname != NULL && *linkname != '\0')
+        index->records[num].linkname = vfs_s_index_add_name (index, linkname, strlen (linkname));
+
+    return num;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add hard link to the record added before.
+ *
+ * @return number of record, 0 if the link is skipped
+ */
+
+guint32
+vfs_s_index_add_link (struct vfs_class *me, struct vfs_s_super *super, const char *path,
+                      guint32 target)
+{
+    vfs_s_index_t *index = super->index;
+    guint32 num;
+
+    if (target == 0 || target >= index->count)
+        return 0;
+
+    while ((index->records[target].flags & VFS_S_INDEX_HARDLINK) != 0)
+        target = index->records[target].first;
+
+    num = vfs_s_index_add_path (me, index, path, NULL);
+    if (num == 0 || num == target)
+        return 0;
+
+    index->records[num].flags = VFS_S_INDEX_HARDLINK;
+    index->records[num].first = target;
+    index->records[num].mode = index->records[target].mode;
+    index->records[target].flags |= VFS_S_INDEX_LINKED;
+
+    return num;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find record of archive member by path. The latest of duplicated members is found.
+ * Return 0 if not found.
+ */
+
+guint32
+vfs_s_index_lookup (struct vfs_class *me, struct vfs_s_super *super, const char *path)
+{
+    vfs_s_index_t *index = super->index;
+    const char *name;
+    size_t dir_len, name_len;
+    guint32 dir;
+
+    if (index->table == NULL || !vfs_s_index_split (path, &dir_len, &name, &name_len))
+        return 0;
+
+    dir = vfs_s_index_find_dir (me, index, path, dir_len, FALSE);
+    if (dir == VFS_S_INDEX_NONE)
+        return 0;
+
+    return *vfs_s_index_slot (index, dir, name, name_len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get record to change attributes of member while the archive is being read */
+
+vfs_s_index_record_t *
+vfs_s_index_get (struct vfs_s_super *super, guint32 num)
+{
+    return &super->index->records[num];
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Archive is read: free lookup table, release unused memory and create the root directory */
+
+void
+vfs_s_index_finish (struct vfs_class *me, struct vfs_s_super *super)
+{
+    vfs_s_index_t *index = super->index;
+    guint32 num;
+
+    g_free (index->table);
+    index->table = NULL;
+    g_free (index->last_dir);
+    index->last_dir = NULL;
+
+    index->records_size = index->count;
+    index->records = g_renew (vfs_s_index_record_t, index->records, index->records_size);
+    index->names_size = index->names_len;
+    index->names = g_realloc (index->names, index->names_size);
+
+    /* restore order of members in directories */
+    for (num = 0; num < index->count; num++)
+    {
+        vfs_s_index_record_t *rec = &index->records[num];
+
+        if (S_ISDIR (rec->mode) && (rec->flags & VFS_S_INDEX_HARDLINK) == 0)
+        {
+            guint32 prev = 0, cur = rec->first;
+
+            while (cur != 0)
+            {
+                guint32 next = index->records[cur].next;
+
+                index->records[cur].next = prev;
+                prev = cur;
+                cur = next;
+            }
+            rec->first = prev;
+        }
+    }
+
+    vfs_s_index_fill_dir (me, super->root, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Create entries of directory if they are not created yet */
+
+void
+vfs_s_index_expand_dir (struct vfs_class *me, struct vfs_s_inode *dir)
+{
+    if (dir->index_dir != 0 && dir->super->index != NULL)
+        vfs_s_index_fill_dir (me, dir, dir->index_dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_s_index_free (vfs_s_index_t * index)
+{
+    if (index == NULL)
+        return;
+
+    if (index->links != NULL)
+        g_hash_table_destroy (index->links);
+    g_free (index->last_dir);
+    g_free (index->table);
+    g_free (index->names);
+    g_free (index->records);
+    g_free (index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -65,11 +65,102 @@ struct dirent *mc_readdir_result = NULL;
 
 /*** file scope macro definitions ****************************************************************/
 
+/* number of parsed parent directories kept by mc_path_from_str() */
+#define VPATH_CACHE_SIZE 16
+
 /*** file scope type declarations ****************************************************************/
 
+typedef struct
+{
+    char *str;
+    vfs_path_t *vpath;
+} vpath_cache_entry_t;
+
 /*** file scope variables ************************************************************************/
 
+/* most recently used entry is first */
+static vpath_cache_entry_t vpath_cache[VPATH_CACHE_SIZE];
+static size_t vpath_cache_num = 0;
+
 /*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find parsed directory path in the cache, parse and remember it if not found.
+ * Returned object is owned by the cache.
+ */
+
+static const vfs_path_t *
+vpath_cache_get (const char *dir, size_t len)
+{
+    vpath_cache_entry_t entry;
+    size_t i;
+
+    for (i = 0; i < vpath_cache_num; i++)
+        if (strncmp (vpath_cache[i].str, dir, len) == 0 && vpath_cache[i].str[len] == '\0')
+            break;
+
+    if (i < vpath_cache_num)
+        entry = vpath_cache[i];
+    else
+    {
+        entry.str = g_strndup (dir, len);
+        entry.vpath = vfs_path_from_str (entry.str);
+
+        if (vpath_cache_num < VPATH_CACHE_SIZE)
+            vpath_cache_num++;
+        else
+        {
+            /* forget least recently used entry */
+            g_free (vpath_cache[i - 1].str);
+            vfs_path_free (vpath_cache[i - 1].vpath);
+            i--;
+        }
+    }
+
+    /* move to front */
+    memmove (&vpath_cache[1], &vpath_cache[0], i * sizeof (vpath_cache[0]));
+    vpath_cache[0] = entry;
+
+    return entry.vpath;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Convert path to vfs_path_t object.
+ * The same as vfs_path_from_str(), but entries of current directory and of recently used
+ * directories are created from already parsed path of directory.
+ */
+
+static vfs_path_t *
+mc_path_from_str (const char *path)
+{
+    const char *slash;
+
+    if (path == NULL)
+        return NULL;
+
+    slash = strrchr (path, PATH_SEP);
+
+    if (slash == NULL)
+    {
+        const vfs_path_t *cwd;
+
+        cwd = vfs_get_raw_current_dir ();
+        if (cwd != NULL)
+            return vfs_path_append_new (cwd, path);
+    }
+    else if (path[0] == PATH_SEP && slash > path && slash[1] != '\0' && slash[-1] != PATH_SEP
+             && slash[-1] != ':' && !(slash[-1] == '.' && (slash[-2] == PATH_SEP
+                                                          || (slash[-2] == '.'
+                                                              && slash[-3] == PATH_SEP))))
+    {
+        /* absolute path in the directory which is not ended by "/", "://", "/." or "/.." */
+        return vfs_path_append_new (vpath_cache_get (path, slash - path), slash + 1);
+    }
+
+    return vfs_path_from_str (path);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static char *
@@ -174,6 +265,22 @@ mc_def_ungetlocalcopy (struct vfs_class *vfs, const char *filename,
 
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Forget all parsed paths of directories */
+
+void
+vfs_path_cache_free (void)
+{
+    size_t i;
+
+    for (i = 0; i < vpath_cache_num; i++)
+    {
+        g_free (vpath_cache[i].str);
+        vfs_path_free (vpath_cache[i].vpath);
+    }
+    vpath_cache_num = 0;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 int
@@ -183,7 +290,7 @@ mc_open (const char *filename, int flags, ...)
     vfs_path_t *vpath;
     vfs_path_element_t *path_element;
 
-    vpath = vfs_path_from_str (filename);
+    vpath = mc_path_from_str (filename);
     if (vpath == NULL)
         return -1;
 
@@ -225,7 +332,7 @@ int mc_##name inarg \
     vfs_path_t *vpath; \
     vfs_path_element_t *path_element; \
 \
-    vpath = vfs_path_from_str (path); \
+    vpath = mc_path_from_str (path); \
     if (vpath == NULL) \
         return -1; \
 \
@@ -425,15 +532,12 @@ mc_close (int handle)
 /* --------------------------------------------------------------------------------------------- */
 
 DIR *
-mc_opendir (const char *dirname)
+mc_opendir_vpath (const vfs_path_t * vpath)
 {
     int handle, *handlep;
     void *info;
-    vfs_path_t *vpath;
     vfs_path_element_t *path_element;
 
-    vpath = vfs_path_from_str (dirname);
-
     if (vpath == NULL)
         return NULL;
 
@@ -442,7 +546,6 @@ mc_opendir (const char *dirname)
     if (!vfs_path_element_valid (path_element))
     {
         errno = E_NOTSUPP;
-        vfs_path_free (vpath);
         return NULL;
     }
 
@@ -451,28 +554,44 @@ mc_opendir (const char *dirname)
     if (info == NULL)
     {
         errno = path_element->class->opendir ? vfs_ferrno (path_element->class) : E_NOTSUPP;
-        vfs_path_free (vpath);
         return NULL;
     }
 
+    path_element = vfs_path_element_clone (path_element);
     path_element->dir.info = info;
 
+    if (vfs_path_element_need_cleanup_converter (path_element))
+        str_close_conv (path_element->dir.converter);
+
     path_element->dir.converter =
         (path_element->encoding !=
          NULL) ? str_crt_conv_from (path_element->encoding) : str_cnv_from_term;
     if (path_element->dir.converter == INVALID_CONV)
         path_element->dir.converter = str_cnv_from_term;
 
-    handle = vfs_new_handle (path_element->class, vfs_path_element_clone (path_element));
+    handle = vfs_new_handle (path_element->class, path_element);
 
     handlep = g_new (int, 1);
     *handlep = handle;
-    vfs_path_free (vpath);
     return (DIR *) handlep;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+DIR *
+mc_opendir (const char *dirname)
+{
+    vfs_path_t *vpath;
+    DIR *dirp;
+
+    vpath = mc_path_from_str (dirname);
+    dirp = mc_opendir_vpath (vpath);
+    vfs_path_free (vpath);
+    return dirp;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 struct dirent *
 mc_readdir (DIR * dirp)
 {
@@ -556,13 +675,11 @@ mc_closedir (DIR * dirp)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-mc_stat (const char *filename, struct stat *buf)
+mc_stat_vpath (const vfs_path_t * vpath, struct stat *buf)
 {
     int result = -1;
-    vfs_path_t *vpath;
     vfs_path_element_t *path_element;
 
-    vpath = vfs_path_from_str (filename);
     if (vpath == NULL)
         return -1;
 
@@ -575,6 +692,19 @@ mc_stat (const char *filename, struct stat *buf)
             errno = path_element->class->name ? vfs_ferrno (path_element->class) : E_NOTSUPP;
     }
 
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+mc_stat (const char *filename, struct stat *buf)
+{
+    int result;
+    vfs_path_t *vpath;
+
+    vpath = mc_path_from_str (filename);
+    result = mc_stat_vpath (vpath, buf);
     vfs_path_free (vpath);
     return result;
 }
@@ -582,13 +712,11 @@ mc_stat (const char *filename, struct stat *buf)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-mc_lstat (const char *filename, struct stat *buf)
+mc_lstat_vpath (const vfs_path_t * vpath, struct stat *buf)
 {
     int result = -1;
-    vfs_path_t *vpath;
     vfs_path_element_t *path_element;
 
-    vpath = vfs_path_from_str (filename);
     if (vpath == NULL)
         return -1;
 
@@ -601,6 +729,19 @@ mc_lstat (const char *filename, struct stat *buf)
             errno = path_element->class->name ? vfs_ferrno (path_element->class) : E_NOTSUPP;
     }
 
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+mc_lstat (const char *filename, struct stat *buf)
+{
+    int result;
+    vfs_path_t *vpath;
+
+    vpath = mc_path_from_str (filename);
+    result = mc_lstat_vpath (vpath, buf);
     vfs_path_free (vpath);
     return result;
 }
@@ -53,23 +53,104 @@
 /* Parsing code is used by ftpfs, fish and extfs */
 #define MAXCOLS         30
 
+/* Case-insensitive comparison of MLSx fact name of given length */
+#define MLSX_FACT_IS(fact, len, name) \
+    ((len) == sizeof (name) - 1 && g_ascii_strncasecmp ((fact), (name), (len)) == 0)
+
 /*** file scope type declarations ****************************************************************/
 
+/* Column of the ls output: points into the parsed line, not terminated by NUL */
+typedef struct
+{
+    const char *str;
+    size_t len;
+} vfs_column_t;
+
 /*** file scope variables ************************************************************************/
 
-static char *columns[MAXCOLS];  /* Points to the string in column n */
-static int column_ptr[MAXCOLS]; /* Index from 0 to the starting positions of the columns */
+static vfs_column_t columns[MAXCOLS];
+static int columns_num = 0;
 static size_t vfs_parce_ls_final_num_spaces = 0;
 
+/* Abbreviated names of week days and months, 3 chars each */
+static const char week_names[] = "SunMonTueWedThuFriSat";
+static const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static inline const vfs_column_t *
+get_column (int idx)
+{
+    return (idx >= 0 && idx < columns_num) ? &columns[idx] : NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Copy column to buf as NUL-terminated string, truncate it if necessary */
+
+static const char *
+column_to_str (const vfs_column_t * col, char *buf, size_t size)
+{
+    size_t len;
+
+    len = MIN (col->len, size - 1);
+    memcpy (buf, col->str, len);
+    buf[len] = '\0';
+    return buf;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+column_is (const vfs_column_t * col, const char *str)
+{
+    return (col != NULL && strncmp (col->str, str, col->len) == 0 && str[col->len] == '\0');
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse at most max_digits decimal digits.
+ * Returns pointer to the first unparsed char or NULL if there are no digits.
+ */
+
+static const char *
+parse_digits (const char *p, const char *end, int max_digits, int *value)
+{
+    const char *start = p;
+
+    *value = 0;
+    for (; p < end && max_digits > 0 && *p >= '0' && *p <= '9'; p++, max_digits--)
+        *value = *value * 10 + (*p - '0');
+
+    return p != start ? p : NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Find 3 chars long name in the packed table. Returns index of name or -1 */
+
+static int
+find_name3 (const char *table, size_t table_len, const vfs_column_t * col)
+{
+    size_t i;
+
+    if (col == NULL || col->len != 3)
+        return -1;
+
+    for (i = 0; i < table_len; i += 3)
+        if (table[i] == col->str[0] && table[i + 1] == col->str[1] && table[i + 2] == col->str[2])
+            return (int) (i / 3);
+
+    return -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 is_num (int idx)
 {
-    char *column = columns[idx];
+    const vfs_column_t *col = get_column (idx);
 
-    if (!column || column[0] < '0' || column[0] > '9')
+    if (col == NULL || col->len == 0 || col->str[0] < '0' || col->str[0] > '9')
         return 0;
 
     return 1;
@@ -79,21 +160,18 @@ is_num (int idx)
 /* Return 1 for MM-DD-YY and MM-DD-YYYY */
 
 static int
-is_dos_date (const char *str)
+is_dos_date (const vfs_column_t * col)
 {
-    int len;
-
-    if (!str)
+    if (col == NULL)
         return 0;
 
-    len = strlen (str);
-    if (len != 8 && len != 10)
+    if (col->len != 8 && col->len != 10)
         return 0;
 
-    if (str[2] != str[5])
+    if (col->str[2] != col->str[5])
         return 0;
 
-    if (!strchr ("\\-/", (int) str[2]))
+    if (col->str[2] != '\\' && col->str[2] != '-' && col->str[2] != '/')
         return 0;
 
     return 1;
@@ -102,43 +180,33 @@ is_dos_date (const char *str)
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-is_week (const char *str, struct tm *tim)
+is_week (const vfs_column_t * col, struct tm *tim)
 {
-    static const char *week = "SunMonTueWedThuFriSat";
-    const char *pos;
+    int wday;
 
-    if (!str)
+    wday = find_name3 (week_names, sizeof (week_names) - 1, col);
+    if (wday < 0)
         return 0;
 
-    pos = strstr (week, str);
-    if (pos != NULL)
-    {
-        if (tim != NULL)
-            tim->tm_wday = (pos - week) / 3;
-        return 1;
-    }
-    return 0;
+    if (tim != NULL)
+        tim->tm_wday = wday;
+    return 1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-is_month (const char *str, struct tm *tim)
+is_month (const vfs_column_t * col, struct tm *tim)
 {
-    static const char *month = "JanFebMarAprMayJunJulAugSepOctNovDec";
-    const char *pos;
+    int mon;
 
-    if (!str)
+    mon = find_name3 (month_names, sizeof (month_names) - 1, col);
+    if (mon < 0)
         return 0;
 
-    pos = strstr (month, str);
-    if (pos != NULL)
-    {
-        if (tim != NULL)
-            tim->tm_mon = (pos - month) / 3;
-        return 1;
-    }
-    return 0;
+    if (tim != NULL)
+        tim->tm_mon = mon;
+    return 1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -150,49 +218,53 @@ is_month (const char *str, struct tm *tim)
  * NB: It is assumed there are no whitespaces in month.
  */
 static int
-is_localized_month (const char *month)
+is_localized_month (const vfs_column_t * col)
 {
-    int i = 0;
+    int i;
 
-    if (!month)
+    if (col == NULL || col->len != 3)
         return 0;
 
-    while ((i < 3) && *month && !isdigit ((unsigned char) *month)
-           && !iscntrl ((unsigned char) *month) && !ispunct ((unsigned char) *month))
+    for (i = 0; i < 3; i++)
     {
-        i++;
-        month++;
+        unsigned char c = (unsigned char) col->str[i];
+
+        if (isdigit (c) || iscntrl (c) || ispunct (c))
+            return 0;
     }
-    return ((i == 3) && (*month == 0));
+
+    return 1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-is_time (const char *str, struct tm *tim)
+is_time (const vfs_column_t * col, struct tm *tim)
 {
-    const char *p, *p2;
+    const char *p, *end;
+    const char *colon;
+
+    if (col == NULL)
+        return 0;
+
+    end = col->str + col->len;
+    colon = memchr (col->str, ':', col->len);
+    if (colon == NULL)
+        return 0;
 
-    if (str == NULL)
+    p = parse_digits (col->str, end, 2, &tim->tm_hour);
+    if (p == NULL || *p != ':')
+        return 0;
+    p = parse_digits (p + 1, end, 2, &tim->tm_min);
+    if (p == NULL)
         return 0;
 
-    p = strchr (str, ':');
-    p2 = strrchr (str, ':');
-    if (p != NULL && p2 != NULL)
+    /* seconds are expected if there is more than one colon */
+    if (memchr (colon + 1, ':', end - colon - 1) != NULL)
     {
-        if (p != p2)
-        {
-            if (sscanf (str, "%2d:%2d:%2d", &tim->tm_hour, &tim->tm_min, &tim->tm_sec) != 3)
-                return 0;
-        }
-        else
-        {
-            if (sscanf (str, "%2d:%2d", &tim->tm_hour, &tim->tm_min) != 2)
-                return 0;
-        }
+        if (p >= end || *p != ':' || parse_digits (p + 1, end, 2, &tim->tm_sec) == NULL)
+            return 0;
     }
-    else
-        return 0;
 
     return 1;
 }
@@ -200,30 +272,152 @@ is_time (const char *str, struct tm *tim)
 /* --------------------------------------------------------------------------------------------- */
 
 static int
-is_year (char *str, struct tm *tim)
+is_year (const vfs_column_t * col, struct tm *tim)
 {
-    long year;
-
-    if (!str)
-        return 0;
-
-    if (strchr (str, ':'))
-        return 0;
+    int year;
 
-    if (strlen (str) != 4)
+    if (col == NULL || col->len != 4)
         return 0;
 
-    if (sscanf (str, "%ld", &year) != 1)
+    if (parse_digits (col->str, col->str + 4, 4, &year) != col->str + 4)
         return 0;
 
     if (year < 1900 || year > 3000)
         return 0;
 
-    tim->tm_year = (int) (year - 1900);
+    tim->tm_year = year - 1900;
 
     return 1;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Split line to columns without copying it */
+
+static int
+vfs_split_columns (const char *p)
+{
+    int numcols;
+
+    for (numcols = 0; *p != '\0' && numcols < MAXCOLS; numcols++)
+    {
+        while (*p == ' ' || *p == '\r' || *p == '\n')
+            p++;
+        columns[numcols].str = p;
+        while (*p != '\0' && *p != ' ' && *p != '\r' && *p != '\n')
+            p++;
+        columns[numcols].len = p - columns[numcols].str;
+    }
+
+    columns_num = numcols;
+    return numcols;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * mktime() is expensive since it has to look up the time zone rules. All files of one
+ * directory are usually modified within few hours, so cache the start of the last hour.
+ */
+
+static time_t
+vfs_mktime (struct tm *tim)
+{
+    static struct tm last_tm;
+    static time_t last_time = (time_t) (-1);
+    struct tm hour_tm;
+
+    if (last_time == (time_t) (-1) || tim->tm_year != last_tm.tm_year
+        || tim->tm_mon != last_tm.tm_mon || tim->tm_mday != last_tm.tm_mday
+        || tim->tm_hour != last_tm.tm_hour)
+    {
+        hour_tm = *tim;
+        hour_tm.tm_min = 0;
+        hour_tm.tm_sec = 0;
+        hour_tm.tm_isdst = -1;
+        last_time = mktime (&hour_tm);
+        if (last_time == (time_t) (-1))
+            return last_time;
+        last_tm = *tim;
+    }
+
+    return last_time + tim->tm_min * 60 + tim->tm_sec;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Length of the line terminator (at most 2 chars) at the end of name */
+
+static size_t
+vfs_ls_eol_len (const char *name, const char *end)
+{
+    size_t n = 0;
+
+    /* the first char of name is never stripped */
+    while (n < 2 && end - n - 1 > name && (end[-n - 1] == '\r' || end[-n - 1] == '\n'))
+        n++;
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Convert MLSx time value (YYYYMMDDHHMMSS[.sss], UTC) to time_t */
+
+static gboolean
+vfs_parse_mlsx_time (const char *s, time_t * t)
+{
+    int year, mon, mday, hour, min, sec;
+    long days;
+
+    if (sscanf (s, "%4d%2d%2d%2d%2d%2d", &year, &mon, &mday, &hour, &min, &sec) != 6
+        || mon < 1 || mon > 12)
+        return FALSE;
+
+    /* days since 1970-01-01: count years from March to put the leap day to the end */
+    if (mon <= 2)
+    {
+        year--;
+        mon += 12;
+    }
+    days = 365L * year + year / 4 - year / 100 + year / 400
+        + (153 * (mon - 3) + 2) / 5 + mday - 719469;
+
+    *t = (time_t) days * 86400 + hour * 3600 + min * 60 + sec;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Convert MLSx "perm" fact to the permissions of owner */
+
+static mode_t
+vfs_parse_mlsx_perm (const char *s, size_t len, gboolean is_dir)
+{
+    mode_t perms = 0;
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        switch (g_ascii_tolower (s[i]))
+        {
+        case 'r':
+        case 'l':
+            perms |= S_IRUSR;
+            break;
+        case 'w':
+        case 'a':
+        case 'c':
+        case 'm':
+            perms |= S_IWUSR;
+            break;
+        case 'e':
+            perms |= S_IXUSR;
+            break;
+        default:
+            break;
+        }
+
+    if (!is_dir)
+        perms &= ~S_IXUSR;
+
+    return perms;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -517,38 +711,43 @@ vfs_parse_raw_filemode (const char *s, size_t * ret_skipped, mode_t * ret_mode)
 int
 vfs_parse_filedate (int idx, time_t * t)
 {
-    char *p;
+    const vfs_column_t *col;
     struct tm tim;
     int d[3];
     int got_year = 0;
     int l10n = 0;               /* Locale's abbreviated month name */
-    time_t current_time;
-    struct tm *local_time;
+    static time_t current_time = 0;
+    static struct tm local_time;
+    time_t now;
 
-    /* Let's setup default time values */
-    current_time = time (NULL);
-    local_time = localtime (&current_time);
-    tim.tm_mday = local_time->tm_mday;
-    tim.tm_mon = local_time->tm_mon;
-    tim.tm_year = local_time->tm_year;
+    /* Let's setup default time values: localtime() is expensive, call it once per second */
+    now = time (NULL);
+    if (now != current_time)
+    {
+        current_time = now;
+        local_time = *localtime (&current_time);
+    }
+    tim.tm_mday = local_time.tm_mday;
+    tim.tm_mon = local_time.tm_mon;
+    tim.tm_year = local_time.tm_year;
 
     tim.tm_hour = 0;
     tim.tm_min = 0;
     tim.tm_sec = 0;
     tim.tm_isdst = -1;          /* Let mktime() try to guess correct dst offset */
 
-    p = columns[idx++];
+    col = get_column (idx++);
 
     /* We eat weekday name in case of extfs */
-    if (is_week (p, &tim))
-        p = columns[idx++];
+    if (is_week (col, &tim))
+        col = get_column (idx++);
 
     /* Month name */
-    if (is_month (p, &tim))
+    if (is_month (col, &tim))
     {
         /* And we expect, it followed by day number */
         if (is_num (idx))
-            tim.tm_mday = (int) atol (columns[idx++]);
+            tim.tm_mday = (int) atol (columns[idx++].str);
         else
             return 0;           /* No day */
 
@@ -566,11 +765,13 @@ vfs_parse_filedate (int idx, time_t * t)
            YYYY four digit year, hh, mm, ss two digit hour, minute or second. */
 
         /* Special case with MM-DD-YY or MM-DD-YYYY */
-        if (is_dos_date (p))
+        if (is_dos_date (col))
         {
-            p[2] = p[5] = '-';
+            const char *end = col->str + col->len;
 
-            if (sscanf (p, "%2d-%2d-%d", &d[0], &d[1], &d[2]) == 3)
+            if (parse_digits (col->str, end, 2, &d[0]) == col->str + 2
+                && parse_digits (col->str + 3, end, 2, &d[1]) == col->str + 5
+                && parse_digits (col->str + 6, end, 4, &d[2]) != NULL)
             {
                 /* Months are zero based */
                 if (d[0] > 0)
@@ -593,12 +794,12 @@ vfs_parse_filedate (int idx, time_t * t)
                 got_year = 1;
             }
             else
-                return 0;       /* sscanf failed */
+                return 0;       /* wrong digits */
         }
         else
         {
             /* Locale's abbreviated month name followed by day number */
-            if (is_localized_month (p) && (is_num (idx++)))
+            if (is_localized_month (col) && (is_num (idx++)))
                 l10n = 1;
             else
                 return 0;       /* unsupported format */
@@ -606,7 +807,8 @@ vfs_parse_filedate (int idx, time_t * t)
     }
 
     /* Here we expect to find time or year */
-    if (is_num (idx) && (is_time (columns[idx], &tim) || (got_year = is_year (columns[idx], &tim))))
+    col = get_column (idx);
+    if (is_num (idx) && (is_time (col, &tim) || (got_year = is_year (col, &tim))))
         idx++;
     else
         return 0;               /* Neither time nor date */
@@ -617,12 +819,12 @@ vfs_parse_filedate (int idx, time_t * t)
      * This does not check for years before 1900 ... I don't know, how
      * to represent them at all
      */
-    if (!got_year && local_time->tm_mon < 6
-        && local_time->tm_mon < tim.tm_mon && tim.tm_mon - local_time->tm_mon >= 6)
+    if (!got_year && local_time.tm_mon < 6
+        && local_time.tm_mon < tim.tm_mon && tim.tm_mon - local_time.tm_mon >= 6)
 
         tim.tm_year--;
 
-    *t = mktime (&tim);
+    *t = vfs_mktime (&tim);
     if (l10n || (*t < 0))
         *t = 0;
     return idx;
@@ -633,24 +835,7 @@ vfs_parse_filedate (int idx, time_t * t)
 int
 vfs_split_text (char *p)
 {
-    char *original = p;
-    int numcols;
-
-    memset (columns, 0, sizeof (columns));
-
-    for (numcols = 0; *p && numcols < MAXCOLS; numcols++)
-    {
-        while (*p == ' ' || *p == '\r' || *p == '\n')
-        {
-            *p = 0;
-            p++;
-        }
-        columns[numcols] = p;
-        column_ptr[numcols] = p - original;
-        while (*p && *p != ' ' && *p != '\r' && *p != '\n')
-            p++;
-    }
-    return numcols;
+    return vfs_split_columns (p);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -670,6 +855,10 @@ vfs_parse_ls_lga_get_final_spaces (void)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse the line of `ls -l' output. The line is split to columns in place,
+ * only file name and link name are allocated.
+ */
 
 gboolean
 vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkname,
@@ -677,9 +866,9 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
 {
     int idx, idx2, num_cols;
     int i;
-    char *p_copy = NULL;
-    char *t = NULL;
     const char *line = p;
+    const char *name, *name_end;
+    char id[BUF_SMALL];
     size_t skipped;
 
     if (strncmp (p, "total", 5) == 0)
@@ -713,23 +902,28 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
         s->st_mode |= perms;
     }
 
-    p_copy = g_strdup (p);
-    num_cols = vfs_split_text (p_copy);
+    num_cols = vfs_split_columns (p);
+    if (num_cols < 2)
+        goto error;
 
-    s->st_nlink = atol (columns[0]);
+    s->st_nlink = atol (columns[0].str);
     if (s->st_nlink <= 0)
         goto error;
 
     if (!is_num (1))
-        s->st_uid = vfs_finduid (columns[1]);
+        s->st_uid = vfs_finduid (column_to_str (&columns[1], id, sizeof (id)));
     else
-        s->st_uid = (uid_t) atol (columns[1]);
+        s->st_uid = (uid_t) atol (columns[1].str);
 
     /* Mhm, the ls -lg did not produce a group field */
     for (idx = 3; idx <= 5; idx++)
-        if (is_month (columns[idx], NULL) || is_week (columns[idx], NULL)
-            || is_dos_date (columns[idx]) || is_localized_month (columns[idx]))
+    {
+        const vfs_column_t *col = get_column (idx);
+
+        if (is_month (col, NULL) || is_week (col, NULL) || is_dos_date (col)
+            || is_localized_month (col))
             break;
+    }
 
     if (idx == 6 || (idx == 5 && !S_ISCHR (s->st_mode) && !S_ISBLK (s->st_mode)))
         goto error;
@@ -741,9 +935,9 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
     {
         /* We have gid field */
         if (is_num (2))
-            s->st_gid = (gid_t) atol (columns[2]);
+            s->st_gid = (gid_t) atol (columns[2].str);
         else
-            s->st_gid = vfs_findgid (columns[2]);
+            s->st_gid = vfs_findgid (column_to_str (&columns[2], id, sizeof (id)));
         idx2 = 3;
     }
 
@@ -755,15 +949,19 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
         /* Corner case: there is no whitespace(s) between maj & min */
         if (!is_num (idx2) && idx2 == 2)
         {
-            if (!is_num (++idx2) || sscanf (columns[idx2], " %d,%d", &maj, &min) != 2)
+            if (!is_num (++idx2)
+                || sscanf (column_to_str (&columns[idx2], id, sizeof (id)), " %d,%d", &maj,
+                           &min) != 2)
                 goto error;
         }
         else
         {
-            if (!is_num (idx2) || sscanf (columns[idx2], " %d,", &maj) != 1)
+            if (!is_num (idx2)
+                || sscanf (column_to_str (&columns[idx2], id, sizeof (id)), " %d,", &maj) != 1)
                 goto error;
 
-            if (!is_num (++idx2) || sscanf (columns[idx2], " %d", &min) != 1)
+            if (!is_num (++idx2)
+                || sscanf (column_to_str (&columns[idx2], id, sizeof (id)), " %d", &min) != 1)
                 goto error;
         }
 #ifdef HAVE_STRUCT_STAT_ST_RDEV
@@ -779,9 +977,9 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
             goto error;
 
 #ifdef HAVE_ATOLL
-        s->st_size = (off_t) atoll (columns[idx2]);
+        s->st_size = (off_t) atoll (columns[idx2].str);
 #else
-        s->st_size = (off_t) atof (columns[idx2]);
+        s->st_size = (off_t) atof (columns[idx2].str);
 #endif
 #ifdef HAVE_STRUCT_STAT_ST_RDEV
         s->st_rdev = 0;
@@ -789,7 +987,7 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
     }
 
     idx = vfs_parse_filedate (idx, &s->st_mtime);
-    if (!idx)
+    if (!idx || idx >= num_cols)
         goto error;
     /* Use resulting time value */
     s->st_atime = s->st_ctime = s->st_mtime;
@@ -803,60 +1001,43 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
 
     if (num_spaces != NULL)
     {
-        *num_spaces = column_ptr[idx] - column_ptr[idx - 1] - strlen (columns[idx - 1]);
-        if (strcmp (columns[idx], "..") == 0)
+        *num_spaces = columns[idx].str - (columns[idx - 1].str + columns[idx - 1].len);
+        if (column_is (&columns[idx], ".."))
             vfs_parce_ls_final_num_spaces = *num_spaces;
     }
 
     for (i = idx + 1, idx2 = 0; i < num_cols; i++)
-        if (strcmp (columns[i], "->") == 0)
+        if (column_is (&columns[i], "->"))
         {
             idx2 = i;
             break;
         }
 
+    /* Extract the filename from the line, not from the columns
+     * this way we have a chance of entering hidden directories like ". ."
+     */
+    name = columns[idx].str;
+    name_end = name + strlen (name);
+
     if (((S_ISLNK (s->st_mode) || (num_cols == idx + 3 && s->st_nlink > 1)))    /* Maybe a hardlink? (in extfs) */
         && idx2)
     {
-
         if (filename)
-        {
-            *filename = g_strndup (p + column_ptr[idx], column_ptr[idx2] - column_ptr[idx] - 1);
-        }
+            *filename = g_strndup (name, columns[idx2].str - name - 1);
+
+        /* the rest of line is the link name */
+        name = idx2 + 1 < num_cols ? columns[idx2 + 1].str : name_end;
         if (linkname)
-        {
-            t = g_strdup (p + column_ptr[idx2 + 1]);
-            *linkname = t;
-        }
+            *linkname = g_strndup (name, name_end - name - vfs_ls_eol_len (name, name_end));
     }
     else
     {
-        /* Extract the filename from the string copy, not from the columns
-         * this way we have a chance of entering hidden directories like ". ."
-         */
         if (filename)
-        {
-            /*
-             * filename = g_strdup (columns [idx++]);
-             */
-
-            t = g_strdup (p + column_ptr[idx]);
-            *filename = t;
-        }
+            *filename = g_strndup (name, name_end - name - vfs_ls_eol_len (name, name_end));
         if (linkname)
             *linkname = NULL;
     }
 
-    if (t)
-    {
-        int p2 = strlen (t);
-        if ((--p2 > 0) && (t[p2] == '\r' || t[p2] == '\n'))
-            t[p2] = 0;
-        if ((--p2 > 0) && (t[p2] == '\r' || t[p2] == '\n'))
-            t[p2] = 0;
-    }
-
-    g_free (p_copy);
     return TRUE;
 
   error:
@@ -865,14 +1046,139 @@ vfs_parse_ls_lga (const char *p, struct stat * s, char **filename, char **linkna
 
         if (++errorcount < 5)
         {
-            message (D_ERROR, _("Cannot parse:"), "%s", (p_copy && *p_copy) ? p_copy : line);
+            message (D_ERROR, _("Cannot parse:"), "%s", line);
         }
         else if (errorcount == 5)
             message (D_ERROR, MSG_ERROR, _("More parsing errors will be ignored."));
     }
 
-    g_free (p_copy);
     return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse the line of MLSD or MLST output (RFC 3659): "fact=value;...;fact=value; name".
+ * Unlike vfs_parse_ls_lga() no guessing is required: the facts are exact.
+ * Fact names are case-insensitive, unknown facts are ignored. If there is no
+ * owner or mode fact, the corresponding field of *s is not changed.
+ *
+ * Returns FALSE for the malformed line and for the entries of the listed directory
+ * itself and of its parent ("type=cdir" and "type=pdir").
+ */
+
+gboolean
+vfs_parse_mlsx (const char *p, struct stat * s, char **filename, char **linkname)
+{
+    const char *name, *link = NULL, *perm = NULL;
+    size_t link_len = 0, perm_len = 0, name_len;
+    mode_t type = S_IFREG, perms = 0;
+    gboolean have_mode = FALSE;
+
+    /* facts are terminated by the single space */
+    name = strchr (p, ' ');
+    if (name == NULL)
+        return FALSE;
+
+    s->st_size = 0;
+
+    while (p < name)
+    {
+        const char *end, *value;
+        size_t fact_len, value_len;
+
+        end = memchr (p, ';', name - p);
+        if (end == NULL)
+            end = name;
+
+        value = memchr (p, '=', end - p);
+        if (value != NULL)
+        {
+            fact_len = value - p;
+            value++;
+            value_len = end - value;
+
+            if (MLSX_FACT_IS (p, fact_len, "type"))
+            {
+                if (MLSX_FACT_IS (value, value_len, "cdir")
+                    || MLSX_FACT_IS (value, value_len, "pdir"))
+                    return FALSE;
+                if (MLSX_FACT_IS (value, value_len, "dir"))
+                    type = S_IFDIR;
+                else if (value_len > 14 && g_ascii_strncasecmp (value, "OS.unix=slink:", 14) == 0)
+                {
+                    type = S_IFLNK;
+                    link = value + 14;
+                    link_len = value_len - 14;
+                }
+            }
+            else if (MLSX_FACT_IS (p, fact_len, "size") || MLSX_FACT_IS (p, fact_len, "sizd"))
+                s->st_size = (off_t) g_ascii_strtoull (value, NULL, 10);
+            else if (MLSX_FACT_IS (p, fact_len, "modify"))
+                vfs_parse_mlsx_time (value, &s->st_mtime);
+            else if (MLSX_FACT_IS (p, fact_len, "unix.mode"))
+            {
+                perms = (mode_t) g_ascii_strtoull (value, NULL, 8) & 07777;
+                have_mode = TRUE;
+            }
+            else if (MLSX_FACT_IS (p, fact_len, "perm"))
+            {
+                perm = value;
+                perm_len = value_len;
+            }
+            else if (MLSX_FACT_IS (p, fact_len, "unix.uid"))
+                s->st_uid = (uid_t) atol (value);
+            else if (MLSX_FACT_IS (p, fact_len, "unix.gid"))
+                s->st_gid = (gid_t) atol (value);
+            else if (MLSX_FACT_IS (p, fact_len, "unix.owner"))
+            {
+                char *id;
+
+                id = g_strndup (value, value_len);
+                s->st_uid = g_ascii_isdigit (*id) ? (uid_t) atol (id) : (uid_t) vfs_finduid (id);
+                g_free (id);
+            }
+            else if (MLSX_FACT_IS (p, fact_len, "unix.group"))
+            {
+                char *id;
+
+                id = g_strndup (value, value_len);
+                s->st_gid = g_ascii_isdigit (*id) ? (gid_t) atol (id) : (gid_t) vfs_findgid (id);
+                g_free (id);
+            }
+        }
+
+        p = end + 1;
+    }
+
+    if (have_mode)
+        s->st_mode = type | perms;
+    else if (perm != NULL)
+        s->st_mode = type | vfs_parse_mlsx_perm (perm, perm_len, type == S_IFDIR);
+    else
+        s->st_mode = type | (s->st_mode & 07777);
+
+    s->st_atime = s->st_ctime = s->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_RDEV
+    s->st_rdev = 0;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_BLKSIZE
+    s->st_blksize = 512;
+#endif
+#ifdef HAVE_STRUCT_STAT_ST_BLOCKS
+    s->st_blocks = (s->st_size + 511) / 512;
+#endif
+
+    name++;
+    name_len = strcspn (name, "\r\n");
+    if (name_len == 0)
+        return FALSE;
+
+    if (filename != NULL)
+        *filename = g_strndup (name, name_len);
+    if (linkname != NULL)
+        *linkname = link != NULL ? g_strndup (link, link_len) : NULL;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
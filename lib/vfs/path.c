@@ -865,6 +865,63 @@ vfs_path_remove_element_by_index (vfs_path_t * vpath, int element_index)
     vfs_path_element_free (element);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/*
+ * Create path of directory entry.
+ *
+ * If name is a plain file name (without path separators, not "." or ".." and without
+ * encoding prefix), the name is appended to the path of last element of cloned vpath:
+ * the result is the same as vfs_path_from_str() returns for the joined string, but
+ * the path is not printed, canonicalized and parsed again.
+ *
+ * @param vpath pointer to vfs_path_t object of directory
+ * @param name name of entry relative to the directory
+ *
+ * @return Newly allocated path object
+ */
+
+vfs_path_t *
+vfs_path_append_new (const vfs_path_t * vpath, const char *name)
+{
+    vfs_path_t *new_vpath;
+    vfs_path_element_t *element;
+    char *path;
+    size_t len;
+
+    if (vpath == NULL || name == NULL)
+        return NULL;
+
+    if (name[0] == '\0' || strchr (name, PATH_SEP) != NULL
+        || (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        || strncmp (name, VFS_ENCODING_PREFIX, strlen (VFS_ENCODING_PREFIX)) == 0
+        || vfs_path_elements_count (vpath) == 0
+        || vfs_path_get_by_index (vpath, -1)->encoding != NULL)
+    {
+        char *dir, *full;
+
+        /* slow way */
+        dir = vfs_path_to_str (vpath);
+        full = concat_dir_and_file (dir, name);
+        new_vpath = vfs_path_from_str (full);
+        g_free (full);
+        g_free (dir);
+        return new_vpath;
+    }
+
+    new_vpath = vfs_path_clone (vpath);
+    element = vfs_path_get_by_index (new_vpath, -1);
+    path = element->path;
+    len = strlen (path);
+
+    if (len == 0 || path[len - 1] == PATH_SEP)
+        element->path = g_strconcat (path, name, (char *) NULL);
+    else
+        element->path = g_strconcat (path, PATH_SEP_STR, name, (char *) NULL);
+
+    g_free (path);
+    return new_vpath;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** Return VFS class for the given prefix */
 
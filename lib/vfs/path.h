@@ -50,6 +50,7 @@ typedef struct
 vfs_path_t *vfs_path_new (void);
 vfs_path_t *vfs_path_clone (const vfs_path_t * vpath);
 void vfs_path_remove_element_by_index (vfs_path_t * vpath, int element_index);
+vfs_path_t *vfs_path_append_new (const vfs_path_t * vpath, const char *name);
 void vfs_path_free (vfs_path_t * path);
 int vfs_path_elements_count (const vfs_path_t * path);
 
@@ -59,5 +59,7 @@ gboolean vfs_parse_ls_lga (const char *p, struct stat *s, char **filename, char
 size_t vfs_parse_ls_lga_get_final_spaces (void);
 int vfs_parse_filedate (int idx, time_t * t);
 
+gboolean vfs_parse_mlsx (const char *p, struct stat *s, char **filename, char **linkname);
+
 /*** inline functions ****************************************************************************/
 #endif
@@ -460,6 +460,7 @@ vfs_shut (void)
     vfs_gc_done ();
 
     vfs_set_raw_current_dir (NULL);
+    vfs_path_cache_free ();
 
     for (i = 0; i < vfs__classes_list->len; i++)
     {
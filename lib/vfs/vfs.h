@@ -270,6 +270,8 @@ vfs_path_t *vfs_change_encoding (vfs_path_t * vpath, const char *encoding);
 
 int vfs_preallocate (int dest_desc, off_t src_fsize, off_t dest_fsize);
 
+void vfs_path_cache_free (void);
+
 /**
  * Interface functions described in interface.c
  */
@@ -280,15 +282,18 @@ int mc_readlink (const char *path, char *buf, size_t bufsiz);
 int mc_close (int handle);
 off_t mc_lseek (int fd, off_t offset, int whence);
 DIR *mc_opendir (const char *dirname);
+DIR *mc_opendir_vpath (const vfs_path_t * vpath);
 struct dirent *mc_readdir (DIR * dirp);
 int mc_closedir (DIR * dir);
 int mc_stat (const char *path, struct stat *buf);
+int mc_stat_vpath (const vfs_path_t * vpath, struct stat *buf);
 int mc_mknod (const char *path, mode_t mode, dev_t dev);
 int mc_link (const char *name1, const char *name2);
 int mc_mkdir (const char *path, mode_t mode);
 int mc_rmdir (const char *path);
 int mc_fstat (int fd, struct stat *buf);
 int mc_lstat (const char *path, struct stat *buf);
+int mc_lstat_vpath (const vfs_path_t * vpath, struct stat *buf);
 int mc_symlink (const char *name1, const char *name2);
 int mc_rename (const char *original, const char *target);
 int mc_chmod (const char *path, mode_t mode);
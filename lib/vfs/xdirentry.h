@@ -50,10 +50,45 @@
 #define LS_LINEAR_OPEN 2
 #define LS_LINEAR_PREOPEN 3
 
+/* flags of vfs_s_index_record_t */
+#define VFS_S_INDEX_HARDLINK (1 << 0)   /* hard link, "first" is the linked record */
+#define VFS_S_INDEX_LINKED (1 << 1)     /* record has hard links to it */
+
 /*** enums ***************************************************************************************/
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+/* Buffered reader of the network connection */
+typedef struct
+{
+    int fd;                     /* connection, -1 if not connected */
+    char *buf;                  /* allocated on the first read */
+    size_t pos;                 /* first unread byte in buf */
+    size_t len;                 /* number of bytes in buf */
+} vfs_s_reader_t;
+
+/* Compact index of archive entries, see dirindex.c */
+typedef struct vfs_s_index vfs_s_index_t;
+
+/* Archive member in the index */
+typedef struct
+{
+    guint32 name;               /* offset of the name in the arena of names */
+    guint32 parent;             /* record of parent directory, 0 is the root */
+    guint32 next;               /* next record in the same directory, 0 if last */
+    guint32 first;              /* first record in directory, or linked record of hard link */
+    guint32 linkname;           /* offset of symlink target, 0 if none */
+    guint32 flags;              /* VFS_S_INDEX_HARDLINK, VFS_S_INDEX_LINKED */
+    guint32 mode;
+    guint32 uid;
+    guint32 gid;
+    guint64 size;
+    gint64 offset;              /* data offset in archive, device number for devices */
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+} vfs_s_index_record_t;
+
 /* Single connection or archive */
 struct vfs_s_super
 {
@@ -63,8 +98,10 @@ struct vfs_s_super
     int fd_usage;               /* Number of open files */
     int ino_usage;              /* Usage count of this superblock */
     int want_stale;             /* If set, we do not flush cache properly */
+    vfs_s_index_t *index;       /* Not yet expanded directories of archive */
 #ifdef ENABLE_VFS_NET
     vfs_path_element_t *path_element;
+    vfs_s_reader_t *reader;     /* Reader of the control connection, for remote fs only */
 #endif                          /* ENABLE_VFS_NET */
 
     void *data;                 /* This is for filesystem-specific use */
@@ -94,6 +131,7 @@ struct vfs_s_inode
     char *localname;            /* Filename of local file, if we have one */
     struct timeval timestamp;   /* Subclass specific */
     off_t data_offset;          /* Subclass specific */
+    guint32 index_dir;          /* Record of super->index, if entries are not created yet */
 };
 
 /* Data associated with an open file */
@@ -176,8 +214,26 @@ char *vfs_s_fullpath (struct vfs_class *me, struct vfs_s_inode *ino);
 
 /* network filesystems support */
 int vfs_s_select_on_two (int fd1, int fd2);
-int vfs_s_get_line (struct vfs_class *me, int sock, char *buf, int buf_len, char term);
-int vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size, int fd);
+vfs_s_reader_t *vfs_s_reader_new (int fd);
+void vfs_s_reader_free (vfs_s_reader_t * reader);
+void vfs_s_reader_set_fd (vfs_s_reader_t * reader, int fd);
+ssize_t vfs_s_reader_read (vfs_s_reader_t * reader, void *buf, size_t len);
+int vfs_s_get_line (struct vfs_class *me, vfs_s_reader_t * reader, char *buf, int buf_len,
+                    char term);
+int vfs_s_get_line_interruptible (struct vfs_class *me, char *buffer, int size,
+                                  vfs_s_reader_t * reader);
+/* compact index of archive entries */
+void vfs_s_index_init (struct vfs_s_super *super);
+guint32 vfs_s_index_add (struct vfs_class *me, struct vfs_s_super *super, const char *path,
+                         const struct stat *st, const char *linkname, off_t data_offset);
+guint32 vfs_s_index_add_link (struct vfs_class *me, struct vfs_s_super *super, const char *path,
+                              guint32 target);
+guint32 vfs_s_index_lookup (struct vfs_class *me, struct vfs_s_super *super, const char *path);
+vfs_s_index_record_t *vfs_s_index_get (struct vfs_s_super *super, guint32 num);
+void vfs_s_index_finish (struct vfs_class *me, struct vfs_s_super *super);
+void vfs_s_index_expand_dir (struct vfs_class *me, struct vfs_s_inode *dir);
+void vfs_s_index_free (vfs_s_index_t * index);
+
 /* misc */
 int vfs_s_retrieve_file (struct vfs_class *me, struct vfs_s_inode *ino);
 
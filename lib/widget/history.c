@@ -329,7 +329,7 @@ history_put (const char *input_name, GList * h)
 char *
 history_show (GList ** history, Widget * widget)
 {
-    GList *z, *hlist = NULL, *hi;
+    GList *z, *hlist = NULL;
     size_t maxlen, i, count = 0;
     char *r = NULL;
     Dlg_head *query_dlg;
@@ -402,11 +402,11 @@ history_show (GList ** history, Widget * widget)
 
     /* get modified history from dialog */
     z = NULL;
-    for (hi = query_list->list; hi != NULL; hi = g_list_next (hi))
+    for (i = 0; i < (size_t) query_list->count; i++)
     {
         WLEntry *entry;
 
-        entry = (WLEntry *) hi->data;
+        entry = (WLEntry *) g_ptr_array_index (query_list->list, i);
         /* history is being reverted here again */
         z = g_list_prepend (z, entry->text);
         entry->text = NULL;
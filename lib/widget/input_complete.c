@@ -1066,18 +1066,17 @@ query_callback (Dlg_head * h, Widget * sender, dlg_msg_t msg, int parm, void *da
             {
                 int new_end;
                 int i;
-                GList *e;
+                WListbox *l = (WListbox *) h->current->data;
 
                 new_end = str_get_prev_char (&input->buffer[end]) - input->buffer;
 
-                for (i = 0, e = ((WListbox *) h->current->data)->list;
-                     e != NULL; i++, e = g_list_next (e))
+                for (i = 0; i < l->count; i++)
                 {
-                    WLEntry *le = (WLEntry *) e->data;
+                    WLEntry *le = (WLEntry *) g_ptr_array_index (l->list, i);
 
                     if (strncmp (input->buffer + start, le->text, new_end - start) == 0)
                     {
-                        listbox_select_entry ((WListbox *) h->current->data, i);
+                        listbox_select_entry (l, i);
                         end = new_end;
                         input_handle_char (input, parm);
                         send_message ((Widget *) h->current->data, WIDGET_DRAW, 0);
@@ -1104,7 +1103,7 @@ query_callback (Dlg_head * h, Widget * sender, dlg_msg_t msg, int parm, void *da
             }
             else
             {
-                GList *e;
+                WListbox *l = (WListbox *) h->current->data;
                 int i;
                 int need_redraw = 0;
                 int low = 4096;
@@ -1121,10 +1120,9 @@ query_callback (Dlg_head * h, Widget * sender, dlg_msg_t msg, int parm, void *da
                     return MSG_HANDLED;
                 }
 
-                for (i = 0, e = ((WListbox *) h->current->data)->list;
-                     e != NULL; i++, e = g_list_next (e))
+                for (i = 0; i < l->count; i++)
                 {
-                    WLEntry *le = (WLEntry *) e->data;
+                    WLEntry *le = (WLEntry *) g_ptr_array_index (l->list, i);
 
                     if (strncmp (input->buffer + start, le->text, end - start) == 0
                         && strncmp (&le->text[end - start], buff, bl) == 0)
@@ -1132,7 +1130,7 @@ query_callback (Dlg_head * h, Widget * sender, dlg_msg_t msg, int parm, void *da
                         if (need_redraw == 0)
                         {
                             need_redraw = 1;
-                            listbox_select_entry ((WListbox *) h->current->data, i);
+                            listbox_select_entry (l, i);
                             last_text = le->text;
                         }
                         else
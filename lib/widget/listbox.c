@@ -78,6 +78,22 @@ listbox_entry_free (void *data)
     g_free (e);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Returns text of the item at the position, in both normal and virtual modes */
+
+static const char *
+listbox_get_text (WListbox * l, int pos)
+{
+    const char *text;
+
+    if (l->get_item != NULL)
+        text = l->get_item (l, pos);
+    else
+        text = ((WLEntry *) g_ptr_array_index (l->list, pos))->text;
+
+    return text != NULL ? text : "";
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -127,14 +143,11 @@ listbox_draw (WListbox * l, gboolean focused)
         disabled ? DISABLED_COLOR : focused ? h->
         color[DLG_COLOR_HOT_FOCUS] : h->color[DLG_COLOR_FOCUS];
 
-    GList *le;
     int pos;
     int i;
     int sel_line = -1;
 
-    le = g_list_nth (l->list, l->top);
-    /*    pos = (le == NULL) ? 0 : g_list_position (l->list, le); */
-    pos = (le == NULL) ? 0 : l->top;
+    pos = (l->top < l->count) ? l->top : 0;
 
     for (i = 0; i < l->widget.lines; i++)
     {
@@ -151,15 +164,10 @@ listbox_draw (WListbox * l, gboolean focused)
 
         widget_move (&l->widget, i, 1);
 
-        if ((i > 0 && pos >= l->count) || (l->list == NULL) || (le == NULL))
+        if (pos >= l->count)
             text = "";
         else
-        {
-            WLEntry *e = (WLEntry *) le->data;
-            text = e->text;
-            le = g_list_next (le);
-            pos++;
-        }
+            text = listbox_get_text (l, pos++);
 
         tty_print_string (str_fit_to_term (text, l->widget.cols - 2, J_LEFT_FIT));
     }
@@ -178,15 +186,15 @@ listbox_draw (WListbox * l, gboolean focused)
 static int
 listbox_check_hotkey (WListbox * l, int key)
 {
-    int i;
-    GList *le;
+    guint i;
 
-    for (i = 0, le = l->list; le != NULL; i++, le = g_list_next (le))
+    /* items of virtual listbox have no hotkeys */
+    for (i = 0; i < l->list->len; i++)
     {
-        WLEntry *e = (WLEntry *) le->data;
+        WLEntry *e = (WLEntry *) g_ptr_array_index (l->list, i);
 
         if (e->hotkey == key)
-            return i;
+            return (int) i;
     }
 
     return (-1);
@@ -259,7 +267,7 @@ listbox_execute_cmd (WListbox * l, unsigned long command)
             listbox_fwd (l);
         break;
     case CK_Delete:
-        if (l->deletable)
+        if (l->deletable && l->get_item == NULL)
         {
             gboolean is_last = (l->pos + 1 >= l->count);
             gboolean is_more = (l->top + l->widget.lines >= l->count);
@@ -270,7 +278,7 @@ listbox_execute_cmd (WListbox * l, unsigned long command)
         }
         break;
     case CK_Clear:
-        if (l->deletable && mc_global.widget.confirm_history_cleanup
+        if (l->deletable && l->get_item == NULL && mc_global.widget.confirm_history_cleanup
             /* TRANSLATORS: no need to translate 'DialogTitle', it's just a context prefix */
             && (query_dialog (Q_ ("DialogTitle|History cleanup"),
                               _("Do you want clean this history?"),
@@ -292,7 +300,7 @@ listbox_key (WListbox * l, int key)
 {
     unsigned long command;
 
-    if (l->list == NULL)
+    if (l->count == 0)
         return MSG_NOT_HANDLED;
 
     /* focus on listbox item N by '0'..'9' keys */
@@ -316,6 +324,24 @@ listbox_key (WListbox * l, int key)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/* Inserts the entry before the index, appends it if index is out of range */
+static void
+listbox_insert_item (WListbox * l, WLEntry * e, int index)
+{
+    GPtrArray *list = l->list;
+
+    g_ptr_array_add (list, e);
+
+    if (index >= 0 && (guint) index < list->len - 1)
+    {
+        memmove (&list->pdata[index + 1], &list->pdata[index],
+                 (list->len - 1 - index) * sizeof (gpointer));
+        list->pdata[index] = e;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /* Listbox item adding function */
 static inline void
 listbox_append_item (WListbox * l, WLEntry * e, listbox_append_t pos)
@@ -323,21 +349,35 @@ listbox_append_item (WListbox * l, WLEntry * e, listbox_append_t pos)
     switch (pos)
     {
     case LISTBOX_APPEND_AT_END:
-        l->list = g_list_append (l->list, e);
+        g_ptr_array_add (l->list, e);
         break;
 
     case LISTBOX_APPEND_BEFORE:
-        l->list = g_list_insert_before (l->list, g_list_nth (l->list, l->pos), e);
+        listbox_insert_item (l, e, l->pos);
         if (l->pos > 0)
             l->pos--;
         break;
 
     case LISTBOX_APPEND_AFTER:
-        l->list = g_list_insert (l->list, e, l->pos + 1);
+        listbox_insert_item (l, e, l->pos + 1);
         break;
 
     case LISTBOX_APPEND_SORTED:
-        l->list = g_list_insert_sorted (l->list, e, (GCompareFunc) listbox_entry_cmp);
+        {
+            /* insert before the first entry that is not less than new one */
+            int low = 0, high = l->count;
+
+            while (low < high)
+            {
+                int mid = low + (high - low) / 2;
+
+                if (listbox_entry_cmp (g_ptr_array_index (l->list, mid), e) < 0)
+                    low = mid + 1;
+                else
+                    high = mid;
+            }
+            listbox_insert_item (l, e, low);
+        }
         break;
 
     default:
@@ -353,6 +393,8 @@ static inline void
 listbox_destroy (WListbox * l)
 {
     listbox_remove_list (l);
+    g_ptr_array_free (l->list, TRUE);
+    l->list = NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -443,7 +485,7 @@ listbox_event (Gpm_Event * event, void *data)
     if (event->type & GPM_DOWN)
         dlg_select_widget (l);
 
-    if (l->list == NULL)
+    if (l->count == 0)
         return MOU_NORMAL;
 
     if (event->type & (GPM_DOWN | GPM_DRAG))
@@ -520,11 +562,12 @@ listbox_new (int y, int x, int height, int width, gboolean deletable, lcback_fn
     l = g_new (WListbox, 1);
     init_widget (&l->widget, y, x, height, width, listbox_callback, listbox_event);
 
-    l->list = NULL;
+    l->list = g_ptr_array_new ();
     l->top = l->pos = 0;
     l->count = 0;
     l->deletable = deletable;
     l->callback = callback;
+    l->get_item = NULL;
     l->allow_duplicates = TRUE;
     l->scrollbar = !mc_global.tty.slow_terminal;
     widget_want_hotkey (l->widget, TRUE);
@@ -541,15 +584,10 @@ listbox_search_text (WListbox * l, const char *text)
     if (l != NULL)
     {
         int i;
-        GList *le;
-
-        for (i = 0, le = l->list; le != NULL; i++, le = g_list_next (le))
-        {
-            WLEntry *e = (WLEntry *) le->data;
 
-            if (strcmp (e->text, text) == 0)
+        for (i = 0; i < l->count; i++)
+            if (strcmp (listbox_get_text (l, i), text) == 0)
                 return i;
-        }
     }
 
     return (-1);
@@ -579,53 +617,49 @@ listbox_select_last (WListbox * l)
 void
 listbox_select_entry (WListbox * l, int dest)
 {
-    GList *le;
-    int pos;
-    gboolean top_seen = FALSE;
-
     if (dest < 0)
         return;
 
-    /* Special case */
-    for (pos = 0, le = l->list; le != NULL; pos++, le = g_list_next (le))
+    if (dest >= l->count)
     {
-        if (pos == l->top)
-            top_seen = TRUE;
-
-        if (pos == dest)
-        {
-            l->pos = dest;
-            if (!top_seen)
-                l->top = l->pos;
-            else if (l->pos - l->top >= l->widget.lines)
-                l->top = l->pos - l->widget.lines + 1;
-            return;
-        }
+        /* If we are unable to find it, set decent values */
+        l->pos = l->top = 0;
+        return;
     }
 
-    /* If we are unable to find it, set decent values */
-    l->pos = l->top = 0;
+    l->pos = dest;
+    if (l->pos < l->top)
+        l->top = l->pos;
+    else if (l->pos - l->top >= l->widget.lines)
+        l->top = l->pos - l->widget.lines + 1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
-/* Returns the current string text as well as the associated extra data */
+/* Returns the current string text as well as the associated extra data.
+   Items of virtual listbox have no extra data. */
 void
 listbox_get_current (WListbox * l, char **string, void **extra)
 {
     WLEntry *e = NULL;
-    gboolean ok;
-
-    if (l != NULL)
-        e = (WLEntry *) g_list_nth_data (l->list, l->pos);
+    const char *text = NULL;
 
-    ok = (e != NULL);
+    if (l != NULL && l->pos >= 0 && l->pos < l->count)
+    {
+        if (l->get_item != NULL)
+            text = l->get_item (l, l->pos);
+        else
+        {
+            e = (WLEntry *) g_ptr_array_index (l->list, l->pos);
+            text = e->text;
+        }
+    }
 
     if (string != NULL)
-        *string = ok ? e->text : NULL;
+        *string = (char *) text;
 
     if (extra != NULL)
-        *extra = ok ? e->data : NULL;
+        *extra = e != NULL ? e->data : NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -633,14 +667,9 @@ listbox_get_current (WListbox * l, char **string, void **extra)
 void
 listbox_remove_current (WListbox * l)
 {
-    if ((l != NULL) && (l->count != 0))
+    if ((l != NULL) && (l->count != 0) && (l->get_item == NULL))
     {
-        GList *current;
-
-        current = g_list_nth (l->list, l->pos);
-        l->list = g_list_remove_link (l->list, current);
-        listbox_entry_free ((WLEntry *) current->data);
-        g_list_free_1 (current);
+        listbox_entry_free (g_ptr_array_remove_index (l->list, l->pos));
         l->count--;
 
         if (l->count == 0)
@@ -652,6 +681,8 @@ listbox_remove_current (WListbox * l)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/* Fills the listbox with entries (WLEntry *) of the list.
+   The listbox takes the entries, the list itself is freed. */
 void
 listbox_set_list (WListbox * l, GList * list)
 {
@@ -659,10 +690,39 @@ listbox_set_list (WListbox * l, GList * list)
 
     if (l != NULL)
     {
-        l->list = list;
+        GList *le;
+
+        for (le = list; le != NULL; le = g_list_next (le))
+            g_ptr_array_add (l->list, le->data);
+
         l->top = l->pos = 0;
-        l->count = g_list_length (list);
+        l->count = (int) l->list->len;
     }
+
+    g_list_free (list);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Switches the listbox to virtual mode: the listbox keeps no entries, text of items
+   is requested from get_item only for the lines being drawn or searched.
+   The owner calls this again when the number of items changes. */
+void
+listbox_set_virtual (WListbox * l, int count, listbox_item_fn get_item)
+{
+    if (l == NULL)
+        return;
+
+    if (l->get_item == NULL)
+        listbox_remove_list (l);
+
+    l->get_item = get_item;
+    l->count = count;
+
+    if (l->pos >= count)
+        l->pos = max (count - 1, 0);
+    if (l->top > l->pos)
+        l->top = l->pos;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -670,11 +730,11 @@ listbox_set_list (WListbox * l, GList * list)
 void
 listbox_remove_list (WListbox * l)
 {
-    if ((l != NULL) && (l->count != 0))
+    if (l != NULL)
     {
-        g_list_foreach (l->list, (GFunc) listbox_entry_free, NULL);
-        g_list_free (l->list);
-        l->list = NULL;
+        g_ptr_array_foreach (l->list, (GFunc) listbox_entry_free, NULL);
+        g_ptr_array_set_size (l->list, 0);
+        l->get_item = NULL;
         l->count = l->pos = l->top = 0;
     }
 }
@@ -686,7 +746,7 @@ listbox_add_item (WListbox * l, listbox_append_t pos, int hotkey, const char *te
 {
     WLEntry *entry;
 
-    if (l == NULL)
+    if (l == NULL || l->get_item != NULL)
         return NULL;
 
     if (!l->allow_duplicates && (listbox_search_text (l, text) >= 0))
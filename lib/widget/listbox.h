@@ -31,6 +31,8 @@ typedef enum
 
 struct WListbox;
 typedef lcback_ret_t (*lcback_fn) (struct WListbox * l);
+/* returns text of the item at the index, for listbox in virtual mode */
+typedef const char *(*listbox_item_fn) (struct WListbox * l, int index);
 
 typedef struct WLEntry
 {
@@ -42,7 +44,7 @@ typedef struct WLEntry
 typedef struct WListbox
 {
     Widget widget;
-    GList *list;                /* Pointer to the double linked list */
+    GPtrArray *list;            /* Entries (WLEntry *), empty in virtual mode */
     int pos;                    /* The current element displayed */
     int top;                    /* The first element displayed */
     int count;                  /* Number of items in the listbox */
@@ -50,6 +52,7 @@ typedef struct WListbox
     gboolean scrollbar;         /* Draw a scrollbar? */
     gboolean deletable;         /* Can list entries be deleted? */
     lcback_fn callback;         /* The callback function */
+    listbox_item_fn get_item;   /* Supplies the items in virtual mode, NULL otherwise */
     int cursor_x, cursor_y;     /* Cache the values */
 } WListbox;
 
@@ -67,6 +70,7 @@ void listbox_select_entry (WListbox * l, int dest);
 void listbox_get_current (WListbox * l, char **string, void **extra);
 void listbox_remove_current (WListbox * l);
 void listbox_set_list (WListbox * l, GList * list);
+void listbox_set_virtual (WListbox * l, int count, listbox_item_fn get_item);
 void listbox_remove_list (WListbox * l);
 char *listbox_add_item (WListbox * l, listbox_append_t pos,
                         int hotkey, const char *text, void *data);
@@ -7,6 +7,23 @@ AC_DEFUN([AC_MC_VFS_SFS],
 	enable_vfs_sfs="yes"
 	AC_MC_VFS_ADDNAME([sfs])
 	AC_DEFINE([ENABLE_VFS_SFS], [1], [Support for sfs])
+
+	dnl Libraries for in-process decompression, the commands from sfs.ini are used without them
+	AC_CHECK_HEADER([zlib.h],
+	    [AC_CHECK_LIB([z], [inflatePrime],
+		[AC_DEFINE([HAVE_ZLIB], [1], [Define to decompress gzip files in sfs with zlib])
+		 case " $MCLIBS " in
+		 *" -lz "*) ;;
+		 *) MCLIBS="$MCLIBS -lz" ;;
+		 esac])])
+	AC_CHECK_HEADER([bzlib.h],
+	    [AC_CHECK_LIB([bz2], [BZ2_bzDecompressInit],
+		[AC_DEFINE([HAVE_BZLIB], [1], [Define to decompress bzip2 files in sfs with libbz2])
+		 MCLIBS="$MCLIBS -lbz2"])])
+	AC_CHECK_HEADER([lzma.h],
+	    [AC_CHECK_LIB([lzma], [lzma_stream_decoder],
+		[AC_DEFINE([HAVE_LZMA], [1], [Define to decompress xz files in sfs with liblzma])
+		 MCLIBS="$MCLIBS -llzma"])])
     fi
     AM_CONDITIONAL(ENABLE_VFS_SFS, [test "$enable_vfs" = "yes" -a x"$enable_vfs_sfs" = x"yes"])
 ])
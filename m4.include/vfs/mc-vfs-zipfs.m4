@@ -0,0 +1,23 @@
+dnl ZIP filesystem support
+AC_DEFUN([AC_MC_VFS_ZIPFS],
+[
+    AC_ARG_ENABLE([vfs-zip],
+		    AS_HELP_STRING([--enable-vfs-zip], [Support for zip filesystem (requires zlib) @<:@yes@:>@]))
+    if test "$enable_vfs" = "yes" -a x"$enable_vfs_zip" != x"no"; then
+	zlib_found=no
+	AC_CHECK_HEADER([zlib.h],
+	    [AC_CHECK_LIB([z], [inflateInit2_], [zlib_found=yes])])
+
+	if test x"$zlib_found" = x"yes"; then
+	    enable_vfs_zip="yes"
+	    AC_MC_VFS_ADDNAME([zip])
+	    AC_DEFINE([ENABLE_VFS_ZIP], [1], [Support for zip filesystem])
+	    MCLIBS="$MCLIBS -lz"
+	elif test x"$enable_vfs_zip" = x"yes"; then
+	    AC_MSG_ERROR([zlib is required for zip filesystem])
+	else
+	    enable_vfs_zip="no"
+	fi
+    fi
+    AM_CONDITIONAL(ENABLE_VFS_ZIP, [test "$enable_vfs" = "yes" -a x"$enable_vfs_zip" = x"yes"])
+])
@@ -483,7 +483,7 @@ task_cb (WButton * button, int action)
 
     (void) button;
 
-    if (bg_list->list == NULL)
+    if (bg_list->count == 0)
         return 0;
 
     /* Get this instance information */
@@ -1001,6 +1001,9 @@ reread_cmd (void)
         get_other_type () == view_listing  && strcmp (current_panel->cwd, other_panel->cwd) == 0)
         flag |= UP_RELOAD | UP_ONLY_CURRENT;
 
+    /* forget the directory lists cached for computing of directory sizes */
+    compute_dir_size_clear_cache ();
+
     update_panels (flag, UP_KEEPSEL);
     repaint_screen ();
 }
@@ -133,14 +133,54 @@ clean_sort_keys (dir_list * list, int start, int count)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * If you change handle_dirent then check also handle_path.
+ * Create collation keys of all entries before sorting: otherwise comparison functions
+ * check and create them O(n log n) times.
+ */
+
+static void
+create_sort_keys (dir_list * list, int start, int count, sortfn * sort)
+{
+    int i;
+
+    if (sort == (sortfn *) unsorted || sort == (sortfn *) sort_vers
+        || sort == (sortfn *) sort_inode)
+        return;
+
+    for (i = start; i < start + count; i++)
+    {
+        file_entry *fe = &list->list[i];
+
+        if (fe->sort_key == NULL)
+            fe->sort_key = str_create_key_for_filename (fe->fname, case_sensitive);
+        if (sort == (sortfn *) sort_ext && fe->second_sort_key == NULL)
+            fe->second_sort_key = str_create_key (extension (fe->fname), case_sensitive);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/** Compare entries by pointers, user_data points to the sort function */
+
+static int
+sort_entry_ptr (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+    sortfn *sort = *(sortfn **) user_data;
+
+    return sort (*(file_entry * const *) a, *(file_entry * const *) b);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * If you change handle_dirent then check also handle_path and dir_list_update_entry.
  * @returns -1 = failure, 0 = don't add, 1 = add to the list
  */
 
 static int
-handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
+handle_dirent (dir_list * list, const vfs_path_t * dir_vpath, const char *fltr, struct dirent *dp,
                struct stat *buf1, int next_free, int *link_to_dir, int *stale_link)
 {
+    vfs_path_t *vpath;
+
     if (dp->d_name[0] == '.' && dp->d_name[1] == 0)
         return 0;
     if (dp->d_name[0] == '.' && dp->d_name[1] == '.' && dp->d_name[2] == 0)
@@ -150,7 +190,10 @@ handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
     if (!panels_options.show_backups && dp->d_name[NLENGTH (dp) - 1] == '~')
         return 0;
 
-    if (mc_lstat (dp->d_name, buf1) == -1)
+    /* path of entry is built from the already parsed path of directory */
+    vpath = vfs_path_append_new (dir_vpath, dp->d_name);
+
+    if (mc_lstat_vpath (vpath, buf1) == -1)
     {
         /*
          * lstat() fails - such entries should be identified by
@@ -169,11 +212,12 @@ handle_dirent (dir_list * list, const char *fltr, struct dirent *dp,
     if (S_ISLNK (buf1->st_mode))
     {
         struct stat buf2;
-        if (!mc_stat (dp->d_name, &buf2))
+        if (!mc_stat_vpath (vpath, &buf2))
             *link_to_dir = S_ISDIR (buf2.st_mode) != 0;
         else
             *stale_link = 1;
     }
+    vfs_path_free (vpath);
     if (!(S_ISDIR (buf1->st_mode) || *link_to_dir) && (fltr != NULL)
         && !mc_search (fltr, dp->d_name, MC_SEARCH_T_GLOB))
         return 0;
@@ -409,8 +453,11 @@ do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse_f, gboolean c
          gboolean exec_first_f)
 {
     int dot_dot_found = 0;
+    int count, i;
+    file_entry *base;
+    file_entry **index;
 
-    if (top == 0)
+    if (top == 0 || sort == (sortfn *) unsorted)
         return;
 
     /* If there is an ".." entry the caller must take care to
@@ -418,12 +465,44 @@ do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse_f, gboolean c
     if (strcmp (list->list[0].fname, "..") == 0)
         dot_dot_found = 1;
 
+    count = top + 1 - dot_dot_found;
+
     reverse = reverse_f ? -1 : 1;
     case_sensitive = case_sensitive_f ? 1 : 0;
     exec_first = exec_first_f;
-    qsort (&(list->list)[dot_dot_found], top + 1 - dot_dot_found, sizeof (file_entry), sort);
+    create_sort_keys (list, dot_dot_found, count, sort);
+
+    /* sort pointers instead of moving whole entries with struct stat on each swap */
+    base = &list->list[dot_dot_found];
+    index = g_new (file_entry *, count);
+    for (i = 0; i < count; i++)
+        index[i] = &base[i];
+
+    g_qsort_with_data (index, count, sizeof (file_entry *), sort_entry_ptr, &sort);
+
+    /* then move every entry once following the cycles of permutation:
+       index[j] points to the entry which belongs to base[j] */
+    for (i = 0; i < count; i++)
+    {
+        file_entry tmp;
+        int j, k;
+
+        if (index[i] == &base[i])
+            continue;
 
-    clean_sort_keys (list, dot_dot_found, top + 1 - dot_dot_found);
+        tmp = base[i];
+        for (j = i; (k = index[j] - base) != i; j = k)
+        {
+            base[j] = base[k];
+            index[j] = &base[j];
+        }
+        base[j] = tmp;
+        index[j] = &base[j];
+    }
+
+    g_free (index);
+
+    clean_sort_keys (list, dot_dot_found, count);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -524,6 +603,7 @@ do_load_dir (const char *path, dir_list * list, sortfn * sort, gboolean lc_rever
     int status, link_to_dir, stale_link;
     int next_free = 0;
     struct stat st;
+    vfs_path_t *vpath;
 
     /* ".." (if any) must be the first entry in the list */
     if (!set_zero_dir (list))
@@ -533,9 +613,11 @@ do_load_dir (const char *path, dir_list * list, sortfn * sort, gboolean lc_rever
         list->list[next_free].st = st;
     next_free++;
 
-    dirp = mc_opendir (path);
+    vpath = vfs_path_from_str (path);
+    dirp = mc_opendir_vpath (vpath);
     if (!dirp)
     {
+        vfs_path_free (vpath);
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
         return next_free;
     }
@@ -548,13 +630,14 @@ do_load_dir (const char *path, dir_list * list, sortfn * sort, gboolean lc_rever
 
     while ((dp = mc_readdir (dirp)))
     {
-        status = handle_dirent (list, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
+        status = handle_dirent (list, vpath, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
         if (status == 0)
             continue;
         if (status == -1)
         {
             tree_store_end_check ();
             mc_closedir (dirp);
+            vfs_path_free (vpath);
             return next_free;
         }
         list->list[next_free].fnamelen = NLENGTH (dp);
@@ -566,6 +649,7 @@ do_load_dir (const char *path, dir_list * list, sortfn * sort, gboolean lc_rever
         list->list[next_free].st = st;
         list->list[next_free].sort_key = NULL;
         list->list[next_free].second_sort_key = NULL;
+        list->list[next_free].fhl_id = 0;
         next_free++;
 
         if ((next_free & 31) == 0)
@@ -577,6 +661,7 @@ do_load_dir (const char *path, dir_list * list, sortfn * sort, gboolean lc_rever
 
     mc_closedir (dirp);
     tree_store_end_check ();
+    vfs_path_free (vpath);
     return next_free;
 }
 
@@ -607,10 +692,13 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
     struct stat st;
     int marked_cnt;
     GHashTable *marked_files;
+    vfs_path_t *vpath;
 
-    dirp = mc_opendir (path);
+    vpath = vfs_path_from_str (path);
+    dirp = mc_opendir_vpath (vpath);
     if (!dirp)
     {
+        vfs_path_free (vpath);
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
         clean_dir (list, count);
         return set_zero_dir (list) ? 1 : 0;
@@ -629,6 +717,7 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
         dir_copy.list[i].f.stale_link = list->list[i].f.stale_link;
         dir_copy.list[i].sort_key = NULL;
         dir_copy.list[i].second_sort_key = NULL;
+        dir_copy.list[i].fhl_id = 0;
         if (list->list[i].f.marked)
         {
             g_hash_table_insert (marked_files, dir_copy.list[i].fname, &dir_copy.list[i]);
@@ -642,6 +731,7 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
     {
         if (!set_zero_dir (list))
         {
+            vfs_path_free (vpath);
             clean_dir (list, count);
             clean_dir (&dir_copy, count);
             return next_free;
@@ -655,12 +745,13 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
 
     while ((dp = mc_readdir (dirp)))
     {
-        status = handle_dirent (list, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
+        status = handle_dirent (list, vpath, fltr, dp, &st, next_free, &link_to_dir, &stale_link);
         if (status == 0)
             continue;
         if (status == -1)
         {
             mc_closedir (dirp);
+            vfs_path_free (vpath);
             /* Norbert (Feb 12, 1997):
                Just in case someone finds this memory leak:
                -1 means big trouble (at the moment no memory left),
@@ -700,6 +791,7 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
         list->list[next_free].st = st;
         list->list[next_free].sort_key = NULL;
         list->list[next_free].second_sort_key = NULL;
+        list->list[next_free].fhl_id = 0;
         next_free++;
         if (!(next_free % 16))
             rotate_dash ();
@@ -707,6 +799,7 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
     mc_closedir (dirp);
     tree_store_end_check ();
     g_hash_table_destroy (marked_files);
+    vfs_path_free (vpath);
     if (next_free)
     {
         do_sort (list, sort, next_free - 1, lc_reverse, lc_case_sensitive, exec_ff);
@@ -716,3 +809,137 @@ do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply the change of one file to the sorted directory listing: the entry is
+ * removed if the file was deleted, added if the file was created and restatted
+ * and moved to the proper position otherwise. The rest of listing is not touched.
+ * If you change dir_list_update_entry then check also handle_dirent.
+ *
+ * @param old_pos returns position of the entry before the change or -1
+ * @param new_pos returns position of the entry after the change or -1
+ * @returns new number of entries
+ */
+
+int
+dir_list_update_entry (const char *path, dir_list * list, int count, const char *fname,
+                       sortfn * sort, gboolean lc_reverse, gboolean lc_case_sensitive,
+                       gboolean exec_ff, const char *fltr, int *old_pos, int *new_pos)
+{
+    file_entry fentry;
+    struct stat st;
+    char *full_name;
+    gboolean exists;
+    int dot_dot_found = 0;
+    int i, lo, hi;
+
+    *old_pos = -1;
+    *new_pos = -1;
+
+    if (strcmp (fname, ".") == 0 || strcmp (fname, "..") == 0)
+        return count;
+
+    if (count > 0 && strcmp (list->list[0].fname, "..") == 0)
+        dot_dot_found = 1;
+
+    memset (&fentry, 0, sizeof (fentry));
+
+    for (i = dot_dot_found; i < count; i++)
+        if (strcmp (list->list[i].fname, fname) == 0)
+        {
+            /* take entry out from the listing */
+            *old_pos = i;
+            fentry = list->list[i];
+            count--;
+            memmove (&list->list[i], &list->list[i + 1], (count - i) * sizeof (file_entry));
+            break;
+        }
+
+    full_name = mc_build_filename (path, fname, (char *) NULL);
+    exists = mc_lstat (full_name, &st) == 0;
+
+    if (exists)
+    {
+        struct stat st2;
+
+        fentry.f.link_to_dir = 0;
+        fentry.f.stale_link = 0;
+        if (S_ISLNK (st.st_mode))
+        {
+            if (mc_stat (full_name, &st2) == 0)
+                fentry.f.link_to_dir = S_ISDIR (st2.st_mode) != 0;
+            else
+                fentry.f.stale_link = 1;
+        }
+
+        if ((!panels_options.show_dot_files && fname[0] == '.')
+            || (!panels_options.show_backups && fname[strlen (fname) - 1] == '~')
+            || (!(S_ISDIR (st.st_mode) || fentry.f.link_to_dir) && (fltr != NULL)
+                && !mc_search (fltr, fname, MC_SEARCH_T_GLOB)))
+            exists = FALSE;
+    }
+    g_free (full_name);
+
+    if (!exists)
+    {
+        g_free (fentry.fname);
+        return count;
+    }
+
+    if (fentry.fname == NULL)
+    {
+        fentry.fname = g_strdup (fname);
+        fentry.fnamelen = strlen (fname);
+    }
+    fentry.st = st;
+    fentry.f.dir_size_computed = 0;
+    fentry.sort_key = NULL;
+    fentry.second_sort_key = NULL;
+    fentry.fhl_id = 0;
+
+    /* Need to grow the *list? */
+    if (count >= list->size)
+    {
+        list->list = g_try_realloc (list->list, sizeof (file_entry) * (list->size + RESIZE_STEPS));
+        if (list->list == NULL)
+        {
+            list->size = 0;
+            g_free (fentry.fname);
+            return 0;
+        }
+        list->size += RESIZE_STEPS;
+    }
+
+    /* binary search of the position with the current sort order */
+    reverse = lc_reverse ? -1 : 1;
+    case_sensitive = lc_case_sensitive ? 1 : 0;
+    exec_first = exec_ff;
+
+    lo = dot_dot_found;
+    hi = count;
+    while (lo < hi)
+    {
+        const int mid = lo + (hi - lo) / 2;
+        file_entry *e = &list->list[mid];
+
+        if (sort (&fentry, e) < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+
+        clean_sort_keys (list, mid, 1);
+    }
+
+    str_release_key (fentry.sort_key, case_sensitive);
+    fentry.sort_key = NULL;
+    str_release_key (fentry.second_sort_key, case_sensitive);
+    fentry.second_sort_key = NULL;
+    fentry.fhl_id = 0;
+
+    memmove (&list->list[lo + 1], &list->list[lo], (count - lo) * sizeof (file_entry));
+    list->list[lo] = fentry;
+    *new_pos = lo;
+
+    return count + 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -37,6 +37,9 @@ void do_sort (dir_list * list, sortfn * sort, int top, gboolean reverse,
               gboolean case_sensitive, gboolean exec_ff);
 int do_reload_dir (const char *path, dir_list * list, sortfn * sort, int count,
                    gboolean reverse, gboolean case_sensitive, gboolean exec_ff, const char *fltr);
+int dir_list_update_entry (const char *path, dir_list * list, int count, const char *fname,
+                           sortfn * sort, gboolean reverse, gboolean case_sensitive,
+                           gboolean exec_ff, const char *fltr, int *old_pos, int *new_pos);
 void clean_dir (dir_list * list, int count);
 gboolean set_zero_dir (dir_list * list);
 int handle_path (dir_list * list, const char *path, struct stat *buf1,
@@ -0,0 +1,362 @@
+/*
+   Watching of directory changes
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file dirwatch.c
+ *  \brief Source: watching of directory changes
+ *
+ *  On Linux the changes are reported by inotify: the names of changed entries
+ *  are collected while the inotify descriptor is readable and are passed to
+ *  the owner of watch at once, every name only once.
+ *
+ *  If inotify is not available (or its limits are exhausted), the modification
+ *  time of the directory is checked by dir_watch_poll() not more often than
+ *  once per second and the owner is asked to reread the whole directory.
+ *
+ *  Only directories of the local file system are watched.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+#include "lib/vfs/vfs.h"
+
+#include "dirwatch.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#ifdef HAVE_SYS_INOTIFY_H
+#define DIR_WATCH_MASK (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB \
+                        | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_watch_t
+{
+    char *path;
+    dir_watch_fn callback;
+    void *data;
+
+    int wd;                     /* inotify watch descriptor, -1 if directory is polled */
+    GHashTable *changed;        /* names of changed entries */
+    gboolean rescan;            /* changes are lost */
+
+    /* stamp of directory for polling */
+    time_t mtime;
+    time_t ctime;
+};
+
+/*** file scope variables ************************************************************************/
+
+static GList *watches = NULL;
+
+#ifdef HAVE_SYS_INOTIFY_H
+/* -2: not initialized yet, -1: inotify is not available */
+static int inotify_fd = -2;
+#endif
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Pass the collected changes to the owner of watch */
+
+static void
+dir_watch_flush (dir_watch_t * watch)
+{
+    if (watch->rescan)
+    {
+        watch->rescan = FALSE;
+        if (watch->changed != NULL)
+            g_hash_table_remove_all (watch->changed);
+
+        /* owner can free or replace the watch while rereading directory */
+        watch->callback (DIR_WATCH_RESCAN, NULL, watch->data);
+    }
+    else if (watch->changed != NULL && g_hash_table_size (watch->changed) != 0)
+    {
+        GHashTableIter iter;
+        gpointer key;
+
+        g_hash_table_iter_init (&iter, watch->changed);
+        while (g_hash_table_iter_next (&iter, &key, NULL))
+            watch->callback (DIR_WATCH_CHANGED, (const char *) key, watch->data);
+
+        g_hash_table_remove_all (watch->changed);
+        watch->callback (DIR_WATCH_FLUSH, NULL, watch->data);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_flush_all (void)
+{
+    GList *copy, *w;
+
+    /* callback can free any watch: iterate over the copy of list */
+    copy = g_list_copy (watches);
+
+    for (w = copy; w != NULL; w = g_list_next (w))
+        if (g_list_find (watches, w->data) != NULL)
+            dir_watch_flush ((dir_watch_t *) w->data);
+
+    g_list_free (copy);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_SYS_INOTIFY_H
+static void
+dir_watch_inotify_event (const struct inotify_event *event)
+{
+    GList *w;
+
+    for (w = watches; w != NULL; w = g_list_next (w))
+    {
+        dir_watch_t *watch = (dir_watch_t *) w->data;
+
+        if (watch->wd == -1)
+            continue;
+
+        if ((event->mask & IN_Q_OVERFLOW) != 0)
+            watch->rescan = TRUE;
+        else if (watch->wd != event->wd)
+            continue;
+        else if ((event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) != 0)
+            watch->rescan = TRUE;
+        else if (event->len != 0 && event->name[0] != '\0')
+            g_hash_table_replace (watch->changed, g_strdup (event->name), NULL);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+dir_watch_inotify_callback (int fd, void *info)
+{
+    /* aligned buffer for several events */
+    union
+    {
+        struct inotify_event event;
+        char buf[BUF_8K];
+    } u;
+    ssize_t n;
+
+    (void) info;
+
+    while ((n = read (fd, u.buf, sizeof (u.buf))) > 0)
+    {
+        char *p;
+
+        for (p = u.buf; p < u.buf + n;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+
+            dir_watch_inotify_event (event);
+            p += sizeof (struct inotify_event) + event->len;
+        }
+    }
+
+    dir_watch_flush_all ();
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_inotify_add (dir_watch_t * watch)
+{
+    if (inotify_fd == -2)
+    {
+        inotify_fd = inotify_init ();
+        if (inotify_fd != -1)
+        {
+            fcntl (inotify_fd, F_SETFD, FD_CLOEXEC);
+            fcntl (inotify_fd, F_SETFL, O_NONBLOCK);
+            add_select_channel (inotify_fd, dir_watch_inotify_callback, NULL);
+        }
+    }
+
+    if (inotify_fd < 0)
+        return;
+
+    watch->wd = inotify_add_watch (inotify_fd, watch->path, DIR_WATCH_MASK | IN_ONLYDIR);
+    if (watch->wd != -1)
+        watch->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_inotify_remove (dir_watch_t * watch)
+{
+    GList *w;
+
+    if (watch->wd == -1)
+        return;
+
+    /* watch descriptor is shared between watches of the same directory */
+    for (w = watches; w != NULL; w = g_list_next (w))
+        if (w->data != watch && ((dir_watch_t *) w->data)->wd == watch->wd)
+            return;
+
+    inotify_rm_watch (inotify_fd, watch->wd);
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start watching of directory.
+ * Returns NULL if directory cannot be watched.
+ */
+
+dir_watch_t *
+dir_watch_new (const char *path, dir_watch_fn callback, void *data)
+{
+    dir_watch_t *watch;
+    vfs_path_t *vpath;
+    gboolean is_local;
+    struct stat st;
+
+    vpath = vfs_path_from_str (path);
+    is_local = vfs_file_is_local (vpath);
+    vfs_path_free (vpath);
+
+    if (!is_local || stat (path, &st) != 0 || !S_ISDIR (st.st_mode))
+        return NULL;
+
+    watch = g_new0 (dir_watch_t, 1);
+    watch->path = g_strdup (path);
+    watch->callback = callback;
+    watch->data = data;
+    watch->wd = -1;
+    watch->mtime = st.st_mtime;
+    watch->ctime = st.st_ctime;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    dir_watch_inotify_add (watch);
+#endif
+
+    watches = g_list_prepend (watches, watch);
+
+    return watch;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_watch_free (dir_watch_t * watch)
+{
+    if (watch == NULL)
+        return;
+
+#ifdef HAVE_SYS_INOTIFY_H
+    dir_watch_inotify_remove (watch);
+#endif
+
+    watches = g_list_remove (watches, watch);
+
+    if (watch->changed != NULL)
+        g_hash_table_destroy (watch->changed);
+    g_free (watch->path);
+    g_free (watch);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+const char *
+dir_watch_get_path (const dir_watch_t * watch)
+{
+    return watch->path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check the directories which are not watched by inotify */
+
+void
+dir_watch_poll (void)
+{
+    static time_t last_poll = 0;
+    time_t now;
+    GList *w;
+
+    now = time (NULL);
+    if (now == last_poll)
+        return;
+    last_poll = now;
+
+    for (w = watches; w != NULL; w = g_list_next (w))
+    {
+        dir_watch_t *watch = (dir_watch_t *) w->data;
+        struct stat st;
+
+        if (watch->wd != -1)
+            continue;
+
+        if (stat (watch->path, &st) != 0)
+            watch->rescan = TRUE;
+        else if (st.st_mtime != watch->mtime || st.st_ctime != watch->ctime)
+        {
+            watch->mtime = st.st_mtime;
+            watch->ctime = st.st_ctime;
+            watch->rescan = TRUE;
+        }
+    }
+
+    dir_watch_flush_all ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_watch_shutdown (void)
+{
+    while (watches != NULL)
+        dir_watch_free ((dir_watch_t *) watches->data);
+
+#ifdef HAVE_SYS_INOTIFY_H
+    if (inotify_fd >= 0)
+    {
+        delete_select_channel (inotify_fd);
+        close (inotify_fd);
+    }
+    inotify_fd = -2;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,39 @@
+/** \file dirwatch.h
+ *  \brief Header: watching of directory changes
+ */
+
+#ifndef MC__DIR_WATCH_H
+#define MC__DIR_WATCH_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+typedef enum
+{
+    DIR_WATCH_CHANGED = 0,      /* entry was created, deleted, renamed or its attributes changed */
+    DIR_WATCH_RESCAN,           /* changes are unknown, whole directory should be reread */
+    DIR_WATCH_FLUSH             /* end of the series of DIR_WATCH_CHANGED events */
+} dir_watch_event_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+struct dir_watch_t;
+typedef struct dir_watch_t dir_watch_t;
+
+/* name is the name of changed entry for DIR_WATCH_CHANGED and NULL otherwise */
+typedef void (*dir_watch_fn) (dir_watch_event_t event, const char *name, void *data);
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_watch_t *dir_watch_new (const char *path, dir_watch_fn callback, void *data);
+void dir_watch_free (dir_watch_t * watch);
+const char *dir_watch_get_path (const dir_watch_t * watch);
+
+void dir_watch_poll (void);
+void dir_watch_shutdown (void);
+
+/*** inline functions ****************************************************************************/
+#endif /* MC__DIR_WATCH_H */
@@ -38,6 +38,10 @@
 #include <string.h>
 #include <unistd.h>
 
+#ifdef HAVE_LIBMAGIC
+#include <magic.h>
+#endif
+
 #include "lib/global.h"
 #include "lib/tty/tty.h"
 #include "lib/search.h"
@@ -74,10 +78,49 @@
 #define FILE_CMD "file "
 #endif
 
+/* number of detected file types kept in memory and in the cache file */
+#define EXT_TYPE_CACHE_MAX 4096
+
 /*** file scope type declarations ****************************************************************/
 
 typedef char *(*quote_func_t) (const char *name, int quote_percent);
 
+typedef enum
+{
+    EXT_RULE_UNKNOWN = 0,
+    EXT_RULE_REGEX,
+    EXT_RULE_DIRECTORY,
+    EXT_RULE_SHELL,
+    EXT_RULE_TYPE,
+    EXT_RULE_INCLUDE,
+    EXT_RULE_DEFAULT
+} ext_rule_type_t;
+
+/* action of mc.ext section, i.e. "Open=command" */
+typedef struct
+{
+    char *name;
+    const char *command;        /* points into data, ends with '\n' or '\0' */
+} ext_action_t;
+
+/* section of mc.ext: the line to match the file against and the actions */
+typedef struct
+{
+    ext_rule_type_t type;
+    char *pattern;
+    size_t pattern_len;
+    mc_search_t *search;        /* compiled regex of regex/, directory/ and type/ */
+    GPtrArray *actions;
+} ext_rule_t;
+
+/* result of file type detection */
+typedef struct
+{
+    char *type;                 /* output of "file" without file name */
+    char *encoding;             /* output of "enca", NULL if not detected */
+    gboolean persistent;        /* local file: save to the cache file */
+} ext_type_t;
+
 /*** file scope variables ************************************************************************/
 
 /* This variable points to a copy of the mc.ext file in memory
@@ -86,6 +129,18 @@ typedef char *(*quote_func_t) (const char *name, int quote_percent);
  */
 static char *data = NULL;
 
+/* Sections of mc.ext in order of appearance */
+static GPtrArray *rules = NULL;
+
+/* Detected types of files: "dev:ino:size:mtime" -> ext_type_t */
+static GHashTable *type_cache = NULL;
+static gboolean type_cache_changed = FALSE;
+
+#ifdef HAVE_LIBMAGIC
+static magic_t magic_cookie = NULL;
+static gboolean magic_failed = FALSE;
+#endif
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -429,6 +484,53 @@ get_popen_information (const char *cmd_file, const char *args, char *buf, int bu
     return read_bytes ? 1 : 0;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Detect type of the local file with libmagic, the same way as the "file" command does.
+ * Return 1 if the data is valid, 0 otherwise, -1 if libmagic cannot be used.
+ */
+
+#ifdef HAVE_LIBMAGIC
+static int
+get_file_type_magic (const char *filename, char *buf, int buflen)
+{
+    const char *type;
+
+    if (magic_failed)
+        return -1;
+
+    if (magic_cookie == NULL)
+    {
+#ifdef FILE_L
+        magic_cookie = magic_open (MAGIC_SYMLINK);
+#else
+        magic_cookie = magic_open (MAGIC_NONE);
+#endif
+        if (magic_cookie != NULL && magic_load (magic_cookie, NULL) != 0)
+        {
+            magic_close (magic_cookie);
+            magic_cookie = NULL;
+        }
+
+        if (magic_cookie == NULL)
+        {
+            magic_failed = TRUE;
+            return -1;
+        }
+    }
+
+    type = magic_file (magic_cookie, filename);
+    if (type == NULL)
+    {
+        buf[0] = '\0';
+        return 0;
+    }
+
+    g_strlcpy (buf, type, buflen);
+    return 1;
+}
+#endif /* HAVE_LIBMAGIC */
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Run the "file" command on the local file.
@@ -441,6 +543,12 @@ get_file_type_local (const char *filename, char *buf, int buflen)
     char *tmp;
     int ret;
 
+#ifdef HAVE_LIBMAGIC
+    ret = get_file_type_magic (filename, buf, buflen);
+    if (ret != -1)
+        return ret;
+#endif
+
     tmp = name_quote (filename, 0);
     ret = get_popen_information (FILE_CMD, tmp, buf, buflen);
     g_free (tmp);
@@ -475,16 +583,185 @@ get_file_encoding_local (const char *filename, char *buf, int buflen)
 }
 #endif /* HAVE_CHARSET */
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_type_free (gpointer p)
+{
+    ext_type_t *t = (ext_type_t *) p;
+
+    g_free (t->type);
+    g_free (t->encoding);
+    g_free (t);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+ext_type_cache_get_file_name (void)
+{
+    return g_build_filename (mc_config_get_cache_path (), MC_FILETYPES_CACHE_FILE, (char *) NULL);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Invoke the "file" command on the file and match its output against PTR.
+ * Load types detected in previous sessions.
+ * Each line of cache file is "key\ttype[\tencoding]".
+ */
+
+static void
+ext_type_cache_load (void)
+{
+    char *file_name, *contents;
+    char **lines, **line;
+
+    type_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ext_type_free);
+    type_cache_changed = FALSE;
+
+    file_name = ext_type_cache_get_file_name ();
+    if (!g_file_get_contents (file_name, &contents, NULL, NULL))
+        contents = NULL;
+    g_free (file_name);
+
+    if (contents == NULL)
+        return;
+
+    lines = g_strsplit (contents, "\n", -1);
+    g_free (contents);
+
+    for (line = lines; *line != NULL; line++)
+    {
+        char **fields;
+
+        fields = g_strsplit (*line, "\t", 3);
+        if (fields[0] != NULL && fields[1] != NULL)
+        {
+            ext_type_t *t;
+
+            t = g_new (ext_type_t, 1);
+            t->type = g_strdup (fields[1]);
+            t->encoding = g_strdup (fields[2]);
+            t->persistent = TRUE;
+            g_hash_table_replace (type_cache, g_strdup (fields[0]), t);
+        }
+        g_strfreev (fields);
+    }
+
+    g_strfreev (lines);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_type_cache_save (void)
+{
+    GString *buf;
+    GHashTableIter iter;
+    gpointer key, value;
+    char *file_name;
+
+    if (!type_cache_changed)
+        return;
+
+    buf = g_string_sized_new (4096);
+
+    g_hash_table_iter_init (&iter, type_cache);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+        ext_type_t *t = (ext_type_t *) value;
+
+        if (!t->persistent)
+            continue;
+
+        g_string_append_printf (buf, "%s\t%s", (char *) key, t->type);
+        if (t->encoding != NULL)
+            g_string_append_printf (buf, "\t%s", t->encoding);
+        g_string_append_c (buf, '\n');
+    }
+
+    file_name = ext_type_cache_get_file_name ();
+    g_file_set_contents (file_name, buf->str, buf->len, NULL);
+    g_free (file_name);
+
+    g_string_free (buf, TRUE);
+    type_cache_changed = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make key of type cache. Local files are identified by device, inode, size and
+ * modification time. Name is added for VFS files because their inode numbers are
+ * valid within the session only.
+ */
+
+static char *
+ext_type_cache_key (const char *filename, const struct stat *st, gboolean local)
+{
+    char *key;
+
+    key = g_strdup_printf ("%lu:%lu:%llu:%ld", (unsigned long) st->st_dev,
+                           (unsigned long) st->st_ino, (unsigned long long) st->st_size,
+                           (long) st->st_mtime);
+
+    if (!local)
+    {
+        char *tmp = key;
+
+        key = g_strconcat (tmp, ":", filename, (char *) NULL);
+        g_free (tmp);
+    }
+
+    return key;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_type_cache_add (char *key, const char *type, const char *encoding, gboolean local)
+{
+    ext_type_t *t;
+
+    if (g_hash_table_size (type_cache) >= EXT_TYPE_CACHE_MAX)
+        g_hash_table_remove_all (type_cache);
+
+    t = g_new (ext_type_t, 1);
+    /* tabs separate fields in the cache file */
+    t->type = g_strdelimit (g_strdup (type), "\t", ' ');
+    t->encoding = g_strdup (encoding);
+    t->persistent = local;
+    g_hash_table_replace (type_cache, key, t);
+
+    if (local)
+        type_cache_changed = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the output of "file" or libmagic describes the file rather than
+ * a failure to read it. Failures depend on permissions that can be changed without
+ * touching the file, so they must not be stored in type cache.
+ */
+
+static gboolean
+ext_type_is_detected (const char *type)
+{
+    return (type[0] != '\0' && strncmp (type, "cannot open", 11) != 0
+            && strncmp (type, "ERROR:", 6) != 0 && strstr (type, "no read permission") == NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Invoke the "file" command on the file and match its output against SEARCH.
+ * The result is taken from type cache if the file was not changed since it was detected.
+ * ST is NULL if the file cannot be stat'ed: type cache is not used then.
  * have_type is a flag that is set if we already have tried to determine
  * the type of that file.
  * Return 1 for match, 0 for no match, -1 errors.
  */
 
 static int
-regex_check_type (const char *filename, const char *ptr, int *have_type)
+regex_check_type (const char *filename, const struct stat *st, mc_search_t * search,
+                  int *have_type)
 {
     int found = 0;
 
@@ -501,83 +778,157 @@ regex_check_type (const char *filename, const char *ptr, int *have_type)
     {
         char *realname;         /* name used with "file" */
         char *localfile;
-
-#ifdef HAVE_CHARSET
-        int got_encoding_data;
-#endif /* HAVE_CHARSET */
+        char *key;
+        ext_type_t *cached;
+        gboolean local;
+        vfs_path_t *vpath;
+        int got_encoding_data = 0;
 
         /* Don't repeate even unsuccessful checks */
         *have_type = 1;
 
-        localfile = mc_getlocalcopy (filename);
-        if (localfile == NULL)
-            return -1;
+        if (type_cache == NULL)
+            ext_type_cache_load ();
 
-        realname = localfile;
+        vpath = vfs_path_from_str (filename);
+        local = vfs_file_is_local (vpath);
+        vfs_path_free (vpath);
+
+        key = NULL;
+        cached = NULL;
+        if (st != NULL)
+        {
+            key = ext_type_cache_key (filename, st, local);
+            cached = (ext_type_t *) g_hash_table_lookup (type_cache, key);
+        }
 
 #ifdef HAVE_CHARSET
-        got_encoding_data = is_autodetect_codeset_enabled
-            ? get_file_encoding_local (localfile, encoding_id, sizeof (encoding_id)) : 0;
+        /* encoding wasn't detected while autodetection was off */
+        if (cached != NULL && cached->encoding == NULL && is_autodetect_codeset_enabled)
+            cached = NULL;
+#endif
 
-        if (got_encoding_data > 0)
+        if (cached != NULL)
         {
-            char *pp;
-            int cp_id;
+            g_free (key);
 
-            pp = strchr (encoding_id, '\n');
-            if (pp != NULL)
-                *pp = '\0';
-
-            cp_id = get_codepage_index (encoding_id);
-            if (cp_id == -1)
-                cp_id = default_source_codepage;
+            g_strlcpy (content_string, cached->type, sizeof (content_string));
+            content_shift = 0;
+            got_data = 1;
 
-            do_set_codepage (cp_id);
-        }
+            encoding_id[0] = '\0';
+#ifdef HAVE_CHARSET
+            /* encoding detected earlier is applied only while autodetection is on */
+            if (cached->encoding != NULL && is_autodetect_codeset_enabled)
+            {
+                g_strlcpy (encoding_id, cached->encoding, sizeof (encoding_id));
+                got_encoding_data = encoding_id[0] != '\0' ? 1 : 0;
+            }
 #endif /* HAVE_CHARSET */
+        }
+        else
+        {
+            localfile = mc_getlocalcopy (filename);
+            if (localfile == NULL)
+            {
+                g_free (key);
+                return -1;
+            }
 
-        mc_ungetlocalcopy (filename, localfile, 0);
+            realname = localfile;
 
-        got_data = get_file_type_local (localfile, content_string, sizeof (content_string));
+#ifdef HAVE_CHARSET
+            if (is_autodetect_codeset_enabled)
+            {
+                got_encoding_data = get_file_encoding_local (localfile, encoding_id,
+                                                             sizeof (encoding_id));
+                if (got_encoding_data > 0)
+                {
+                    char *pp;
 
-        if (got_data > 0)
-        {
-            char *pp;
-            size_t real_len;
+                    pp = strchr (encoding_id, '\n');
+                    if (pp != NULL)
+                        *pp = '\0';
+                }
+                else
+                    encoding_id[0] = '\0';
+            }
+#endif /* HAVE_CHARSET */
+
+            got_data = get_file_type_local (localfile, content_string, sizeof (content_string));
 
-            pp = strchr (content_string, '\n');
-            if (pp != NULL)
-                *pp = '\0';
+            mc_ungetlocalcopy (filename, localfile, 0);
 
-            real_len = strlen (realname);
+            content_shift = 0;
 
-            if (strncmp (content_string, realname, real_len) == 0)
+            if (got_data > 0)
             {
-                /* Skip "realname: " */
-                content_shift = real_len;
-                if (content_string[content_shift] == ':')
+                char *pp;
+                size_t real_len;
+
+                pp = strchr (content_string, '\n');
+                if (pp != NULL)
+                    *pp = '\0';
+
+                real_len = strlen (realname);
+
+                if (strncmp (content_string, realname, real_len) == 0)
                 {
-                    /* Solaris' file prints tab(s) after ':' */
-                    for (content_shift++;
-                         content_string[content_shift] == ' '
-                         || content_string[content_shift] == '\t'; content_shift++)
-                        ;
+                    /* Skip "realname: " */
+                    content_shift = real_len;
+                    if (content_string[content_shift] == ':')
+                    {
+                        /* Solaris' file prints tab(s) after ':' */
+                        for (content_shift++;
+                             content_string[content_shift] == ' '
+                             || content_string[content_shift] == '\t'; content_shift++)
+                            ;
+                    }
                 }
             }
+            else
+            {
+                /* No data */
+                content_string[0] = '\0';
+            }
+            g_free (realname);
+
+            /* only successfully detected types are cached */
+            if (key != NULL && got_data > 0
+                && ext_type_is_detected (content_string + content_shift))
+                ext_type_cache_add (key, content_string + content_shift,
+#ifdef HAVE_CHARSET
+                                    is_autodetect_codeset_enabled ? encoding_id : NULL,
+#else
+                                    NULL,
+#endif
+                                    local);
+            else
+                g_free (key);
         }
-        else
+
+#ifdef HAVE_CHARSET
+        if (got_encoding_data > 0)
         {
-            /* No data */
-            content_string[0] = '\0';
+            int cp_id;
+
+            cp_id = get_codepage_index (encoding_id);
+            if (cp_id == -1)
+                cp_id = default_source_codepage;
+
+            do_set_codepage (cp_id);
         }
-        g_free (realname);
+#else
+        (void) got_encoding_data;
+#endif /* HAVE_CHARSET */
     }
 
     if (got_data == -1)
         return -1;
 
-    if (content_string[0] != '\0'
-        && mc_search (ptr, content_string + content_shift, MC_SEARCH_T_REGEX))
+    if (content_string[0] != '\0' && search != NULL
+        && mc_search_run (search, content_string + content_shift, 0,
+                          strlen (content_string + content_shift), NULL))
     {
         found = 1;
     }
@@ -585,6 +936,159 @@ regex_check_type (const char *filename, const char *ptr, int *have_type)
     return found;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static mc_search_t *
+ext_rule_compile_regex (const char *pattern)
+{
+    mc_search_t *search;
+
+    search = mc_search_new (pattern, -1);
+    if (search != NULL)
+    {
+        search->search_type = MC_SEARCH_T_REGEX;
+        search->is_case_sensitive = TRUE;
+    }
+
+    return search;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+ext_rule_match_regex (ext_rule_t * rule, const char *str)
+{
+    return rule->search != NULL && mc_search_run (rule->search, str, 0, strlen (str), NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ext_rules_free (void)
+{
+    guint i, j;
+
+    if (rules == NULL)
+        return;
+
+    for (i = 0; i < rules->len; i++)
+    {
+        ext_rule_t *rule = (ext_rule_t *) g_ptr_array_index (rules, i);
+
+        for (j = 0; j < rule->actions->len; j++)
+        {
+            ext_action_t *action = (ext_action_t *) g_ptr_array_index (rule->actions, j);
+
+            g_free (action->name);
+            g_free (action);
+        }
+        g_ptr_array_free (rule->actions, TRUE);
+        mc_search_free (rule->search);
+        g_free (rule->pattern);
+        g_free (rule);
+    }
+
+    g_ptr_array_free (rules, TRUE);
+    rules = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split the contents of mc.ext into sections and compile their patterns,
+ * so the file isn't parsed again for each file.
+ */
+
+static void
+ext_rules_compile (void)
+{
+    static const struct
+    {
+        const char *keyword;
+        ext_rule_type_t type;
+    } keywords[] =
+    {
+        /* *INDENT-OFF* */
+        { "regex/", EXT_RULE_REGEX },
+        { "directory/", EXT_RULE_DIRECTORY },
+        { "shell/", EXT_RULE_SHELL },
+        { "type/", EXT_RULE_TYPE },
+        { "include/", EXT_RULE_INCLUDE },
+        { "default/", EXT_RULE_DEFAULT },
+        { NULL, EXT_RULE_UNKNOWN }
+        /* *INDENT-ON* */
+    };
+
+    char *p, *q;
+    ext_rule_t *rule = NULL;
+
+    rules = g_ptr_array_new ();
+
+    for (p = data; *p != '\0'; p = (*q == '\0') ? q : q + 1)
+    {
+        q = strchr (p, '\n');
+        if (q == NULL)
+            q = strchr (p, '\0');
+
+        if (*p == '#')          /* comment */
+            continue;
+
+        if (*p == ' ' || *p == '\t')
+        {
+            /* List of actions */
+            char *r;
+            ext_action_t *action;
+
+            for (; *p == ' ' || *p == '\t'; p++)
+                ;
+
+            if (rule == NULL || p == q)
+                continue;
+
+            r = memchr (p, '=', q - p);
+            if (r == NULL)
+                continue;
+
+            action = g_new (ext_action_t, 1);
+            action->name = g_strndup (p, r - p);
+            action->command = r + 1;
+            g_ptr_array_add (rule->actions, action);
+        }
+        else if (p != q)
+        {
+            /* i.e. starts in the first column, should be keyword/descNL */
+            size_t i;
+
+            rule = g_new0 (ext_rule_t, 1);
+            rule->actions = g_ptr_array_new ();
+            g_ptr_array_add (rules, rule);
+
+            for (i = 0; keywords[i].keyword != NULL; i++)
+            {
+                size_t len = strlen (keywords[i].keyword);
+
+                if (strncmp (p, keywords[i].keyword, len) == 0)
+                {
+                    rule->type = keywords[i].type;
+                    rule->pattern = g_strndup (p + len, q - p - len);
+                    rule->pattern_len = q - p - len;
+                    break;
+                }
+            }
+
+            switch (rule->type)
+            {
+            case EXT_RULE_REGEX:
+            case EXT_RULE_DIRECTORY:
+            case EXT_RULE_TYPE:
+                rule->search = ext_rule_compile_regex (rule->pattern);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -592,8 +1096,25 @@ regex_check_type (const char *filename, const char *ptr, int *have_type)
 void
 flush_extension_file (void)
 {
+    ext_rules_free ();
     g_free (data);
     data = NULL;
+
+    if (type_cache != NULL)
+    {
+        ext_type_cache_save ();
+        g_hash_table_destroy (type_cache);
+        type_cache = NULL;
+    }
+
+#ifdef HAVE_LIBMAGIC
+    if (magic_cookie != NULL)
+    {
+        magic_close (magic_cookie);
+        magic_cookie = NULL;
+    }
+    magic_failed = FALSE;
+#endif
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -613,16 +1134,16 @@ flush_extension_file (void)
 int
 regex_command (const char *filename, const char *action, int *move_dir)
 {
-    char *p, *q, *r, c;
-    int file_len = strlen (filename);
-    int found = 0;
+    size_t file_len = strlen (filename);
     int error_flag = 0;
     int ret = 0;
     struct stat mystat;
+    const struct stat *st;
     int view_at_line_number;
-    char *include_target;
-    int include_target_len;
+    const char *include_target;
+    size_t include_target_len;
     int have_type = 0;          /* Flag used by regex_check_type() */
+    guint i, j;
 
     /* Check for the special View:%d parameter */
     if (strncmp (action, "View:", 5) == 0)
@@ -698,152 +1219,108 @@ regex_command (const char *filename, const char *action, int *move_dir)
                      mc_global.sysconfig_dir);
             g_free (title);
         }
+
+        ext_rules_compile ();
     }
-    mc_stat (filename, &mystat);
+    st = mc_stat (filename, &mystat) == 0 ? &mystat : NULL;
 
     include_target = NULL;
     include_target_len = 0;
-    for (p = data; *p; p++)
+    for (i = 0; i < rules->len; i++)
     {
-        for (q = p; *q == ' ' || *q == '\t'; q++);
-        if (*q == '\n' || !*q)
-            p = q;              /* empty line */
-        if (*p == '#')          /* comment */
-            while (*p && *p != '\n')
-                p++;
-        if (*p == '\n')
-            continue;
-        if (!*p)
-            break;
-        if (p == q)
-        {                       /* i.e. starts in the first column, should be
-                                 * keyword/descNL
-                                 */
-            found = 0;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, 0);
-            c = *q;
-            *q = 0;
-            if (include_target)
-            {
-                if ((strncmp (p, "include/", 8) == 0)
-                    && (strncmp (p + 8, include_target, include_target_len) == 0))
-                    found = 1;
-            }
-            else if (!strncmp (p, "regex/", 6))
-            {
-                p += 6;
-                /* Do not transform shell patterns, you can use shell/ for
-                 * that
-                 */
-                if (mc_search (p, filename, MC_SEARCH_T_REGEX))
-                    found = 1;
-            }
-            else if (!strncmp (p, "directory/", 10))
-            {
-                if (S_ISDIR (mystat.st_mode) && mc_search (p + 10, filename, MC_SEARCH_T_REGEX))
-                    found = 1;
-            }
-            else if (!strncmp (p, "shell/", 6))
+        ext_rule_t *rule = (ext_rule_t *) g_ptr_array_index (rules, i);
+        gboolean found = FALSE;
+
+        if (include_target != NULL)
+        {
+            found = (rule->type == EXT_RULE_INCLUDE
+                     && strncmp (rule->pattern, include_target, include_target_len) == 0);
+        }
+        else
+        {
+            switch (rule->type)
             {
-                p += 6;
-                if (*p == '.' && file_len >= (q - p))
-                {
-                    if (!strncmp (p, filename + file_len - (q - p), q - p))
-                        found = 1;
-                }
+            case EXT_RULE_REGEX:
+                /* Do not transform shell patterns, you can use shell/ for that */
+                found = ext_rule_match_regex (rule, filename);
+                break;
+            case EXT_RULE_DIRECTORY:
+                found = st != NULL && S_ISDIR (st->st_mode)
+                    && ext_rule_match_regex (rule, filename);
+                break;
+            case EXT_RULE_SHELL:
+                if (rule->pattern[0] == '.')
+                    found = file_len >= rule->pattern_len
+                        && strcmp (rule->pattern, filename + file_len - rule->pattern_len) == 0;
                 else
+                    found = strcmp (rule->pattern, filename) == 0;
+                break;
+            case EXT_RULE_TYPE:
                 {
-                    if (q - p == file_len && !strncmp (p, filename, q - p))
-                        found = 1;
+                    int res;
+
+                    res = regex_check_type (filename, st, rule->search, &have_type);
+                    if (res == 1)
+                        found = TRUE;
+                    if (res == -1)
+                        error_flag = 1; /* leave it if file cannot be opened */
                 }
+                break;
+            case EXT_RULE_DEFAULT:
+                found = TRUE;
+                break;
+            default:
+                break;
             }
-            else if (!strncmp (p, "type/", 5))
-            {
-                int res;
-                p += 5;
-                res = regex_check_type (filename, p, &have_type);
-                if (res == 1)
-                    found = 1;
-                if (res == -1)
-                    error_flag = 1;     /* leave it if file cannot be opened */
-            }
-            else if (!strncmp (p, "default/", 8))
+        }
+
+        if (error_flag)
+            break;
+
+        if (!found)
+            continue;
+
+        for (j = 0; j < rule->actions->len; j++)
+        {
+            ext_action_t *a = (ext_action_t *) g_ptr_array_index (rule->actions, j);
+            const char *p;
+
+            if (strcmp (a->name, "Include") == 0)
             {
-                found = 1;
-            }
-            *q = c;
-            p = q;
-            if (!*p)
+                /* rest of this section is skipped, the include/ section is searched for */
+                include_target = a->command;
+                include_target_len = strcspn (include_target, "\n");
                 break;
-        }
-        else
-        {                       /* List of actions */
-            p = q;
-            q = strchr (p, '\n');
-            if (q == NULL)
-                q = strchr (p, 0);
-            if (found && !error_flag)
+            }
+
+            if (strcmp (action, a->name) != 0)
+                continue;
+
+            for (p = a->command; *p == ' ' || *p == '\t'; p++)
+                ;
+
+            /* Empty commands just stop searching
+             * through, they don't do anything
+             *
+             * We need to copy the filename because exec_extension
+             * may end up invoking update_panels thus making the
+             * filename parameter invalid (ie, most of the time,
+             * we get filename as a pointer from current_panel->dir).
+             */
+            if (*p != '\n' && *p != '\0')
             {
-                r = strchr (p, '=');
-                if (r != NULL)
-                {
-                    c = *r;
-                    *r = 0;
-                    if (strcmp (p, "Include") == 0)
-                    {
-                        char *t;
-
-                        include_target = p + 8;
-                        t = strchr (include_target, '\n');
-                        if (t)
-                            *t = 0;
-                        include_target_len = strlen (include_target);
-                        if (t)
-                            *t = '\n';
-
-                        *r = c;
-                        p = q;
-                        found = 0;
-
-                        if (!*p)
-                            break;
-                        continue;
-                    }
-                    if (!strcmp (action, p))
-                    {
-                        *r = c;
-                        for (p = r + 1; *p == ' ' || *p == '\t'; p++);
-
-                        /* Empty commands just stop searching
-                         * through, they don't do anything
-                         *
-                         * We need to copy the filename because exec_extension
-                         * may end up invoking update_panels thus making the
-                         * filename parameter invalid (ie, most of the time,
-                         * we get filename as a pointer from current_panel->dir).
-                         */
-                        if (p < q)
-                        {
-                            char *filename_copy = g_strdup (filename);
+                char *filename_copy = g_strdup (filename);
 
-                            exec_extension (filename_copy, r + 1, move_dir, view_at_line_number);
-                            g_free (filename_copy);
+                exec_extension (filename_copy, a->command, move_dir, view_at_line_number);
+                g_free (filename_copy);
 
-                            ret = 1;
-                        }
-                        break;
-                    }
-                    else
-                        *r = c;
-                }
+                ret = 1;
             }
-            p = q;
-            if (!*p)
-                break;
+            goto done;
         }
     }
+
+  done:
     if (error_flag)
         return -1;
     return ret;
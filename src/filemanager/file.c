@@ -103,6 +103,9 @@ const char *op_names[3] = {
 #define FILEOP_UPDATE_INTERVAL 2
 #define FILEOP_STALLING_INTERVAL 4
 
+/* limit of names stored in the cache of compute_dir_size() */
+#define DIR_SIZE_CACHE_MAX_NAMES 262144
+
 /*** file scope type declarations ****************************************************************/
 
 /* This is a hard link cache */
@@ -117,6 +120,20 @@ struct link
     char name[1];
 };
 
+/* Cached contents of directory for compute_dir_size(), valid while mtime is the same.
+   Files can grow in place without change of directory mtime, so their sizes are not cached */
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+    time_t mtime;
+    size_t n_names;             /* number of names in files and subdirs */
+    size_t count;               /* number of entries, except subdirectories */
+    uintmax_t total;            /* size of entries, except subdirectories */
+    char **files;               /* names of entries, except subdirectories */
+    char **subdirs;             /* names of subdirectories */
+} dir_size_cache_t;
+
 /* Status of the destination file */
 typedef enum
 {
@@ -172,6 +189,9 @@ static const char *question_format = N_("%s?");
 /* the hard link cache */
 static struct link *linklist = NULL;
 
+/* panel_operate() walks the file list of panel, it must not be changed meanwhile */
+static gboolean panel_operate_running = FALSE;
+
 /* the files-to-be-erased list */
 static struct link *erase_list;
 
@@ -189,6 +209,11 @@ static struct link *dest_dirs = NULL;
 
 static FileProgressStatus transform_error = FILE_CONT;
 
+/* directories of local file system scanned by compute_dir_size() */
+static GHashTable *dir_size_cache = NULL;
+/* number of names stored in dir_size_cache */
+static size_t dir_size_cache_names = 0;
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
@@ -1292,6 +1317,236 @@ end_bg_process (FileOpContext * ctx, enum OperationMode mode)
 #endif
 /* }}} */
 
+/* --------------------------------------------------------------------------------------------- */
+
+static guint
+dir_size_cache_hash (gconstpointer v)
+{
+    const dir_size_cache_t *c = (const dir_size_cache_t *) v;
+
+    return (guint) c->ino ^ ((guint) c->dev << 16);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_size_cache_equal (gconstpointer v1, gconstpointer v2)
+{
+    const dir_size_cache_t *c1 = (const dir_size_cache_t *) v1;
+    const dir_size_cache_t *c2 = (const dir_size_cache_t *) v2;
+
+    return (c1->ino == c2->ino && c1->dev == c2->dev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_cache_free (gpointer data)
+{
+    dir_size_cache_t *c = (dir_size_cache_t *) data;
+
+    g_strfreev (c->files);
+    g_strfreev (c->subdirs);
+    g_free (c);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the directory: count entries except subdirectories and collect names of entries.
+ * Return NULL if the directory cannot be read or the user aborted the operation.
+ */
+
+static dir_size_cache_t *
+dir_size_scan (const char *dirname, const void *ui, compute_dir_size_callback cback,
+               FileProgressStatus * ret)
+{
+    DIR *dir;
+    struct dirent *dirent;
+    dir_size_cache_t *c;
+    GPtrArray *files, *subdirs;
+
+    dir = mc_opendir (dirname);
+    if (dir == NULL)
+        return NULL;
+
+    c = g_new0 (dir_size_cache_t, 1);
+    files = g_ptr_array_new ();
+    subdirs = g_ptr_array_new ();
+
+    while ((dirent = mc_readdir (dir)) != NULL)
+    {
+        char *fullname;
+        struct stat s;
+
+        *ret = (cback != NULL) ? cback (ui, dirname) : FILE_CONT;
+
+        if (*ret != FILE_CONT)
+            break;
+
+        if (strcmp (dirent->d_name, ".") == 0)
+            continue;
+        if (strcmp (dirent->d_name, "..") == 0)
+            continue;
+
+        fullname = concat_dir_and_file (dirname, dirent->d_name);
+        if (mc_lstat (fullname, &s) == 0)
+        {
+            if (S_ISDIR (s.st_mode))
+                g_ptr_array_add (subdirs, g_strdup (dirent->d_name));
+            else
+            {
+                g_ptr_array_add (files, g_strdup (dirent->d_name));
+                c->count++;
+                c->total += (uintmax_t) s.st_size;
+            }
+        }
+        g_free (fullname);
+    }
+
+    mc_closedir (dir);
+
+    c->n_names = files->len + subdirs->len;
+    g_ptr_array_add (files, NULL);
+    c->files = (char **) g_ptr_array_free (files, FALSE);
+    g_ptr_array_add (subdirs, NULL);
+    c->subdirs = (char **) g_ptr_array_free (subdirs, FALSE);
+
+    if (*ret != FILE_CONT)
+    {
+        dir_size_cache_free (c);
+        c = NULL;
+    }
+
+    return c;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count the cached entries of directory again: the list of names is valid, but sizes of files
+ * could be changed in place.
+ */
+
+static FileProgressStatus
+dir_size_restat (const char *dirname, dir_size_cache_t * c, const void *ui,
+                 compute_dir_size_callback cback)
+{
+    char **file;
+
+    c->count = 0;
+    c->total = 0;
+
+    for (file = c->files; *file != NULL; file++)
+    {
+        FileProgressStatus ret;
+        char *fullname;
+        struct stat s;
+
+        ret = (cback != NULL) ? cback (ui, dirname) : FILE_CONT;
+        if (ret != FILE_CONT)
+            return ret;
+
+        fullname = concat_dir_and_file (dirname, *file);
+        if (mc_lstat (fullname, &s) == 0 && !S_ISDIR (s.st_mode))
+        {
+            c->count++;
+            c->total += (uintmax_t) s.st_size;
+        }
+        g_free (fullname);
+    }
+
+    return FILE_CONT;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compute size of directory. Lists of entries of directories on local file system are cached:
+ * unchanged directories (same device, inode and mtime) are not read again, only their files
+ * are stat'ed. The cache is limited to DIR_SIZE_CACHE_MAX_NAMES names.
+ */
+
+static FileProgressStatus
+compute_dir_size_int (const char *dirname, const void *ui, compute_dir_size_callback cback,
+                      size_t * ret_marked, uintmax_t * ret_total)
+{
+    dir_size_cache_t *c = NULL;
+    gboolean cached = FALSE;
+    struct stat s;
+    FileProgressStatus ret = FILE_CONT;
+    char **subdir;
+
+    if (mc_stat (dirname, &s) == 0)
+    {
+        vfs_path_t *vpath;
+
+        vpath = vfs_path_from_str (dirname);
+        cached = vfs_file_is_local (vpath);
+        vfs_path_free (vpath);
+    }
+
+    if (cached)
+    {
+        dir_size_cache_t key;
+
+        if (dir_size_cache == NULL)
+            dir_size_cache = g_hash_table_new_full (dir_size_cache_hash, dir_size_cache_equal,
+                                                    NULL, dir_size_cache_free);
+
+        key.dev = s.st_dev;
+        key.ino = s.st_ino;
+        c = (dir_size_cache_t *) g_hash_table_lookup (dir_size_cache, &key);
+        if (c != NULL && c->mtime != s.st_mtime)
+        {
+            dir_size_cache_names -= c->n_names;
+            g_hash_table_remove (dir_size_cache, c);
+            c = NULL;
+        }
+
+        if (c != NULL)
+        {
+            ret = dir_size_restat (dirname, c, ui, cback);
+            if (ret != FILE_CONT)
+                return ret;
+        }
+    }
+
+    if (c == NULL)
+    {
+        c = dir_size_scan (dirname, ui, cback, &ret);
+        if (c == NULL)
+            return ret;
+
+        /* don't grow the cache beyond the limit: just forget the directory after use */
+        if (cached && dir_size_cache_names + c->n_names > DIR_SIZE_CACHE_MAX_NAMES)
+            cached = FALSE;
+
+        if (cached)
+        {
+            c->dev = s.st_dev;
+            c->ino = s.st_ino;
+            c->mtime = s.st_mtime;
+            dir_size_cache_names += c->n_names;
+            g_hash_table_insert (dir_size_cache, c, c);
+        }
+    }
+
+    *ret_marked += c->count;
+    *ret_total += c->total;
+
+    for (subdir = c->subdirs; ret == FILE_CONT && *subdir != NULL; subdir++)
+    {
+        char *fullname;
+
+        fullname = concat_dir_and_file (dirname, *subdir);
+        ret = compute_dir_size_int (fullname, ui, cback, ret_marked, ret_total);
+        g_free (fullname);
+    }
+
+    if (!cached)
+        dir_size_cache_free (c);
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1758,6 +2013,7 @@ copy_dir_dir (FileOpTotalContext * tctx, FileOpContext * ctx, const char *s, con
     struct utimbuf utb;
     struct link *lp;
     char *d;
+    vfs_path_t *src_vpath;
 
     d = g_strdup (_d);
 
@@ -1893,13 +2149,18 @@ copy_dir_dir (FileOpTotalContext * tctx, FileOpContext * ctx, const char *s, con
 
   dont_mkdir:
     /* open the source dir for reading */
-    reading = mc_opendir (s);
+    src_vpath = vfs_path_from_str (s);
+    reading = mc_opendir_vpath (src_vpath);
     if (reading == NULL)
+    {
+        vfs_path_free (src_vpath);
         goto ret;
+    }
 
     while ((next = mc_readdir (reading)) && return_status != FILE_ABORT)
     {
         char *path;
+        vfs_path_t *vpath;
         /*
          * Now, we don't want '.' and '..' to be created / copied at any time
          */
@@ -1910,8 +2171,10 @@ copy_dir_dir (FileOpTotalContext * tctx, FileOpContext * ctx, const char *s, con
 
         /* get the filename and add it to the src directory */
         path = concat_dir_and_file (s, next->d_name);
-
-        (*ctx->stat_func) (path, &buf);
+        /* don't parse the whole path again for every entry */
+        vpath = vfs_path_append_new (src_vpath, next->d_name);
+        (*ctx->stat_vpath_func) (vpath, &buf);
+        vfs_path_free (vpath);
         if (S_ISDIR (buf.st_mode))
         {
             char *mdpath;
@@ -1966,6 +2229,7 @@ copy_dir_dir (FileOpTotalContext * tctx, FileOpContext * ctx, const char *s, con
         g_free (path);
     }
     mc_closedir (reading);
+    vfs_path_free (src_vpath);
 
     if (ctx->preserve)
     {
@@ -2255,85 +2519,40 @@ compute_dir_size (const char *dirname, const void *ui,
                   compute_dir_size_callback cback,
                   size_t * ret_marked, uintmax_t * ret_total, gboolean compute_symlinks)
 {
-    int res;
-    struct stat s;
-    DIR *dir;
-    struct dirent *dirent;
-    FileProgressStatus ret = FILE_CONT;
-
     if (!compute_symlinks)
     {
-        res = mc_lstat (dirname, &s);
-        if (res != 0)
-            return ret;
+        struct stat s;
+
+        if (mc_lstat (dirname, &s) != 0)
+            return FILE_CONT;
 
         /* don't scan symlink to directory */
         if (S_ISLNK (s.st_mode))
         {
             (*ret_marked)++;
             *ret_total += (uintmax_t) s.st_size;
-            return ret;
+            return FILE_CONT;
         }
     }
 
-    dir = mc_opendir (dirname);
+    return compute_dir_size_int (dirname, ui, cback, ret_marked, ret_total);
+}
 
-    if (dir == NULL)
-        return ret;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget contents of directories cached by compute_dir_size(). The cache is cleared after
+ * file operations and explicit reread of panels to free memory.
+ */
 
-    while ((dirent = mc_readdir (dir)) != NULL)
+void
+compute_dir_size_clear_cache (void)
+{
+    if (dir_size_cache != NULL)
     {
-        char *fullname;
-
-        ret = (cback != NULL) ? cback (ui, dirname) : FILE_CONT;
-
-        if (ret != FILE_CONT)
-            break;
-
-        if (strcmp (dirent->d_name, ".") == 0)
-            continue;
-        if (strcmp (dirent->d_name, "..") == 0)
-            continue;
-
-        fullname = concat_dir_and_file (dirname, dirent->d_name);
-        res = mc_lstat (fullname, &s);
-
-        if (res != 0)
-        {
-            g_free (fullname);
-            continue;
-        }
-
-        if (S_ISDIR (s.st_mode))
-        {
-            size_t subdir_count = 0;
-            uintmax_t subdir_bytes = 0;
-
-            ret =
-                compute_dir_size (fullname, ui, cback, &subdir_count, &subdir_bytes,
-                                  compute_symlinks);
-
-            if (ret != FILE_CONT)
-            {
-                g_free (fullname);
-                break;
-            }
-
-            *ret_marked += subdir_count;
-            *ret_total += subdir_bytes;
-        }
-        else
-        {
-            (*ret_marked)++;
-            *ret_total += (uintmax_t) s.st_size;
-        }
-
-        g_free (fullname);
+        g_hash_table_destroy (dir_size_cache);
+        dir_size_cache = NULL;
     }
-
-    mc_closedir (dir);
-
-    return ret;
+    dir_size_cache_names = 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -2417,6 +2636,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     }
 
     ctx = file_op_context_new (operation);
+    panel_operate_running = TRUE;
 
     /* Show confirmation dialog */
     if (operation != OP_DELETE)
@@ -2542,6 +2762,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
             mc_setctl (panel->cwd, VFS_SETCTL_FORGET, NULL);
             mc_setctl (dest, VFS_SETCTL_FORGET, NULL);
             /*          file_op_context_destroy (ctx); */
+            panel_operate_running = FALSE;
             return FALSE;
         }
     }
@@ -2770,6 +2991,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
     free_linklist (&linklist);
     free_linklist (&dest_dirs);
+    compute_dir_size_clear_cache ();
 #ifdef WITH_FULL_PATHS
     g_free (source_with_path);
 #endif /* WITH_FULL_PATHS */
@@ -2795,10 +3017,20 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     file_op_total_context_destroy (tctx);
   ret_fast:
     file_op_context_destroy (ctx);
+    panel_operate_running = FALSE;
 
     return ret_val;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Return TRUE while panel_operate() is in progress, e.g. its dialogs wait for input */
+
+gboolean
+panel_operate_is_running (void)
+{
+    return panel_operate_running;
+}
+
 /* }}} */
 
 /* --------------------------------------------------------------------------------------------- */
@@ -46,6 +46,7 @@ FileProgressStatus copy_dir_dir (FileOpTotalContext * tctx, FileOpContext * ctx,
 FileProgressStatus erase_dir (FileOpTotalContext * tctx, FileOpContext * ctx, const char *s);
 
 gboolean panel_operate (void *source_panel, FileOperation op, gboolean force_single);
+gboolean panel_operate_is_running (void);
 
 /* Error reporting routines */
 
@@ -57,6 +58,7 @@ FileProgressStatus compute_dir_size (const char *dirname, const void *ui,
                                      compute_dir_size_callback cback,
                                      size_t * ret_marked, uintmax_t *ret_total,
                                      gboolean compute_symlinks);
+void compute_dir_size_clear_cache (void);
 
 ComputeDirSizeUI *compute_dir_size_create_ui (void);
 void compute_dir_size_destroy_ui (ComputeDirSizeUI * ui);
@@ -1064,9 +1064,15 @@ file_mask_dialog (FileOpContext * ctx, FileOperation operation,
         }
 
         if (ctx->follow_links)
+        {
             ctx->stat_func = mc_stat;
+            ctx->stat_vpath_func = mc_stat_vpath;
+        }
         else
+        {
             ctx->stat_func = mc_lstat;
+            ctx->stat_vpath_func = mc_lstat_vpath;
+        }
 
         if (ctx->op_preserve)
         {
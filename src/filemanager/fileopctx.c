@@ -77,6 +77,7 @@ file_op_context_new (FileOperation op)
     ctx->op_preserve = TRUE;
     ctx->do_reget = 1;
     ctx->stat_func = mc_lstat;
+    ctx->stat_vpath_func = mc_lstat_vpath;
     ctx->preserve = TRUE;
     ctx->preserve_uidgid = (geteuid () == 0);
     ctx->umask_kill = 0777777;
@@ -20,11 +20,13 @@
 #include <inttypes.h>           /* uintmax_t */
 
 #include "lib/global.h"
+#include "lib/vfs/vfs.h"
 
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
 typedef int (*mc_stat_fn) (const char *filename, struct stat * buf);
+typedef int (*mc_stat_vpath_fn) (const vfs_path_t * vpath, struct stat * buf);
 
 /*** enums ***************************************************************************************/
 
@@ -117,6 +119,8 @@ typedef struct FileOpContext
 
     /* Pointer to the stat function we will use */
     mc_stat_fn stat_func;
+    /* The same for already parsed paths */
+    mc_stat_vpath_fn stat_vpath_func;
 
     /* Whether to recompute symlinks */
     gboolean stable_symlinks;
@@ -58,6 +58,7 @@
 #include "midnight.h"           /* current_panel */
 #include "boxes.h"
 #include "panelize.h"
+#include "findindex.h"
 
 #include "find.h"
 
@@ -89,6 +90,14 @@ typedef enum
     FIND_ABORT
 } FindProgressStatus;
 
+/* Line of the list of found files: the directory or the file in it.
+   The listbox is virtual, these records are the only copy of the list. */
+typedef struct
+{
+    char *text;                 /* "    file" or "    line:file", NULL for the directory line */
+    const char *dir;            /* directory, owned by found_dirs */
+} find_hit_t;
+
 /* find file options */
 typedef struct
 {
@@ -98,6 +107,7 @@ typedef struct
     gboolean find_recurs;
     gboolean skip_hidden;
     gboolean file_all_charsets;
+    gboolean file_use_index;
 
     /* file content options */
     gboolean content_use;
@@ -138,6 +148,7 @@ static WCheck *file_case_sens_cbox;     /* "case sensitive" checkbox */
 static WCheck *file_pattern_cbox;       /* File name is glob or regexp */
 static WCheck *recursively_cbox;
 static WCheck *skip_hidden_cbox;
+static WCheck *use_index_cbox;  /* "Use index" checkbox */
 static WCheck *content_use_cbox;        /* Take into account the Content field */
 static WCheck *content_case_sens_cbox;  /* "case sensitive" checkbox */
 static WCheck *content_regexp_cbox;     /* "find regular expression" checkbox */
@@ -156,7 +167,9 @@ static char *content_pattern = NULL;    /* pattern to search inside files; if
                                            regex pattern, else the search string. */
 static unsigned long matches;   /* Number of matches */
 static gboolean is_start = FALSE;       /* Status of the start/stop toggle button */
-static char *old_dir = NULL;
+
+static GArray *found_hits = NULL;       /* lines of find_list (find_hit_t) */
+static GPtrArray *found_dirs = NULL;    /* directories of found files */
 
 /* Where did we stop */
 static int resuming;
@@ -184,6 +197,16 @@ typedef struct dir_stack
 static dir_stack *dir_stack_base = 0;
 #endif /* GLIB_CHECK_VERSION */
 
+/* Directory being searched: either read from the disk or taken from the index */
+static DIR *dirp = NULL;
+static const find_index_dir_t *index_dir = NULL;
+static gsize index_pos = 0;
+static const char *entry_name = NULL;   /* current entry of directory */
+static char entry_type = FIND_INDEX_UNKNOWN;    /* file, directory or unknown yet */
+
+/* File name index of the start directory */
+static find_index_t *find_index = NULL;
+
 /* *INDENT-OFF* */
 static struct
 {
@@ -204,7 +227,7 @@ static struct
 /* *INDENT-ON* */
 
 static find_file_options_t options = {
-    TRUE, TRUE, TRUE, FALSE, FALSE,
+    TRUE, TRUE, TRUE, FALSE, FALSE, FALSE,
     FALSE, TRUE, FALSE, FALSE, FALSE, FALSE
 };
 
@@ -283,6 +306,8 @@ find_load_options (void)
         mc_config_get_bool (mc_main_config, "FindFile", "file_skip_hidden", FALSE);
     options.file_all_charsets =
         mc_config_get_bool (mc_main_config, "FindFile", "file_all_charsets", FALSE);
+    options.file_use_index =
+        mc_config_get_bool (mc_main_config, "FindFile", "file_use_index", FALSE);
     options.content_use = mc_config_get_bool (mc_main_config, "FindFile", "content_use", TRUE);
     options.content_case_sens =
         mc_config_get_bool (mc_main_config, "FindFile", "content_case_sens", TRUE);
@@ -328,6 +353,7 @@ find_save_options (void)
     mc_config_set_bool (mc_main_config, "FindFile", "file_find_recurs", options.find_recurs);
     mc_config_set_bool (mc_main_config, "FindFile", "file_skip_hidden", options.skip_hidden);
     mc_config_set_bool (mc_main_config, "FindFile", "file_all_charsets", options.file_all_charsets);
+    mc_config_set_bool (mc_main_config, "FindFile", "file_use_index", options.file_use_index);
     mc_config_set_bool (mc_main_config, "FindFile", "content_use", options.content_use);
     mc_config_set_bool (mc_main_config, "FindFile", "content_case_sens", options.content_case_sens);
     mc_config_set_bool (mc_main_config, "FindFile", "content_regexp", options.content_regexp);
@@ -343,10 +369,52 @@ find_save_options (void)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static inline char *
-add_to_list (const char *text, void *data)
+/** Supplies text of the line of virtual find_list */
+
+static const char *
+found_hit_get_text (WListbox * l, int index)
 {
-    return listbox_add_item (find_list, LISTBOX_APPEND_AT_END, 0, text, data);
+    const find_hit_t *hit = &g_array_index (found_hits, find_hit_t, index);
+
+    (void) l;
+
+    return hit->text != NULL ? hit->text : hit->dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+found_hits_free (void)
+{
+    guint i;
+
+    if (found_hits != NULL)
+    {
+        for (i = 0; i < found_hits->len; i++)
+            g_free (g_array_index (found_hits, find_hit_t, i).text);
+        g_array_free (found_hits, TRUE);
+        found_hits = NULL;
+    }
+
+    if (found_dirs != NULL)
+    {
+        g_ptr_array_foreach (found_dirs, (GFunc) g_free, NULL);
+        g_ptr_array_free (found_dirs, TRUE);
+        found_dirs = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+add_to_list (char *text, const char *dir)
+{
+    find_hit_t hit;
+
+    hit.text = text;
+    hit.dir = dir;
+    g_array_append_val (found_hits, hit);
+    listbox_set_virtual (find_list, (int) found_hits->len, found_hit_get_text);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -377,10 +445,27 @@ found_num_update (void)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/** Get the text of current line and the directory of file, NULL for the directory line */
+
 static void
 get_list_info (char **file, char **dir)
 {
-    listbox_get_current (find_list, file, (void **) dir);
+    const find_hit_t *hit;
+
+    *file = NULL;
+    *dir = NULL;
+
+    if (found_hits == NULL || find_list->pos < 0 || (guint) find_list->pos >= found_hits->len)
+        return;
+
+    hit = &g_array_index (found_hits, find_hit_t, find_list->pos);
+    if (hit->text == NULL)
+        *file = (char *) hit->dir;
+    else
+    {
+        *file = hit->text;
+        *dir = (char *) hit->dir;
+    }
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -508,6 +593,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
     const char *file_pattern_label = N_("&Using shell patterns");
     const char *file_recurs_label = N_("&Find recursively");
     const char *file_skip_hidden_label = N_("S&kip hidden");
+    const char *file_use_index_label = N_("Use inde&x");
 #ifdef HAVE_CHARSET
     const char *file_all_charsets_label = N_("&All charsets");
 #endif
@@ -539,6 +625,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
         file_pattern_label = _(file_pattern_label);
         file_recurs_label = _(file_recurs_label);
         file_skip_hidden_label = _(file_skip_hidden_label);
+        file_use_index_label = _(file_use_index_label);
 #ifdef HAVE_CHARSET
         file_all_charsets_label = _(file_all_charsets_label);
         content_all_charsets_label = _(content_all_charsets_label);
@@ -604,6 +691,9 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
     widget_disable (content_regexp_cbox->widget, disable);
     add_widget (find_dlg, content_regexp_cbox);
 
+    use_index_cbox = check_new (FIND_Y - 5, 3, options.file_use_index, file_use_index_label);
+    add_widget (find_dlg, use_index_cbox);
+
     cbox_position = FIND_Y - 6;
 
     skip_hidden_cbox = check_new (cbox_position--, 3, options.skip_hidden, file_skip_hidden_label);
@@ -706,6 +796,7 @@ find_parameters (char **start_dir, ssize_t * start_dir_len,
             options.file_pattern = file_pattern_cbox->state & C_BOOL;
             options.file_case_sens = file_case_sens_cbox->state & C_BOOL;
             options.skip_hidden = skip_hidden_cbox->state & C_BOOL;
+            options.file_use_index = use_index_cbox->state & C_BOOL;
             options.ignore_dirs_enable = ignore_dirs_cbox->state & C_BOOL;
             g_free (options.ignore_dirs);
             options.ignore_dirs = g_strdup (in_ignore->buffer);
@@ -836,30 +927,22 @@ clear_stack (void)
 static void
 insert_file (const char *dir, const char *file)
 {
-    char *tmp_name = NULL;
-    static char *dirname = NULL;
+    const char *dirname = NULL;
 
     while (dir[0] == PATH_SEP && dir[1] == PATH_SEP)
         dir++;
 
-    if (old_dir)
-    {
-        if (strcmp (old_dir, dir))
-        {
-            g_free (old_dir);
-            old_dir = g_strdup (dir);
-            dirname = add_to_list (dir, NULL);
-        }
-    }
-    else
+    if (found_dirs->len != 0)
+        dirname = (const char *) g_ptr_array_index (found_dirs, found_dirs->len - 1);
+
+    if (dirname == NULL || strcmp (dirname, dir) != 0)
     {
-        old_dir = g_strdup (dir);
-        dirname = add_to_list (dir, NULL);
+        dirname = g_strdup (dir);
+        g_ptr_array_add (found_dirs, (gpointer) dirname);
+        add_to_list (NULL, dirname);
     }
 
-    tmp_name = g_strdup_printf ("    %s", file);
-    add_to_list (tmp_name, dirname);
-    g_free (tmp_name);
+    add_to_list (g_strdup_printf ("    %s", file), dirname);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1150,13 +1233,77 @@ find_rotate_dash (const Dlg_head * h, gboolean finish)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Close the current directory and forget its incomplete index record */
+
+static void
+find_close_dir (void)
+{
+    if (dirp != NULL)
+    {
+        mc_closedir (dirp);
+        dirp = NULL;
+    }
+
+    index_dir = NULL;
+    entry_name = NULL;
+    find_index_dir_abort (find_index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read the next valid entry of the current directory either from the index or from the disk */
+
+static const char *
+find_read_entry (void)
+{
+    if (index_dir != NULL)
+    {
+        /* skip invalid filenames */
+        while ((entry_name = find_index_dir_next (index_dir, &index_pos, &entry_type)) != NULL
+               && !str_is_valid_string (entry_name))
+            ;
+    }
+    else
+    {
+        struct dirent *dp;
+
+        /* skip invalid filenames */
+        while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
+            ;
+
+        if (dp != NULL)
+        {
+            entry_name = dp->d_name;
+            entry_type = FIND_INDEX_UNKNOWN;
+        }
+        else
+        {
+            /* whole directory is read, its listing can be reused */
+            entry_name = NULL;
+            find_index_dir_commit (find_index);
+        }
+    }
+
+    return entry_name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Record the current entry in the index and go to the next one */
+
+static const char *
+find_next_entry (void)
+{
+    if (index_dir == NULL && strcmp (entry_name, ".") != 0 && strcmp (entry_name, "..") != 0)
+        find_index_dir_add (find_index, entry_name, entry_type);
+
+    return find_read_entry ();
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
 do_search (Dlg_head * h)
 {
-    static struct dirent *dp = NULL;
-    static DIR *dirp = NULL;
     static char *directory = NULL;
     struct stat tmp_stat;
     static int subdirs_left = 0;
@@ -1165,30 +1312,22 @@ do_search (Dlg_head * h)
 
     if (h == NULL)
     {                           /* someone forces me to close dirp */
-        if (dirp != NULL)
-        {
-            mc_closedir (dirp);
-            dirp = NULL;
-        }
+        find_close_dir ();
         g_free (directory);
         directory = NULL;
-        dp = NULL;
         return 1;
     }
 
     for (count = 0; count < 32; count++)
     {
-        while (dp == NULL)
+        while (entry_name == NULL)
         {
-            if (dirp != NULL)
-            {
-                mc_closedir (dirp);
-                dirp = NULL;
-            }
+            find_close_dir ();
 
-            while (dirp == NULL)
+            while (dirp == NULL && index_dir == NULL)
             {
                 char *tmp = NULL;
+                gboolean stat_ok;
 
                 tty_setcolor (REVERSE_COLOR);
 
@@ -1236,68 +1375,81 @@ do_search (Dlg_head * h)
                 /* mc_stat should not be called after mc_opendir
                    because vfs_s_opendir modifies the st_nlink
                  */
-                if (mc_stat (directory, &tmp_stat) == 0)
-                    subdirs_left = tmp_stat.st_nlink - 2;
-                else
-                    subdirs_left = 0;
+                stat_ok = (mc_stat (directory, &tmp_stat) == 0);
+                subdirs_left = stat_ok ? tmp_stat.st_nlink - 2 : 0;
+
+                /* unchanged directory: take its listing from the index */
+                if (stat_ok)
+                    index_dir = find_index_lookup (find_index, directory, &tmp_stat);
 
-                dirp = mc_opendir (directory);
+                if (index_dir != NULL)
+                    index_pos = 0;
+                else
+                {
+                    dirp = mc_opendir (directory);
+                    if (dirp != NULL && stat_ok)
+                        find_index_dir_begin (find_index, directory, &tmp_stat);
+                }
             }                   /* while (!dirp) */
 
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
-        }                       /* while (!dp) */
+            find_read_entry ();
+        }                       /* while (!entry_name) */
 
-        if (strcmp (dp->d_name, ".") == 0 || strcmp (dp->d_name, "..") == 0)
+        if (strcmp (entry_name, ".") == 0 || strcmp (entry_name, "..") == 0)
         {
-            /* skip invalid filenames */
-            while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-                ;
-
+            find_next_entry ();
             return 1;
         }
 
-        if (!(options.skip_hidden && (dp->d_name[0] == '.')))
+        if (!(options.skip_hidden && (entry_name[0] == '.')))
         {
             gboolean search_ok;
 
             if ((subdirs_left != 0) && options.find_recurs && (directory != NULL))
             {                   /* Can directory be NULL ? */
                 /* handle relative ignore dirs here */
-                if (options.ignore_dirs_enable && find_ignore_dir_search (dp->d_name))
+                if (options.ignore_dirs_enable && find_ignore_dir_search (entry_name))
                     ignore_count++;
-                else
+                else if (entry_type != FIND_INDEX_FILE)
                 {
                     char *tmp_name;
 
-                    tmp_name = mc_build_filename (directory, dp->d_name, (char *) NULL);
+                    tmp_name = mc_build_filename (directory, entry_name, (char *) NULL);
 
-                    if (mc_lstat (tmp_name, &tmp_stat) == 0 && S_ISDIR (tmp_stat.st_mode))
+                    if (entry_type == FIND_INDEX_DIR)
                     {
                         push_directory (tmp_name);
                         subdirs_left--;
                     }
+                    else if (mc_lstat (tmp_name, &tmp_stat) != 0)
+                        g_free (tmp_name);
+                    else if (S_ISDIR (tmp_stat.st_mode))
+                    {
+                        entry_type = FIND_INDEX_DIR;
+                        push_directory (tmp_name);
+                        subdirs_left--;
+                    }
                     else
+                    {
+                        entry_type = FIND_INDEX_FILE;
                         g_free (tmp_name);
+                    }
                 }
             }
 
-            search_ok = mc_search_run (search_file_handle, dp->d_name,
-                                       0, strlen (dp->d_name), &bytes_found);
+            search_ok = mc_search_run (search_file_handle, entry_name,
+                                       0, strlen (entry_name), &bytes_found);
 
             if (search_ok)
             {
                 if (content_pattern == NULL)
-                    find_add_match (directory, dp->d_name);
-                else if (search_content (h, directory, dp->d_name))
+                    find_add_match (directory, entry_name);
+                else if (search_content (h, directory, entry_name))
                     return 1;
             }
         }
 
-        /* skip invalid filenames */
-        while ((dp = mc_readdir (dirp)) != NULL && !str_is_valid_string (dp->d_name))
-            ;
+        find_next_entry ();
     }                           /* for */
 
     find_rotate_dash (h, FALSE);
@@ -1310,8 +1462,6 @@ do_search (Dlg_head * h)
 static void
 init_find_vars (void)
 {
-    g_free (old_dir);
-    old_dir = NULL;
     matches = 0;
     ignore_count = 0;
 
@@ -1358,7 +1508,7 @@ view_edit_currently_selected_file (int unparsed_view, int edit)
     char *dir = NULL;
     char *text = NULL;
 
-    listbox_get_current (find_list, &text, (void **) &dir);
+    get_list_info (&text, &dir);
 
     if ((text == NULL) || (dir == NULL))
         return MSG_NOT_HANDLED;
@@ -1521,7 +1671,11 @@ setup_gui (void)
     found_num_label = label_new (FIND2_Y - 6, 4, "");
     add_widget (find_dlg, found_num_label);
 
+    found_hits = g_array_new (FALSE, FALSE, sizeof (find_hit_t));
+    found_dirs = g_ptr_array_new ();
+
     find_list = listbox_new (2, 2, FIND2_Y - 10, FIND2_X - 4, FALSE, NULL);
+    listbox_set_virtual (find_list, 0, found_hit_get_text);
     add_widget (find_dlg, find_list);
 }
 
@@ -1567,6 +1721,7 @@ kill_gui (void)
 {
     set_idle_proc (find_dlg, 0);
     destroy_dlg (find_dlg);
+    found_hits_free ();
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1591,6 +1746,9 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
     parse_ignore_dirs (ignore_dirs);
     push_directory (start_dir);
 
+    if (options.file_use_index)
+        find_index = find_index_open (start_dir);
+
     return_value = run_process ();
 
     /* Clear variables */
@@ -1609,28 +1767,27 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
         int next_free = 0;
         int i;
         struct stat st;
-        GList *entry;
         dir_list *list = &current_panel->dir;
         char *name = NULL;
 
         if (set_zero_dir (list))
             next_free++;
 
-        for (i = 0, entry = find_list->list; entry != NULL; i++, entry = g_list_next (entry))
+        for (i = 0; i < (int) found_hits->len; i++)
         {
             const char *lc_filename = NULL;
-            WLEntry *le = (WLEntry *) entry->data;
+            const find_hit_t *hit = &g_array_index (found_hits, find_hit_t, i);
             char *p;
 
-            if ((le->text == NULL) || (le->data == NULL))
+            if (hit->text == NULL)
                 continue;
 
             if (content_pattern != NULL)
-                lc_filename = strchr (le->text + 4, ':') + 1;
+                lc_filename = strchr (hit->text + 4, ':') + 1;
             else
-                lc_filename = le->text + 4;
+                lc_filename = hit->text + 4;
 
-            name = mc_build_filename (le->data, lc_filename, (char *) NULL);
+            name = mc_build_filename (hit->dir, lc_filename, (char *) NULL);
             /* skip initial start dir */
             if (start_dir_len < 0)
                 p = name;
@@ -1672,6 +1829,7 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
             list->list[next_free].st = st;
             list->list[next_free].sort_key = NULL;
             list->list[next_free].second_sort_key = NULL;
+            list->list[next_free].fhl_id = 0;
             next_free++;
             g_free (name);
             if (!(next_free & 15))
@@ -1698,8 +1856,8 @@ do_find (const char *start_dir, ssize_t start_dir_len, const char *ignore_dirs,
     g_free (content_pattern);
     kill_gui ();
     do_search (NULL);           /* force do_search to release resources */
-    g_free (old_dir);
-    old_dir = NULL;
+    find_index_close (find_index);
+    find_index = NULL;
 
     return return_value;
 }
@@ -0,0 +1,373 @@
+/*
+   Persistent file name index for the Find File command
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file findindex.c
+ *  \brief Source: persistent file name index for the Find File command
+ *
+ *  The index keeps the listings of all directories visited while searching
+ *  from the one start directory. Every listing is stamped with the inode and
+ *  the mtime of its directory. Since creation, removal and renaming of entries
+ *  update the mtime of the directory, the listing is reused by the next search
+ *  as long as the stamp matches the live directory, and is reread otherwise.
+ *
+ *  The index is stored in the cache directory, one file per start directory:
+ *
+ *  <signature>\n
+ *  <start directory>\n
+ *  D <inode> <mtime> <count> <path length> <names length>\n<path><names>
+ *  ...
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/mcconfig.h"
+#include "lib/fileloc.h"
+#include "lib/vfs/vfs.h"
+
+#include "findindex.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define FIND_INDEX_SIGNATURE "Midnight Commander FindIndex v 1.0"
+
+/* Directories modified within this number of seconds are not stored in the index:
+   the next change could happen within the same mtime tick and stay unnoticed */
+#define FIND_INDEX_MTIME_GUARD 2
+
+/*** file scope type declarations ****************************************************************/
+
+struct find_index_t
+{
+    char *root;                 /* start directory */
+    char *file_name;            /* file where the index is stored */
+    GHashTable *dirs;           /* directory path -> find_index_dir_t */
+    gboolean dirty;             /* index was changed since loading */
+
+    /* directory being read now */
+    char *cur_path;
+    find_index_dir_t *cur;
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_dir_free (gpointer data)
+{
+    find_index_dir_t *dir = (find_index_dir_t *) data;
+
+    g_string_free (dir->names, TRUE);
+    g_free (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+find_index_get_file_name (const char *root)
+{
+    char *base, *name;
+
+    base = g_strdup_printf ("%08x", g_str_hash (root));
+    name = g_build_filename (mc_config_get_cache_path (), MC_FINDINDEX_DIR, base, (char *) NULL);
+    g_free (base);
+
+    return name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Parse the index file. Corrupted tail of file is silently ignored */
+
+static void
+find_index_load (find_index_t * index)
+{
+    char *data;
+    gsize len;
+    const char *p, *end;
+    size_t sig_len;
+
+    if (!g_file_get_contents (index->file_name, &data, &len, NULL))
+        return;
+
+    p = data;
+    end = data + len;
+    sig_len = strlen (FIND_INDEX_SIGNATURE);
+
+    /* signature */
+    if (len <= sig_len || strncmp (p, FIND_INDEX_SIGNATURE, sig_len) != 0 || p[sig_len] != '\n')
+        goto ret;
+    p += sig_len + 1;
+
+    /* start directory: the index file name is a hash, check for collision */
+    len = strlen (index->root);
+    if ((gsize) (end - p) <= len || strncmp (p, index->root, len) != 0 || p[len] != '\n')
+        goto ret;
+    p += len + 1;
+
+    while (p < end && *p == 'D')
+    {
+        unsigned long ino, count;
+        long mtime;
+        size_t path_len, names_len;
+        const char *eol;
+        find_index_dir_t *dir;
+
+        eol = memchr (p, '\n', end - p);
+        if (eol == NULL
+            || sscanf (p, "D %lu %ld %lu %zu %zu", &ino, &mtime, &count, &path_len,
+                       &names_len) != 5)
+            break;
+
+        p = eol + 1;
+        if ((size_t) (end - p) < path_len + names_len)
+            break;
+
+        dir = g_new (find_index_dir_t, 1);
+        dir->ino = (ino_t) ino;
+        dir->mtime = (time_t) mtime;
+        dir->count = (guint) count;
+        dir->names = g_string_new_len (p + path_len, names_len);
+        g_hash_table_insert (index->dirs, g_strndup (p, path_len), dir);
+
+        p += path_len + names_len;
+    }
+
+  ret:
+    g_free (data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+find_index_save_dir (gpointer key, gpointer value, gpointer user_data)
+{
+    const char *path = (const char *) key;
+    const find_index_dir_t *dir = (const find_index_dir_t *) value;
+    FILE *f = (FILE *) user_data;
+    size_t path_len;
+
+    path_len = strlen (path);
+    fprintf (f, "D %lu %ld %lu %zu %zu\n", (unsigned long) dir->ino, (long) dir->mtime,
+             (unsigned long) dir->count, path_len, (size_t) dir->names->len);
+    fwrite (path, 1, path_len, f);
+    fwrite (dir->names->str, 1, dir->names->len, f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write the index to the temporary file and move it over the old one */
+
+static void
+find_index_save (find_index_t * index)
+{
+    char *dir_name, *tmp_name;
+    FILE *f;
+    gboolean ok;
+
+    dir_name = g_path_get_dirname (index->file_name);
+    g_mkdir_with_parents (dir_name, 0700);
+    g_free (dir_name);
+
+    tmp_name = g_strconcat (index->file_name, ".tmp", (char *) NULL);
+    f = fopen (tmp_name, "w");
+    if (f == NULL)
+    {
+        g_free (tmp_name);
+        return;
+    }
+
+    fprintf (f, "%s\n%s\n", FIND_INDEX_SIGNATURE, index->root);
+    g_hash_table_foreach (index->dirs, find_index_save_dir, f);
+
+    ok = !ferror (f);
+    ok = (fclose (f) == 0) && ok;
+
+    if (!ok || rename (tmp_name, index->file_name) != 0)
+        unlink (tmp_name);
+
+    g_free (tmp_name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the index of the start directory.
+ * Returns NULL if the directory cannot be indexed (i.e. it is not local).
+ */
+
+find_index_t *
+find_index_open (const char *root)
+{
+    find_index_t *index;
+    vfs_path_t *vpath;
+    gboolean is_local;
+
+    if (root == NULL || !g_path_is_absolute (root))
+        return NULL;
+
+    /* remote listings are not stamped reliably */
+    vpath = vfs_path_from_str (root);
+    is_local = vfs_file_is_local (vpath);
+    vfs_path_free (vpath);
+    if (!is_local)
+        return NULL;
+
+    index = g_new0 (find_index_t, 1);
+    index->root = g_strdup (root);
+    index->file_name = find_index_get_file_name (root);
+    index->dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, find_index_dir_free);
+
+    find_index_load (index);
+
+    return index;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Save the changed index and free it */
+
+void
+find_index_close (find_index_t * index)
+{
+    if (index == NULL)
+        return;
+
+    find_index_dir_abort (index);
+
+    if (index->dirty)
+        find_index_save (index);
+
+    g_hash_table_destroy (index->dirs);
+    g_free (index->file_name);
+    g_free (index->root);
+    g_free (index);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the listing of directory.
+ * Returns NULL if directory isn't indexed or if it was changed after indexing.
+ */
+
+const find_index_dir_t *
+find_index_lookup (find_index_t * index, const char *dir, const struct stat *st)
+{
+    find_index_dir_t *d;
+
+    if (index == NULL)
+        return NULL;
+
+    d = (find_index_dir_t *) g_hash_table_lookup (index->dirs, dir);
+    if (d == NULL)
+        return NULL;
+
+    if (d->ino != st->st_ino || d->mtime != st->st_mtime)
+    {
+        /* stale listing */
+        g_hash_table_remove (index->dirs, dir);
+        index->dirty = TRUE;
+        return NULL;
+    }
+
+    return d;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Start recording of directory listing */
+
+void
+find_index_dir_begin (find_index_t * index, const char *dir, const struct stat *st)
+{
+    if (index == NULL)
+        return;
+
+    find_index_dir_abort (index);
+
+    /* directory is being changed now, don't trust its mtime */
+    if (st->st_mtime + FIND_INDEX_MTIME_GUARD > time (NULL))
+        return;
+
+    index->cur_path = g_strdup (dir);
+    index->cur = g_new (find_index_dir_t, 1);
+    index->cur->ino = st->st_ino;
+    index->cur->mtime = st->st_mtime;
+    index->cur->count = 0;
+    index->cur->names = g_string_sized_new (BUF_1K);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+find_index_dir_add (find_index_t * index, const char *name, char type)
+{
+    if (index == NULL || index->cur == NULL)
+        return;
+
+    g_string_append_c (index->cur->names, type);
+    /* keep trailing NUL as the separator */
+    g_string_append_len (index->cur->names, name, strlen (name) + 1);
+    index->cur->count++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Store directory listing in the index. Call it after the whole directory has been read */
+
+void
+find_index_dir_commit (find_index_t * index)
+{
+    if (index == NULL || index->cur == NULL)
+        return;
+
+    g_hash_table_replace (index->dirs, index->cur_path, index->cur);
+    index->cur_path = NULL;
+    index->cur = NULL;
+    index->dirty = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Forget the incomplete directory listing */
+
+void
+find_index_dir_abort (find_index_t * index)
+{
+    if (index == NULL || index->cur == NULL)
+        return;
+
+    find_index_dir_free (index->cur);
+    g_free (index->cur_path);
+    index->cur_path = NULL;
+    index->cur = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,71 @@
+/** \file findindex.h
+ *  \brief Header: persistent file name index for the Find File command
+ */
+
+#ifndef MC__FIND_INDEX_H
+#define MC__FIND_INDEX_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Type of the indexed directory entry */
+#define FIND_INDEX_FILE    'f'
+#define FIND_INDEX_DIR     'd'
+#define FIND_INDEX_UNKNOWN '?'
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+struct find_index_t;
+typedef struct find_index_t find_index_t;
+
+/* Cached listing of one directory */
+typedef struct
+{
+    ino_t ino;                  /* inode of the directory */
+    time_t mtime;               /* mtime of the directory when it was read */
+    guint count;                /* number of entries */
+    GString *names;             /* entries: type char followed by NUL-terminated name */
+} find_index_dir_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+find_index_t *find_index_open (const char *root);
+void find_index_close (find_index_t * index);
+
+const find_index_dir_t *find_index_lookup (find_index_t * index, const char *dir,
+                                           const struct stat *st);
+
+void find_index_dir_begin (find_index_t * index, const char *dir, const struct stat *st);
+void find_index_dir_add (find_index_t * index, const char *name, char type);
+void find_index_dir_commit (find_index_t * index);
+void find_index_dir_abort (find_index_t * index);
+
+/*** inline functions ****************************************************************************/
+
+/**
+ * Walk through the entries of the cached directory listing.
+ * Start with pos = 0. Returns NULL after the last entry.
+ */
+
+static inline const char *
+find_index_dir_next (const find_index_dir_t * dir, gsize * pos, char *type)
+{
+    const char *name;
+
+    if (*pos >= dir->names->len)
+        return NULL;
+
+    *type = dir->names->str[*pos];
+    name = dir->names->str + *pos + 1;
+    *pos += strlen (name) + 2;
+
+    return name;
+}
+
+#endif /* MC__FIND_INDEX_H */
@@ -71,6 +71,7 @@
 #include "panelize.h"
 #include "command.h"            /* cmdline */
 #include "dir.h"                /* clean_dir() */
+#include "dirwatch.h"           /* dir_watch_poll() */
 
 #include "chmod.h"
 #include "chown.h"
@@ -1036,6 +1037,12 @@ toggle_show_hidden (void)
 static void
 update_dirty_panels (void)
 {
+    /* changes of the watched directories postponed while the panels were busy */
+    if (get_current_type () == view_listing)
+        panel_watch_apply (current_panel);
+    if (get_other_type () == view_listing)
+        panel_watch_apply (other_panel);
+
     if (get_current_type () == view_listing && current_panel->dirty)
         send_message ((Widget *) current_panel, WIDGET_DRAW, 0);
 
@@ -1498,6 +1505,8 @@ midnight_callback (Dlg_head * h, Widget * sender, dlg_msg_t msg, int parm, void
         return (command == CK_IgnoreKey) ? MSG_NOT_HANDLED : midnight_execute_cmd (NULL, command);
 
     case DLG_POST_KEY:
+        /* check the panel directories which are not watched by inotify */
+        dir_watch_poll ();
         if (!the_menubar->is_active)
             update_dirty_panels ();
         return MSG_HANDLED;
@@ -1675,6 +1684,7 @@ do_nc (void)
     done_mc ();
     destroy_dlg (midnight_dlg);
     current_panel = NULL;
+    dir_watch_shutdown ();
 
 #ifdef USE_INTERNAL_EDIT
     edit_stack_free ();
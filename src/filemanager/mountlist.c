@@ -37,6 +37,12 @@
 #include <sys/types.h>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 #if defined STAT_STATVFS || defined STAT_STATVFS64 /* POSIX 1003.1-2001 (and later) with XSI */
 #include <sys/statvfs.h>
@@ -177,6 +183,9 @@
 #endif
 
 #include "lib/global.h"
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+#include "lib/widget.h"         /* repaint_screen() */
+
 #include "mountlist.h"
 
 /*** global variables ****************************************************************************/
@@ -191,6 +200,15 @@
 #define HAVE_INFOMOUNT
 #endif
 
+/* mount table is read again after this number of seconds if its changes cannot be detected */
+#define MOUNT_LIST_TTL 5
+/* usage of file system is asked again after this number of seconds */
+#define FS_USAGE_TTL 2
+/* remote file system which didn't answer in this number of seconds... */
+#define FS_USAGE_TIMEOUT 3
+/* ...is not asked again during this number of seconds */
+#define FS_USAGE_RETRY 30
+
 /* The results of open() in this file are not used with fchdir,
    therefore save some unnecessary work in fchdir.c.  */
 #undef open
@@ -307,10 +325,32 @@ struct fs_usage
     uintmax_t fsu_ffree;          /* Free file nodes. */
 };
 
+/* Cached usage of file system */
+typedef struct
+{
+    char *mountdir;
+    gboolean remote;
+    struct fs_usage usage;
+    gboolean valid;             /* usage is known */
+    gboolean timed_out;         /* the last request was not answered */
+    time_t stamp;               /* time of the last request */
+    pid_t pid;                  /* process asking remote file system, 0 if none */
+    int fd;                     /* pipe from that process */
+} fs_usage_cache_t;
+
 /*** file scope variables ************************************************************************/
 
 #ifdef HAVE_INFOMOUNT_LIST
 static struct mount_entry *mc_mount_list = NULL;
+static time_t mc_mount_list_stamp = 0;
+/* /proc/self/mounts of Linux: it is reported as exceptional condition by select()
+   when mount table is changed */
+static int mounts_fd = -1;
+
+/* list of fs_usage_cache_t */
+static GSList *fs_usage_list = NULL;
+/* processes which asked hung file systems and were killed, but not finished yet */
+static GSList *fs_usage_zombies = NULL;
 #endif /* HAVE_INFOMOUNT_LIST */
 
 /*** file scope functions ************************************************************************/
@@ -1454,13 +1494,29 @@ get_fs_usage (char const *file, char const *disk, struct fs_usage *fsp)
 #endif /* HAVE_INFOMOUNT */
 
 /* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
+
+#ifdef HAVE_INFOMOUNT_LIST
+static gboolean
+mount_list_changed (void)
+{
+    if (mounts_fd != -1)
+    {
+        fd_set except_fds;
+        struct timeval tv = { 0, 0 };
+
+        FD_ZERO (&except_fds);
+        FD_SET (mounts_fd, &except_fds);
+        return (select (mounts_fd + 1, NULL, NULL, &except_fds, &tv) > 0);
+    }
+
+    return (time (NULL) - mc_mount_list_stamp >= MOUNT_LIST_TTL);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
-void
-free_my_statfs (void)
+static void
+free_mount_list (void)
 {
-#ifdef HAVE_INFOMOUNT_LIST
     while (mc_mount_list != NULL)
     {
         struct mount_entry *next;
@@ -1469,23 +1525,225 @@ free_my_statfs (void)
         free_mount_entry (mc_mount_list);
         mc_mount_list = next;
     }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fs_usage_reap_zombies (void)
+{
+    GSList *l;
+
+    for (l = fs_usage_zombies; l != NULL;)
+    {
+        GSList *next = g_slist_next (l);
+
+        if (waitpid ((pid_t) GPOINTER_TO_INT (l->data), NULL, WNOHANG) != 0)
+            fs_usage_zombies = g_slist_delete_link (fs_usage_zombies, l);
+        l = next;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Stop waiting for the process asking remote file system */
+
+static void
+fs_usage_stop_helper (fs_usage_cache_t * c, gboolean kill_it)
+{
+    if (c->pid == 0)
+        return;
+
+    delete_select_channel (c->fd);
+    close (c->fd);
+    c->fd = -1;
+
+    if (kill_it)
+    {
+        kill (c->pid, SIGKILL);
+        fs_usage_zombies = g_slist_prepend (fs_usage_zombies, GINT_TO_POINTER ((int) c->pid));
+    }
+    else
+        waitpid (c->pid, NULL, 0);
+
+    c->pid = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+fs_usage_helper_done (int fd, void *info)
+{
+    fs_usage_cache_t *c = (fs_usage_cache_t *) info;
+    struct fs_usage fsu;
+
+    c->valid = (read (fd, &fsu, sizeof (fsu)) == (ssize_t) sizeof (fsu));
+    if (c->valid)
+        c->usage = fsu;
+    c->timed_out = FALSE;
+    c->stamp = time (NULL);
+
+    fs_usage_stop_helper (c, FALSE);
+
+    /* show the result in panels and info */
+    repaint_screen ();
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Ask remote file system in separate process: the server can hang and statvfs() cannot be
+ * interrupted. The result is read when the process answers (see fs_usage_helper_done()).
+ */
+
+static void
+fs_usage_start_helper (fs_usage_cache_t * c)
+{
+    int fds[2];
+    pid_t pid;
+
+    if (pipe (fds) != 0)
+        return;
+
+    pid = fork ();
+    if (pid == -1)
+    {
+        close (fds[0]);
+        close (fds[1]);
+        return;
+    }
+
+    if (pid == 0)
+    {
+        struct fs_usage fsu;
+
+        close (fds[0]);
+        memset (&fsu, 0, sizeof (fsu));
+        if (get_fs_usage (c->mountdir, NULL, &fsu) == 0)
+            (void) write (fds[1], &fsu, sizeof (fsu));
+        _exit (0);
+    }
+
+    close (fds[1]);
+    c->pid = pid;
+    c->fd = fds[0];
+    add_select_channel (c->fd, fs_usage_helper_done, c);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get cached usage of file system, update the cache if it is out of date */
+
+static const fs_usage_cache_t *
+fs_usage_get (const struct mount_entry *entry)
+{
+    fs_usage_cache_t *c = NULL;
+    GSList *l;
+    time_t now;
+
+    fs_usage_reap_zombies ();
+
+    for (l = fs_usage_list; l != NULL; l = g_slist_next (l))
+        if (strcmp (((fs_usage_cache_t *) l->data)->mountdir, entry->me_mountdir) == 0)
+        {
+            c = (fs_usage_cache_t *) l->data;
+            break;
+        }
+
+    if (c == NULL)
+    {
+        c = g_new0 (fs_usage_cache_t, 1);
+        c->mountdir = g_strdup (entry->me_mountdir);
+        c->fd = -1;
+        fs_usage_list = g_slist_prepend (fs_usage_list, c);
+    }
+
+    c->remote = entry->me_remote != 0;
+    now = time (NULL);
+
+    if (c->pid != 0)
+    {
+        if (now - c->stamp >= FS_USAGE_TIMEOUT)
+        {
+            fs_usage_stop_helper (c, TRUE);
+            c->valid = FALSE;
+            c->timed_out = TRUE;
+        }
+    }
+    else if (now - c->stamp >= (c->timed_out ? FS_USAGE_RETRY : FS_USAGE_TTL))
+    {
+        c->stamp = now;
 
-    mc_mount_list = NULL;
+        if (c->remote)
+            fs_usage_start_helper (c);
+        else
+        {
+            memset (&c->usage, 0, sizeof (c->usage));
+            c->valid = (get_fs_usage (c->mountdir, NULL, &c->usage) == 0);
+        }
+    }
+
+    return c;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fs_usage_free (gpointer data)
+{
+    fs_usage_cache_t *c = (fs_usage_cache_t *) data;
+
+    fs_usage_stop_helper (c, TRUE);
+    g_free (c->mountdir);
+    g_free (c);
+}
+#endif /* HAVE_INFOMOUNT_LIST */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+free_my_statfs (void)
+{
+#ifdef HAVE_INFOMOUNT_LIST
+    free_mount_list ();
+
+    if (mounts_fd != -1)
+    {
+        close (mounts_fd);
+        mounts_fd = -1;
+    }
+
+    g_slist_foreach (fs_usage_list, (GFunc) fs_usage_free, NULL);
+    g_slist_free (fs_usage_list);
+    fs_usage_list = NULL;
 #endif /* HAVE_INFOMOUNT_LIST */
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Read mount table if it is not read yet or was changed */
 
 void
 init_my_statfs (void)
 {
 #ifdef HAVE_INFOMOUNT_LIST
-    free_my_statfs ();
+    if (mc_mount_list != NULL && !mount_list_changed ())
+        return;
+
+    free_mount_list ();
+#ifdef __linux__
+    if (mounts_fd == -1)
+        mounts_fd = open ("/proc/self/mounts", O_RDONLY);
+#endif
     mc_mount_list = read_file_system_list (1);
+    mc_mount_list_stamp = time (NULL);
 #endif /* HAVE_INFOMOUNT_LIST */
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Get information about file system of path. Usage of file system is cached, usage of remote
+ * file system is got asynchronously: zeros are returned until it is known.
+ */
 
 void
 my_statfs (struct my_statfs *myfs_stats, const char *path)
@@ -1493,9 +1751,12 @@ my_statfs (struct my_statfs *myfs_stats, const char *path)
 #ifdef HAVE_INFOMOUNT_LIST
     size_t i, len = 0;
     struct mount_entry *entry = NULL;
-    struct mount_entry *temp = mc_mount_list;
+    struct mount_entry *temp;
     struct fs_usage fs_use;
 
+    init_my_statfs ();
+    temp = mc_mount_list;
+
     while (temp)
     {
         i = strlen (temp->me_mountdir);
@@ -1510,8 +1771,12 @@ my_statfs (struct my_statfs *myfs_stats, const char *path)
 
     if (entry)
     {
+        const fs_usage_cache_t *c;
+
+        c = fs_usage_get (entry);
         memset (&fs_use, 0, sizeof (struct fs_usage));
-        get_fs_usage (entry->me_mountdir, NULL, &fs_use);
+        if (c->valid)
+            fs_use = c->usage;
 
         myfs_stats->type = entry->me_dev;
         myfs_stats->typename = entry->me_type;
@@ -333,6 +333,8 @@ panel_options_box (void)
         QUICK_GROUPBOX (dlg_width / 2, dlg_width, 2, dlg_height, dlg_width / 2 - 4, 5,
                         N_("Navigation")),
         /* main panel options */
+        QUICK_CHECKBOX (5, dlg_width, 13, dlg_height, N_("Auto re&load"),
+                        &panels_options.auto_reload),
         QUICK_CHECKBOX (5, dlg_width, 12, dlg_height, N_("A&uto save panels setup"),
                         &panels_options.auto_save_setup),
         QUICK_CHECKBOX (5, dlg_width, 11, dlg_height, N_("Simple s&wap"),
@@ -390,7 +392,7 @@ panel_options_box (void)
         case 3:
         case 6:
         case 10:
-        case 21:
+        case 22:
             /* groupboxes */
             quick_widgets[i].u.groupbox.title = _(quick_widgets[i].u.groupbox.title);
             break;
@@ -413,7 +415,7 @@ panel_options_box (void)
 
     /* checkboxes within groupboxes */
     c_len = 0;
-    for (i = 4; i < 21; i++)
+    for (i = 4; i < 22; i++)
         if ((i != 6) && (i != 10))
             c_len = max (c_len, str_term_width1 (quick_widgets[i].u.checkbox.text) + 4);
 
@@ -424,7 +426,7 @@ panel_options_box (void)
     g_len = max (c_len + 2, str_term_width1 (quick_widgets[3].u.groupbox.title) + 4);
     g_len = max (g_len, str_term_width1 (quick_widgets[6].u.groupbox.title) + 4);
     g_len = max (g_len, str_term_width1 (quick_widgets[10].u.groupbox.title) + 4);
-    g_len = max (g_len, str_term_width1 (quick_widgets[21].u.groupbox.title) + 4);
+    g_len = max (g_len, str_term_width1 (quick_widgets[22].u.groupbox.title) + 4);
     /* dialog width */
     Quick_input.xlen = max (dlg_width, g_len * 2 + 9);
     Quick_input.xlen = max (Quick_input.xlen, b_len + 2);
@@ -439,7 +441,7 @@ panel_options_box (void)
     quick_widgets[3].u.groupbox.width =
         quick_widgets[6].u.groupbox.width =
         quick_widgets[10].u.groupbox.width = Quick_input.xlen / 2 - 3;
-    quick_widgets[21].u.groupbox.width = Quick_input.xlen / 2 - 4;
+    quick_widgets[22].u.groupbox.width = Quick_input.xlen / 2 - 4;
 
     /* right column */
     quick_widgets[3].relative_x =
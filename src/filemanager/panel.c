@@ -72,6 +72,7 @@
 #include "usermenu.h"
 #include "midnight.h"
 #include "mountlist.h"          /* my_statfs */
+#include "file.h"               /* panel_operate_is_running() */
 
 #include "panel.h"
 
@@ -317,6 +318,9 @@ extern int saving_setup;
 /* This macro extracts the number of available lines in a panel */
 #define llines(p) (p->widget.lines - 3 - (panels_options.show_mini_info ? 2 : 0))
 
+/* More changes of watched directory than that are applied by rereading it */
+#define PANEL_WATCH_MAX_CHANGES 1024
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -1024,6 +1028,8 @@ show_free_space (WPanel * panel)
     static struct my_statfs myfs_stats;
     /* Old current working directory for displaying free space */
     static char *old_cwd = NULL;
+    /* Its real path */
+    static char rpath[PATH_MAX];
     vfs_path_t *vpath = vfs_path_from_str (panel->cwd);
 
     /* Don't try to stat non-local fs */
@@ -1036,18 +1042,23 @@ show_free_space (WPanel * panel)
 
     if (old_cwd == NULL || strcmp (old_cwd, panel->cwd) != 0)
     {
-        char rpath[PATH_MAX];
-
-        init_my_statfs ();
         g_free (old_cwd);
         old_cwd = g_strdup (panel->cwd);
 
         if (mc_realpath (panel->cwd, rpath) == NULL)
+        {
+            rpath[0] = '\0';
             return;
-
-        my_statfs (&myfs_stats, rpath);
+        }
     }
 
+    if (rpath[0] == '\0')
+        return;
+
+    /* mount table and usage of file systems are cached: usage of remote file system
+       is shown when it is known */
+    my_statfs (&myfs_stats, rpath);
+
     if (myfs_stats.avail != 0 || myfs_stats.total != 0)
     {
         char buffer1[6], buffer2[6], tmp[BUF_SMALL];
@@ -1217,6 +1228,172 @@ panel_save_history (const gchar * event_group_name, const gchar * event_name,
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Redraw the panel if it is visible now */
+
+static void
+panel_watch_redraw (WPanel * panel)
+{
+    panel->dirty = 1;
+
+    if (top_dlg != NULL && (Dlg_head *) top_dlg->data == midnight_dlg
+        && !the_menubar->is_active)
+    {
+        send_message ((Widget *) panel, WIDGET_DRAW, 0);
+        mc_refresh ();
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the file list of panel can be changed now.
+ * The watch callback is called from the event loop, which also runs while dialogs
+ * (e.g. the progress dialog of file operation) wait for input, and the file list
+ * may be in use then.
+ */
+
+static gboolean
+panel_watch_can_apply (void)
+{
+    return top_dlg != NULL && (Dlg_head *) top_dlg->data == midnight_dlg
+        && !panel_operate_is_running ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+panel_watch_clear (WPanel * panel)
+{
+    if (panel->watch_changes != NULL)
+    {
+        g_ptr_array_foreach (panel->watch_changes, (GFunc) g_free, NULL);
+        g_ptr_array_free (panel->watch_changes, TRUE);
+        panel->watch_changes = NULL;
+    }
+    panel->watch_rescan = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Update the entry of changed file in the panel */
+
+static void
+panel_watch_update_entry (WPanel * panel, const char *name)
+{
+    int old_pos, new_pos;
+    int selected = panel->selected;
+    int top_file = panel->top_file;
+
+    panel->count =
+        dir_list_update_entry (panel->cwd, &panel->dir, panel->count, name,
+                               panel->sort_info.sort_field->sort_routine,
+                               panel->sort_info.reverse, panel->sort_info.case_sensitive,
+                               panel->sort_info.exec_first, panel->filter, &old_pos, &new_pos);
+
+    /* keep the same file selected */
+    if (old_pos == selected && new_pos >= 0)
+        selected = new_pos;
+    else if (old_pos != selected)
+    {
+        if (old_pos >= 0 && old_pos < selected)
+            selected--;
+        if (new_pos >= 0 && new_pos <= selected)
+            selected++;
+    }
+
+    if (old_pos >= 0 && old_pos < top_file)
+        top_file--;
+    if (new_pos >= 0 && new_pos < top_file)
+        top_file++;
+
+    panel->selected = selected;
+    panel->top_file = top_file;
+
+    if (panel->marked != 0)
+        recalculate_panel_summary (panel);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Reread the current directory of panel */
+
+static void
+panel_watch_rescan (WPanel * panel)
+{
+    char *current_file;
+
+    current_file = panel->count != 0 ? g_strdup (panel->dir.list[panel->selected].fname) : NULL;
+
+    /* panel_reload changes the current directory */
+    panel_reload (panel);
+    if (panel != current_panel)
+        mc_chdir (current_panel->cwd);
+
+    try_to_select (panel, current_file);
+    g_free (current_file);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Collect the changes of the current directory, apply them at the end of series */
+
+static void
+panel_watch_callback (dir_watch_event_t event, const char *name, void *data)
+{
+    WPanel *panel = (WPanel *) data;
+
+    if (panel->is_panelized)
+        return;
+
+    switch (event)
+    {
+    case DIR_WATCH_CHANGED:
+        if (panel->watch_rescan)
+            break;
+        if (panel->watch_changes == NULL)
+            panel->watch_changes = g_ptr_array_new ();
+        g_ptr_array_add (panel->watch_changes, g_strdup (name));
+        /* too many changes: reread the directory */
+        if (panel->watch_changes->len > PANEL_WATCH_MAX_CHANGES)
+        {
+            panel_watch_clear (panel);
+            panel->watch_rescan = TRUE;
+        }
+        break;
+
+    case DIR_WATCH_RESCAN:
+        panel_watch_clear (panel);
+        panel->watch_rescan = TRUE;
+        break;
+
+    case DIR_WATCH_FLUSH:
+        panel_watch_apply (panel);
+        break;
+
+    default:
+        break;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Watch the current directory of panel */
+
+static void
+panel_watch_update (WPanel * panel)
+{
+    gboolean need_watch;
+
+    need_watch = panels_options.auto_reload && !panel->is_panelized;
+
+    if (panel->watch != NULL
+        && (!need_watch || strcmp (dir_watch_get_path (panel->watch), panel->cwd) != 0))
+    {
+        dir_watch_free (panel->watch);
+        panel->watch = NULL;
+        panel_watch_clear (panel);
+    }
+
+    if (panel->watch == NULL && need_watch)
+        panel->watch = dir_watch_new (panel->cwd, panel_watch_callback, panel);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
@@ -1233,6 +1410,10 @@ panel_destroy (WPanel * p)
         g_free (name);
     }
 
+    dir_watch_free (p->watch);
+    p->watch = NULL;
+    panel_watch_clear (p);
+
     panel_clean_dir (p);
 
     /* clean history */
@@ -2755,6 +2936,7 @@ _do_panel_cd (WPanel * panel, const char *new_dir, enum cd_enum cd_type)
         do_load_dir (panel->cwd, &panel->dir, panel->sort_info.sort_field->sort_routine,
                      panel->sort_info.reverse, panel->sort_info.case_sensitive,
                      panel->sort_info.exec_first, panel->filter);
+    panel_watch_update (panel);
     try_to_select (panel, get_parent_dir_name (panel->cwd, olddir));
     load_hint (0);
     panel->dirty = 1;
@@ -3422,6 +3604,7 @@ update_one_panel_widget (WPanel * panel, panel_update_flags_t flags, const char
     else
         panel_reload (panel);
 
+    panel_watch_update (panel);
     try_to_select (panel, current_file);
     panel->dirty = 1;
 
@@ -3755,6 +3938,8 @@ panel_new_with_dir (const char *panel_name, const char *wpath)
                      panel->sort_info.reverse, panel->sort_info.case_sensitive,
                      panel->sort_info.exec_first, panel->filter);
 
+    panel_watch_update (panel);
+
     /* Restore old right path */
     if (curdir[0] != '\0')
         err = mc_chdir (curdir);
@@ -3803,6 +3988,7 @@ panel_reload (WPanel * panel)
         do_select (panel, panel->count - 1);
 
     recalculate_panel_summary (panel);
+    panel_watch_update (panel);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -3908,6 +4094,37 @@ select_item (WPanel * panel)
     execute_hooks (select_file_hook);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply the collected changes of the current directory to the panel.
+ * Does nothing while the file list may be in use, the changes are kept till the next call.
+ */
+
+void
+panel_watch_apply (WPanel * panel)
+{
+    guint i;
+
+    if (!panel->watch_rescan && panel->watch_changes == NULL)
+        return;
+
+    if (!panel_watch_can_apply ())
+        return;
+
+    if (panel->watch_rescan)
+        panel_watch_rescan (panel);
+    else
+    {
+        for (i = 0; i < panel->watch_changes->len; i++)
+            panel_watch_update_entry (panel,
+                                      (const char *) g_ptr_array_index (panel->watch_changes, i));
+        select_item (panel);
+    }
+
+    panel_watch_clear (panel);
+    panel_watch_redraw (panel);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** Clears all files in the panel, used only when one file was marked */
 void
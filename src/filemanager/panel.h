@@ -15,6 +15,7 @@
 #include "src/main.h"           /* cd_enum */
 
 #include "dir.h"                /* dir_list */
+#include "dirwatch.h"           /* dir_watch_t */
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -126,6 +127,9 @@ typedef struct WPanel
 
     char *panel_name;           /* The panel name */
     struct stat dir_stat;       /* Stat of current dir: used by execute () */
+    dir_watch_t *watch;         /* Watcher of changes in the current dir */
+    GPtrArray *watch_changes;   /* Names of changed entries not applied yet */
+    gboolean watch_rescan;      /* Whole directory should be reread when possible */
 
     int codepage;               /* panel codepage */
 
@@ -162,6 +166,7 @@ void try_to_select (WPanel * panel, const char *name);
 
 void unmark_files (WPanel * panel);
 void select_item (WPanel * panel);
+void panel_watch_apply (WPanel * panel);
 
 void recalculate_panel_summary (WPanel * panel);
 void file_mark (WPanel * panel, int idx, int val);
@@ -374,6 +374,7 @@ do_external_panelize (char *command)
         list->list[next_free].st = st;
         list->list[next_free].sort_key = NULL;
         list->list[next_free].second_sort_key = NULL;
+        list->list[next_free].fhl_id = 0;
         next_free++;
         if (!(next_free & 32))
             rotate_dash ();
@@ -437,6 +438,8 @@ do_panelize_cd (struct WPanel *panel)
         list->list[i].st = panelized_panel.list.list[i].st;
         list->list[i].sort_key = panelized_panel.list.list[i].sort_key;
         list->list[i].second_sort_key = panelized_panel.list.list[i].second_sort_key;
+        list->list[i].fhl_color = panelized_panel.list.list[i].fhl_color;
+        list->list[i].fhl_id = panelized_panel.list.list[i].fhl_id;
     }
     try_to_select (panel, NULL);
 }
@@ -476,6 +479,8 @@ panelize_save_panel (struct WPanel *panel)
         panelized_panel.list.list[i].st = list->list[i].st;
         panelized_panel.list.list[i].sort_key = list->list[i].sort_key;
         panelized_panel.list.list[i].second_sort_key = list->list[i].second_sort_key;
+        panelized_panel.list.list[i].fhl_color = list->list[i].fhl_color;
+        panelized_panel.list.list[i].fhl_id = list->list[i].fhl_id;
     }
 }
 
@@ -65,9 +65,20 @@
 /*** file scope macro definitions ****************************************************************/
 
 #define TREE_SIGNATURE "Midnight Commander TreeStore v 2.0"
+#define TREE_BIN_SIGNATURE "Midnight Commander TreeStore v 3.0\n"
+
+/* flags of the entry record in the binary tree file */
+#define TREE_BIN_SCANNED 1
 
 /*** file scope type declarations ****************************************************************/
 
+/* state of the search in the index of the tree store */
+typedef struct
+{
+    const char *name;           /* name to search */
+    tree_entry *prev;           /* the greatest entry less than name */
+} tree_store_search_t;
+
 /*** file scope variables ************************************************************************/
 
 static struct TreeStore ts;
@@ -141,6 +152,58 @@ pathcmp (const char *p1, const char *p2)
     return (*p1 - *p2);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Compares two entries of the index in the same collating sequence as the list. */
+
+static gint
+tree_entry_cmp (gconstpointer a, gconstpointer b)
+{
+    return pathcmp (((const tree_entry *) a)->name, ((const tree_entry *) b)->name);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gint
+tree_store_search_cmp (gconstpointer key, gconstpointer user_data)
+{
+    tree_entry *entry = (tree_entry *) key;
+    tree_store_search_t *search = (tree_store_search_t *) user_data;
+    int flag;
+
+    flag = pathcmp (search->name, entry->name);
+    if (flag > 0)
+        search->prev = entry;
+    return flag;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Looks up the directory in the index.
+ *
+ * @param name full path of directory
+ * @param prev if not NULL, the entry after which name is placed in the list is returned here
+ *             (NULL if name must be first)
+ * @return entry of the directory, NULL if it is not in the tree
+ */
+
+static tree_entry *
+tree_store_find (const char *name, tree_entry ** prev)
+{
+    tree_store_search_t search;
+    tree_entry *entry = NULL;
+
+    search.name = name;
+    search.prev = NULL;
+
+    if (ts.index != NULL)
+        entry = (tree_entry *) g_tree_search (ts.index, tree_store_search_cmp, &search);
+
+    if (prev != NULL)
+        *prev = search.prev;
+
+    return entry;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static char *
@@ -181,98 +244,172 @@ decode (char *buffer)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** Loads the tree store from the specified filename */
+/** Loads entries of the tree store from the text file, the signature is already read */
 
-static int
-tree_store_load_from (char *name)
+static void
+tree_store_load_text (FILE * file)
 {
-    FILE *file;
     char buffer[MC_MAXPATHLEN + 20], oldname[MC_MAXPATHLEN];
     char *different;
     int common;
-    int do_load;
 
-    g_return_val_if_fail (name != NULL, FALSE);
+    oldname[0] = 0;
+    while (fgets (buffer, MC_MAXPATHLEN, file))
+    {
+        tree_entry *e;
+        int scanned;
+        char *lc_name;
 
-    if (ts.loaded)
-        return TRUE;
+        /* Skip invalid records */
+        if ((buffer[0] != '0' && buffer[0] != '1'))
+            continue;
 
-    file = fopen (name, "r");
+        if (buffer[1] != ':')
+            continue;
 
-    if (file)
-    {
-        if (fgets (buffer, sizeof (buffer), file) != NULL)
+        scanned = buffer[0] == '1';
+
+        lc_name = decode (buffer + 2);
+        if (lc_name[0] != PATH_SEP)
         {
-            if (strncmp (buffer, TREE_SIGNATURE, strlen (TREE_SIGNATURE)) != 0)
+            /* Clear-text decompression */
+            char *s = strtok (lc_name, " ");
+
+            if (s)
             {
-                fclose (file);
-                do_load = FALSE;
+                common = atoi (s);
+                different = strtok (NULL, "");
+                if (different && common >= 0 && (size_t) common <= strlen (oldname)
+                    && common + strlen (different) < sizeof (oldname))
+                {
+                    vfs_path_t *vpath;
+
+                    strcpy (oldname + common, different);
+                    vpath = vfs_path_from_str (oldname);
+                    if (vfs_file_is_local (vpath))
+                    {
+                        e = tree_store_add_entry (oldname);
+                        e->scanned = scanned;
+                    }
+                    vfs_path_free (vpath);
+                }
             }
-            else
-                do_load = TRUE;
         }
         else
-            do_load = FALSE;
+        {
+            vfs_path_t *vpath = vfs_path_from_str (lc_name);
+            if (vfs_file_is_local (vpath))
+            {
+                e = tree_store_add_entry (lc_name);
+                e->scanned = scanned;
+            }
+            vfs_path_free (vpath);
+            g_strlcpy (oldname, lc_name, sizeof (oldname));
+        }
+        g_free (lc_name);
     }
-    else
-        do_load = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Reads the unsigned number stored in 7-bit groups, least significant first */
+
+static gboolean
+tree_store_read_number (FILE * file, size_t * number)
+{
+    int c;
+    unsigned int shift = 0;
+
+    *number = 0;
 
-    if (do_load)
+    do
     {
-        ts.loaded = TRUE;
+        c = getc (file);
+        if (c == EOF || shift >= sizeof (size_t) * 8)
+            return FALSE;
+        *number |= (size_t) (c & 0x7f) << shift;
+        shift += 7;
+    }
+    while ((c & 0x80) != 0);
 
-        /* File open -> read contents */
-        oldname[0] = 0;
-        while (fgets (buffer, MC_MAXPATHLEN, file))
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Loads entries of the tree store from the binary file, the signature is already read.
+ *
+ * Every record is: flags byte, length of the prefix common with the previous record,
+ * length of the rest of name and the rest of name itself. The records go in the order
+ * of the list, so every entry is appended to the end of it.
+ */
+
+static void
+tree_store_load_binary (FILE * file)
+{
+    char name[MC_MAXPATHLEN];
+    size_t name_len = 0;
+    int flags;
+
+    while ((flags = getc (file)) != EOF)
+    {
+        size_t common, len;
+        vfs_path_t *vpath;
+
+        /* Stop on corrupted or truncated record, keep what is loaded */
+        if (!tree_store_read_number (file, &common) || !tree_store_read_number (file, &len)
+            || common > name_len || len >= sizeof (name) - common
+            || fread (name + common, 1, len, file) != len)
+            break;
+
+        name_len = common + len;
+        name[name_len] = '\0';
+
+        if (name[0] != PATH_SEP || strlen (name) != name_len)
+            break;
+
+        vpath = vfs_path_from_str (name);
+        if (vfs_file_is_local (vpath))
         {
             tree_entry *e;
-            int scanned;
-            char *lc_name;
 
-            /* Skip invalid records */
-            if ((buffer[0] != '0' && buffer[0] != '1'))
-                continue;
+            e = tree_store_add_entry (name);
+            e->scanned = (flags & TREE_BIN_SCANNED) != 0 ? 1 : 0;
+        }
+        vfs_path_free (vpath);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Loads the tree store from the specified filename */
+
+static int
+tree_store_load_from (char *name)
+{
+    FILE *file;
+    char buffer[MC_MAXPATHLEN + 20];
 
-            if (buffer[1] != ':')
-                continue;
+    g_return_val_if_fail (name != NULL, FALSE);
 
-            scanned = buffer[0] == '1';
+    if (ts.loaded)
+        return TRUE;
 
-            lc_name = decode (buffer + 2);
-            if (lc_name[0] != PATH_SEP)
-            {
-                /* Clear-text decompression */
-                char *s = strtok (lc_name, " ");
+    file = fopen (name, "r");
 
-                if (s)
-                {
-                    common = atoi (s);
-                    different = strtok (NULL, "");
-                    if (different)
-                    {
-                        vfs_path_t *vpath = vfs_path_from_str (oldname);
-                        strcpy (oldname + common, different);
-                        if (vfs_file_is_local (vpath))
-                        {
-                            e = tree_store_add_entry (oldname);
-                            e->scanned = scanned;
-                        }
-                        vfs_path_free (vpath);
-                    }
-                }
+    if (file != NULL)
+    {
+        if (fgets (buffer, sizeof (buffer), file) != NULL)
+        {
+            if (strcmp (buffer, TREE_BIN_SIGNATURE) == 0)
+            {
+                ts.loaded = TRUE;
+                tree_store_load_binary (file);
             }
-            else
+            else if (strncmp (buffer, TREE_SIGNATURE, strlen (TREE_SIGNATURE)) == 0)
             {
-                vfs_path_t *vpath = vfs_path_from_str (lc_name);
-                if (vfs_file_is_local (vpath))
-                {
-                    e = tree_store_add_entry (lc_name);
-                    e->scanned = scanned;
-                }
-                vfs_path_free (vpath);
-                strcpy (oldname, lc_name);
+                /* File of old versions, will be saved in the binary format */
+                ts.loaded = TRUE;
+                tree_store_load_text (file);
             }
-            g_free (lc_name);
         }
         fclose (file);
     }
@@ -289,101 +426,74 @@ tree_store_load_from (char *name)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/** Writes the unsigned number in 7-bit groups, least significant first */
 
-static char *
-encode (const char *string)
+static void
+tree_store_write_number (FILE * file, size_t number)
 {
-    int special_chars;
-    const char *p;
-    char *q;
-    char *res;
-
-    for (special_chars = 0, p = string; *p; p++)
-    {
-        if (*p == '\n' || *p == '\\')
-            special_chars++;
-    }
-
-    res = g_malloc (p - string + special_chars + 1);
-    for (p = string, q = res; *p; p++, q++)
+    while (number >= 0x80)
     {
-        if (*p != '\n' && *p != '\\')
-        {
-            *q = *p;
-            continue;
-        }
-
-        *q++ = '\\';
-
-        switch (*p)
-        {
-        case '\n':
-            *q = 'n';
-            break;
-
-        case '\\':
-            *q = '\\';
-            break;
-        }
+        putc ((int) ((number & 0x7f) | 0x80), file);
+        number >>= 7;
     }
-    *q = 0;
-    return res;
+    putc ((int) number, file);
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/** Saves the tree to the specified filename */
+/** Saves the tree to the specified filename in the binary format */
 
 static int
 tree_store_save_to (char *name)
 {
     tree_entry *current;
+    const char *prev_name = NULL;
     FILE *file;
+    int error = 0;
 
     file = fopen (name, "w");
     if (!file)
         return errno;
 
-    fprintf (file, "%s\n", TREE_SIGNATURE);
+    fputs (TREE_BIN_SIGNATURE, file);
 
-    current = ts.tree_first;
-    while (current)
+    for (current = ts.tree_first; current != NULL; current = current->next)
     {
-        int i, common;
         vfs_path_t *vpath = vfs_path_from_str (current->name);
 
         if (vfs_file_is_local (vpath))
         {
-            /* Clear-text compression */
-            if (current->prev && (common = str_common (current->prev->name, current->name)) > 2)
-            {
-                char *encoded = encode (current->name + common);
+            size_t common, len;
 
-                i = fprintf (file, "%d:%d %s\n", current->scanned, common, encoded);
-                g_free (encoded);
-            }
-            else
-            {
-                char *encoded = encode (current->name);
+            /* Prefix compression */
+            common = prev_name != NULL ? str_common (prev_name, current->name) : 0;
+            len = strlen (current->name + common);
 
-                i = fprintf (file, "%d:%s\n", current->scanned, encoded);
-                g_free (encoded);
-            }
+            putc (current->scanned ? TREE_BIN_SCANNED : 0, file);
+            tree_store_write_number (file, common);
+            tree_store_write_number (file, len);
+            fwrite (current->name + common, 1, len, file);
 
-            if (i == EOF)
+            if (ferror (file))
             {
+                error = errno;
                 fprintf (stderr, _("Cannot write to the %s file:\n%s\n"),
-                         name, unix_error_string (errno));
+                         name, unix_error_string (error));
                 vfs_path_free (vpath);
                 break;
             }
+
+            prev_name = current->name;
         }
         vfs_path_free (vpath);
-        current = current->next;
     }
-    tree_store_dirty (FALSE);
-    fclose (file);
 
-    return 0;
+    if (fclose (file) != 0 && error == 0)
+        error = errno;
+
+    if (error == 0)
+        tree_store_dirty (FALSE);
+
+    return error;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -391,9 +501,8 @@ tree_store_save_to (char *name)
 static tree_entry *
 tree_store_add_entry (const char *name)
 {
-    int flag = -1;
-    tree_entry *current = ts.tree_first;
-    tree_entry *old = NULL;
+    tree_entry *current;
+    tree_entry *old;
     tree_entry *new;
     int i, len;
     int submask = 0;
@@ -402,55 +511,36 @@ tree_store_add_entry (const char *name)
         abort ();
 
     /* Search for the correct place */
-    while (current && (flag = pathcmp (current->name, name)) < 0)
-    {
-        old = current;
-        current = current->next;
-    }
-
-    if (flag == 0)
+    current = tree_store_find (name, &old);
+    if (current != NULL)
         return current;         /* Already in the list */
 
     /* Not in the list -> add it */
     new = g_new0 (tree_entry, 1);
-    if (!current)
+    new->prev = old;
+    if (old)
     {
-        /* Append to the end of the list */
-        if (!ts.tree_first)
-        {
-            /* Empty list */
-            ts.tree_first = new;
-            new->prev = NULL;
-        }
-        else
-        {
-            old->next = new;
-            new->prev = old;
-        }
-        new->next = NULL;
-        ts.tree_last = new;
+        /* In the middle or at the end of the list */
+        new->next = old->next;
+        old->next = new;
     }
     else
     {
-        /* Insert in to the middle of the list */
-        new->prev = old;
-        if (old)
-        {
-            /* Yes, in the middle */
-            new->next = old->next;
-            old->next = new;
-        }
-        else
-        {
-            /* Nope, in the beginning of the list */
-            new->next = ts.tree_first;
-            ts.tree_first = new;
-        }
-        new->next->prev = new;
+        /* In the beginning of the list */
+        new->next = ts.tree_first;
+        ts.tree_first = new;
     }
 
+    if (new->next)
+        new->next->prev = new;
+    else
+        ts.tree_last = new;
+
     /* Calculate attributes */
     new->name = g_strdup (name);
+    if (ts.index == NULL)
+        ts.index = g_tree_new (tree_entry_cmp);
+    g_tree_insert (ts.index, new, new);
     len = strlen (new->name);
     new->sublevel = 0;
     for (i = 0; i < len; i++)
@@ -549,6 +639,7 @@ remove_entry (tree_entry * entry)
         ts.tree_last = entry->prev;
 
     /* Free the memory used by the entry */
+    g_tree_remove (ts.index, entry);
     g_free (entry->name);
     g_free (entry);
 
@@ -614,16 +705,7 @@ should_skip_directory (const char *dir)
 tree_entry *
 tree_store_whereis (const char *name)
 {
-    tree_entry *current = ts.tree_first;
-    int flag = -1;
-
-    while (current && (flag = pathcmp (current->name, name)) < 0)
-        current = current->next;
-
-    if (flag == 0)
-        return current;
-    else
-        return NULL;
+    return tree_store_find (name, NULL);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -743,7 +825,8 @@ tree_store_mark_checked (const char *subname)
 {
     char *name;
     tree_entry *current, *base;
-    int flag = 1, len;
+    int len;
+
     if (!ts.loaded)
         return;
 
@@ -759,11 +842,8 @@ tree_store_mark_checked (const char *subname)
         name = concat_dir_and_file (ts.check_name, subname);
 
     /* Search for the subdirectory */
-    current = ts.check_start;
-    while (current && (flag = pathcmp (current->name, name)) < 0)
-        current = current->next;
-
-    if (flag != 0)
+    current = tree_store_find (name, NULL);
+    if (current == NULL)
     {
         /* Doesn't exist -> add it */
         current = tree_store_add_entry (name);
@@ -35,6 +35,7 @@ struct TreeStore
 {
     tree_entry *tree_first;     /* First entry in the list */
     tree_entry *tree_last;      /* Last entry in the list */
+    GTree *index;               /* Entries of the list ordered by name, for fast lookup */
     tree_entry *check_start;    /* Start of checked subdirectories */
     char *check_name;
     GList *add_queue;           /* List of strings of added directories */
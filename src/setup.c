@@ -51,6 +51,9 @@
 #ifdef ENABLE_VFS_FISH
 #include "src/vfs/fish/fish.h"
 #endif
+#ifdef ENABLE_VFS_EXTFS
+#include "src/vfs/extfs/extfs.h"
+#endif
 
 #ifdef HAVE_CHARSET
 #include "lib/charsets.h"
@@ -135,6 +138,7 @@ panels_options_t panels_options = {
     .show_dot_files = TRUE,
     .fast_reload = FALSE,
     .fast_reload_msg_shown = FALSE,
+    .auto_reload = FALSE,
     .mark_moves_down = TRUE,
     .reverse_files_only = TRUE,
     .auto_save_setup = FALSE,
@@ -282,6 +286,7 @@ static const struct
     { "ftpfs_directory_timeout", &ftpfs_directory_timeout },
     { "use_netrc", &ftpfs_use_netrc },
     { "ftpfs_retry_seconds", &ftpfs_retry_seconds },
+    { "ftpfs_max_connections", &ftpfs_max_connections },
     { "ftpfs_always_use_proxy", &ftpfs_always_use_proxy },
     { "ftpfs_use_passive_connections", &ftpfs_use_passive_connections },
     { "ftpfs_use_passive_connections_over_proxy", &ftpfs_use_passive_connections_over_proxy },
@@ -290,7 +295,11 @@ static const struct
 #endif /* ENABLE_VFS_FTP */
 #ifdef ENABLE_VFS_FISH
     { "fish_directory_timeout", &fish_directory_timeout },
+    { "fish_pipeline_commands", &fish_pipeline_commands },
 #endif /* ENABLE_VFS_FISH */
+#ifdef ENABLE_VFS_EXTFS
+    { "extfs_use_listing_cache", &extfs_use_listing_cache },
+#endif /* ENABLE_VFS_EXTFS */
 #endif /* ENABLE_VFS */
     /* option_tab_spacing is used in internal viewer */
     { "editor_tab_spacing", &option_tab_spacing },
@@ -350,6 +359,7 @@ static const struct
     { "show_dot_files", &panels_options.show_dot_files },
     { "fast_reload", &panels_options.fast_reload },
     { "fast_reload_msg_shown", &panels_options.fast_reload_msg_shown },
+    { "auto_reload", &panels_options.auto_reload },
     { "mark_moves_down", &panels_options.mark_moves_down },
     { "reverse_files_only", &panels_options.reverse_files_only },
     { "auto_save_setup_panels", &panels_options.auto_save_setup },
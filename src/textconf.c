@@ -52,6 +52,9 @@ static const char *const vfs_supported[] = {
 #ifdef ENABLE_VFS_TAR
     "tarfs",
 #endif
+#ifdef ENABLE_VFS_ZIP
+    "zipfs",
+#endif
 #ifdef ENABLE_VFS_SFS
     "sfs",
 #endif
@@ -131,7 +131,7 @@ typedef struct
 {
     unsigned long inumber;
     unsigned short device;
-    struct vfs_s_inode *inode;
+    guint32 num;                /* record in the index of archive */
 } defer_inode;
 
 typedef struct
@@ -266,6 +266,7 @@ cpio_open_cpio_file (struct vfs_class *me, struct vfs_s_super *super, const char
     root->st.st_dev = MEDATA->rdev++;
 
     super->root = root;
+    vfs_s_index_init (super);
 
     CPIO_SEEK_SET (super, 0);
 
@@ -365,10 +366,10 @@ static int
 cpio_create_entry (struct vfs_class *me, struct vfs_s_super *super, struct stat *st, char *name)
 {
     cpio_super_data_t *arch = (cpio_super_data_t *) super->data;
-    struct vfs_s_inode *inode = NULL;
-    struct vfs_s_inode *root = super->root;
-    struct vfs_s_entry *entry = NULL;
-    char *tn;
+    vfs_s_index_record_t *rec;
+    guint32 num = 0, existing;
+    off_t data_offset;
+    char *linkname = NULL;
 
     switch (st->st_mode & S_IFMT)
     {                           /* For case of HP/UX archives */
@@ -397,54 +398,37 @@ cpio_create_entry (struct vfs_class *me, struct vfs_s_super *super, struct stat
 
     if ((st->st_nlink > 1) && ((arch->type == CPIO_NEWC) || (arch->type == CPIO_CRC)))
     {                           /* For case of hardlinked files */
-        defer_inode i = { st->st_ino, st->st_dev, NULL };
+        defer_inode i = { st->st_ino, st->st_dev, 0 };
         GSList *l;
 
         l = g_slist_find_custom (arch->deferred, &i, cpio_defer_find);
         if (l != NULL)
         {
-            inode = ((defer_inode *) l->data)->inode;
-            if (inode->st.st_size != 0 && st->st_size != 0 && (inode->st.st_size != st->st_size))
+            num = ((defer_inode *) l->data)->num;
+            rec = vfs_s_index_get (super, num);
+            if (rec->size != 0 && st->st_size != 0 && rec->size != (guint64) st->st_size)
             {
                 message (D_ERROR, MSG_ERROR,
                          _("Inconsistent hardlinks of\n%s\nin cpio archive\n%s"),
                          name, super->name);
-                inode = NULL;
+                num = 0;
             }
-            else if (inode->st.st_size == 0)
-                inode->st.st_size = st->st_size;
+            else if (rec->size == 0)
+                rec->size = st->st_size;
         }
     }
 
-    /* remove trailing slashes */
-    for (tn = name + strlen (name) - 1; tn >= name && *tn == PATH_SEP; tn--)
-        *tn = '\0';
-
-    tn = strrchr (name, PATH_SEP);
-    if (tn == NULL)
-        tn = name;
-    else if (tn == name + 1)
-    {
-        /* started with "./" -- directory in the root of archive */
-        tn++;
-    }
-    else
+    /* In case entry is already there */
+    existing = vfs_s_index_lookup (me, super, name);
+    if (existing != 0)
     {
-        *tn = '\0';
-        root = vfs_s_find_inode (me, super, name, LINK_FOLLOW, FL_MKDIR);
-        *tn = PATH_SEP;
-        tn++;
-    }
-
-    entry = MEDATA->find_entry (me, root, tn, LINK_FOLLOW, FL_NONE);    /* In case entry is already there */
+        rec = vfs_s_index_get (super, existing);
 
-    if (entry != NULL)
-    {
         /* This shouldn't happen! (well, it can happen if there is a record for a
            file and than a record for a directory it is in; cpio would die with
            'No such file or directory' is such case) */
 
-        if (!S_ISDIR (entry->ino->st.st_mode))
+        if (!S_ISDIR (rec->mode) || (rec->flags & VFS_S_INDEX_HARDLINK) != 0)
         {
             /* This can be considered archive inconsistency */
             message (D_ERROR, MSG_ERROR,
@@ -452,60 +436,64 @@ cpio_create_entry (struct vfs_class *me, struct vfs_s_super *super, struct stat
         }
         else
         {
-            entry->ino->st.st_mode = st->st_mode;
-            entry->ino->st.st_uid = st->st_uid;
-            entry->ino->st.st_gid = st->st_gid;
-            entry->ino->st.st_atime = st->st_atime;
-            entry->ino->st.st_mtime = st->st_mtime;
-            entry->ino->st.st_ctime = st->st_ctime;
+            rec->mode = st->st_mode;
+            rec->uid = st->st_uid;
+            rec->gid = st->st_gid;
+            rec->atime = st->st_atime;
+            rec->mtime = st->st_mtime;
+            rec->ctime = st->st_ctime;
         }
 
         g_free (name);
+        return STATUS_OK;
     }
-    else
-    {                           /* !entry */
-        if (inode == NULL)
-        {
-            inode = vfs_s_new_inode (me, super, st);
-            if ((st->st_nlink > 0) && ((arch->type == CPIO_NEWC) || (arch->type == CPIO_CRC)))
-            {
-                /* For case of hardlinked files */
-                defer_inode *i;
 
-                i = g_new (defer_inode, 1);
-                i->inumber = st->st_ino;
-                i->device = st->st_dev;
-                i->inode = inode;
+    data_offset = CPIO_POS (super);
 
-                arch->deferred = g_slist_prepend (arch->deferred, i);
-            }
-        }
-
-        if (st->st_size != 0)
-            inode->data_offset = CPIO_POS (super);
+    if (!S_ISLNK (st->st_mode))
+        CPIO_SEEK_CUR (super, st->st_size);
+    else
+    {
+        linkname = g_malloc (st->st_size + 1);
 
-        entry = vfs_s_new_entry (me, tn, inode);
-        vfs_s_insert_entry (me, root, entry);
+        if (mc_read (arch->fd, linkname, st->st_size) < st->st_size)
+        {
+            g_free (linkname);
+            g_free (name);
+            return STATUS_EOF;
+        }
 
-        g_free (name);
+        linkname[st->st_size] = '\0';      /* Linkname stored without terminating \0 !!! */
+        CPIO_POS (super) += st->st_size;
+        cpio_skip_padding (super);
+    }
 
-        if (!S_ISLNK (st->st_mode))
-            CPIO_SEEK_CUR (super, st->st_size);
-        else
+    if (num != 0)
+        vfs_s_index_add_link (me, super, name, num);
+    else
+    {
+        num = vfs_s_index_add (me, super, name, st, linkname, data_offset);
+        if (num != 0 && (st->st_nlink > 0)
+            && ((arch->type == CPIO_NEWC) || (arch->type == CPIO_CRC)))
         {
-            inode->linkname = g_malloc (st->st_size + 1);
+            /* For case of hardlinked files */
+            defer_inode *i;
 
-            if (mc_read (arch->fd, inode->linkname, st->st_size) < st->st_size)
-            {
-                inode->linkname[0] = '\0';
-                return STATUS_EOF;
-            }
+            i = g_new (defer_inode, 1);
+            i->inumber = st->st_ino;
+            i->device = st->st_dev;
+            i->num = num;
 
-            inode->linkname[st->st_size] = '\0';        /* Linkname stored without terminating \0 !!! */
-            CPIO_POS (super) += st->st_size;
-            cpio_skip_padding (super);
+            arch->deferred = g_slist_prepend (arch->deferred, i);
         }
-    }                           /* !entry */
+    }
+
+    /* data of hardlinked files is stored with one of the links */
+    if (num != 0 && st->st_size != 0)
+        vfs_s_index_get (super, num)->offset = data_offset;
+
+    g_free (linkname);
+    g_free (name);
 
     return STATUS_OK;
 }
@@ -741,6 +729,8 @@ cpio_open_archive (struct vfs_s_super *super, const vfs_path_t * vpath,
         {
         case STATUS_EOF:
             message (D_ERROR, MSG_ERROR, _("Unexpected end of file\n%s"), archive_name);
+            g_free (archive_name);
+            vfs_s_index_finish (vpath_element->class, super);
             return 0;
         case STATUS_OK:
             continue;
@@ -751,6 +741,7 @@ cpio_open_archive (struct vfs_s_super *super, const vfs_path_t * vpath,
     }
 
     g_free (archive_name);
+    vfs_s_index_finish (vpath_element->class, super);
     return 0;
 }
 
@@ -70,6 +70,7 @@
 /*** global variables ****************************************************************************/
 
 GArray *extfs_plugins = NULL;
+int extfs_use_listing_cache = 1;
 
 /*** file scope macro definitions ****************************************************************/
 
@@ -78,6 +79,21 @@ GArray *extfs_plugins = NULL;
 
 #define RECORDSIZE 512
 
+/* streamed member is extracted to the local file if the greater part of it should be skipped */
+#define EXTFS_STREAM_MAX_SKIP (1024 * 1024)
+
+/* listing cache: the file is stored and read on the same host, so native byte order is used */
+#define EXTFS_CACHE_SIGNATURE "MCEXTFS2"
+
+/* Archives modified within this number of seconds are not cached:
+   the next change could happen within the same mtime tick and stay unnoticed */
+#define EXTFS_CACHE_MTIME_GUARD 2
+
+/* cached listings unused for this number of seconds are removed */
+#define EXTFS_CACHE_MAX_AGE (30 * 24 * 60 * 60)
+/* the least recently used listings are removed if the cache grows larger */
+#define EXTFS_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 struct inode
@@ -114,6 +130,9 @@ struct pseudofile
     gboolean has_changed;
     int local_handle;
     struct entry *entry;
+    gboolean streaming;         /* data is read from the output of "cat" command */
+    FILE *stream;               /* NULL if the end of output is reached */
+    off_t pos;                  /* position in the output */
 };
 
 struct archive
@@ -134,8 +153,46 @@ typedef struct
     char *path;
     char *prefix;
     gboolean need_archive;
+    gboolean no_cat;            /* "cat" command is not supported */
 } extfs_plugin_info_t;
 
+/* Cache file is the header, the key and records of all entries except the root directory.
+ * Every record is followed by the name and the symlink target (without trailing zeros). */
+typedef struct
+{
+    char signature[8];
+    guint32 key_len;
+    guint32 count;              /* number of records */
+    guint64 size;               /* size, mtime and inode of archive file */
+    gint64 mtime;
+    guint64 ino;
+    gint64 helper_mtime;        /* mtime of plugin script */
+} extfs_cache_header_t;
+
+typedef struct
+{
+    char *name;
+    time_t mtime;
+    off_t size;
+} extfs_cache_file_t;
+
+typedef struct
+{
+    guint32 parent;             /* number of parent directory record, 0 is the root */
+    guint32 hardlink;           /* number of record which inode is shared, 0 if none */
+    guint32 mode;
+    guint32 uid;
+    guint32 gid;
+    guint32 name_len;
+    guint32 link_len;
+    guint32 reserved;
+    guint64 rdev;
+    guint64 size;
+    gint64 mtime;
+    gint64 atime;
+    gint64 ctime;
+} extfs_cache_record_t;
+
 /*** file scope variables ************************************************************************/
 
 static gboolean errloop;
@@ -384,19 +441,60 @@ extfs_free_archive (struct archive *archive)
     g_free (archive);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the archive structure with the root directory and add it to the list of
+ * opened archives. Attributes of root directory are taken from the archive file.
+ */
+
+static struct archive *
+extfs_new_archive (int fstype, const char *name, char *local_name, const struct stat *mystat)
+{
+    static dev_t archive_counter = 0;
+    mode_t mode;
+    struct archive *current_archive;
+    struct entry *root_entry;
+
+    current_archive = g_new (struct archive, 1);
+    current_archive->fstype = fstype;
+    current_archive->name = (name != NULL) ? g_strdup (name) : NULL;
+    current_archive->local_name = local_name;
+
+    if (local_name != NULL)
+        mc_stat (local_name, &current_archive->local_stat);
+    current_archive->inode_counter = 0;
+    current_archive->fd_usage = 0;
+    current_archive->rdev = archive_counter++;
+    current_archive->next = first_archive;
+    first_archive = current_archive;
+    mode = mystat->st_mode & 07777;
+    if (mode & 0400)
+        mode |= 0100;
+    if (mode & 0040)
+        mode |= 0010;
+    if (mode & 0004)
+        mode |= 0001;
+    mode |= S_IFDIR;
+    root_entry = extfs_generate_entry (current_archive, PATH_SEP_STR, NULL, mode);
+    root_entry->inode->uid = mystat->st_uid;
+    root_entry->inode->gid = mystat->st_gid;
+    root_entry->inode->atime = mystat->st_atime;
+    root_entry->inode->ctime = mystat->st_ctime;
+    root_entry->inode->mtime = mystat->st_mtime;
+    current_archive->root_entry = root_entry;
+
+    return current_archive;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static FILE *
 extfs_open_archive (int fstype, const char *name, struct archive **pparc)
 {
     const extfs_plugin_info_t *info;
-    static dev_t archive_counter = 0;
     FILE *result;
-    mode_t mode;
     char *cmd;
     struct stat mystat;
-    struct archive *current_archive;
-    struct entry *root_entry;
     char *local_name = NULL, *tmp = NULL;
     vfs_path_t *vpath;
     vfs_path_element_t *path_element = NULL;
@@ -444,38 +542,406 @@ extfs_open_archive (int fstype, const char *name, struct archive **pparc)
     setvbuf (result, NULL, _IONBF, 0);
 #endif
 
-    current_archive = g_new (struct archive, 1);
-    current_archive->fstype = fstype;
-    current_archive->name = (name != NULL) ? g_strdup (name) : NULL;
-    current_archive->local_name = local_name;
+    *pparc = extfs_new_archive (fstype, name, local_name, &mystat);
 
-    if (local_name != NULL)
-        mc_stat (local_name, &current_archive->local_stat);
-    current_archive->inode_counter = 0;
-    current_archive->fd_usage = 0;
-    current_archive->rdev = archive_counter++;
-    current_archive->next = first_archive;
-    first_archive = current_archive;
-    mode = mystat.st_mode & 07777;
-    if (mode & 0400)
-        mode |= 0100;
-    if (mode & 0040)
-        mode |= 0010;
-    if (mode & 0004)
-        mode |= 0001;
-    mode |= S_IFDIR;
-    root_entry = extfs_generate_entry (current_archive, PATH_SEP_STR, NULL, mode);
-    root_entry->inode->uid = mystat.st_uid;
-    root_entry->inode->gid = mystat.st_gid;
-    root_entry->inode->atime = mystat.st_atime;
-    root_entry->inode->ctime = mystat.st_ctime;
-    root_entry->inode->mtime = mystat.st_mtime;
-    current_archive->root_entry = root_entry;
+    vfs_path_free (vpath);
+    return result;
+}
 
-    *pparc = current_archive;
+/* --------------------------------------------------------------------------------------------- */
+/** Key of listing cache: full path of plugin script and archive name */
+
+static char *
+extfs_cache_get_key (int fstype, const char *name)
+{
+    const extfs_plugin_info_t *info;
+
+    info = &g_array_index (extfs_plugins, extfs_plugin_info_t, fstype);
+    return g_strconcat (info->path, info->prefix, "\n", name, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+extfs_cache_get_file_name (const char *key)
+{
+    char *base, *name;
+
+    base = g_strdup_printf ("%08x", g_str_hash (key));
+    name = g_build_filename (mc_config_get_cache_path (), MC_EXTFS_CACHE_DIR, base, (char *) NULL);
+    g_free (base);
+
+    return name;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if the listing of archive can be cached and get the attributes of archive and
+ * the mtime of plugin script: an updated plugin can list the same archive differently.
+ * Listings of the plugins without archive file depend on the system state, and the
+ * remote archives would need the local copy anyway.
+ */
+
+static gboolean
+extfs_cache_is_usable (int fstype, const char *name, struct stat *mystat, gint64 * helper_mtime)
+{
+    const extfs_plugin_info_t *info;
+    vfs_path_t *vpath;
+    char *helper;
+    struct stat hstat;
+    gboolean is_local;
+
+    if (!extfs_use_listing_cache || name == NULL)
+        return FALSE;
+
+    info = &g_array_index (extfs_plugins, extfs_plugin_info_t, fstype);
+    if (!info->need_archive)
+        return FALSE;
+
+    helper = g_strconcat (info->path, info->prefix, (char *) NULL);
+    is_local = stat (helper, &hstat) == 0;
+    g_free (helper);
+    if (!is_local)
+        return FALSE;
+    *helper_mtime = hstat.st_mtime;
 
+    vpath = vfs_path_from_str (name);
+    is_local = vfs_file_is_local (vpath);
     vfs_path_free (vpath);
-    return result;
+
+    return is_local && mc_stat (name, mystat) == 0 && S_ISREG (mystat->st_mode);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gint
+extfs_cache_file_cmp (gconstpointer a, gconstpointer b)
+{
+    const extfs_cache_file_t *fa = (const extfs_cache_file_t *) a;
+    const extfs_cache_file_t *fb = (const extfs_cache_file_t *) b;
+
+    return (fa->mtime < fb->mtime) ? -1 : (fa->mtime > fb->mtime) ? 1 : 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove the listings unused for EXTFS_CACHE_MAX_AGE seconds, then remove the least recently
+ * used ones until the cache fits in EXTFS_CACHE_MAX_SIZE bytes. The mtime of cache file is
+ * updated on every use.
+ */
+
+static void
+extfs_cache_prune (const char *dir_name)
+{
+    GDir *dir;
+    const char *name;
+    GArray *files;
+    off_t total = 0;
+    time_t now;
+    guint i;
+
+    dir = g_dir_open (dir_name, 0, NULL);
+    if (dir == NULL)
+        return;
+
+    files = g_array_new (FALSE, FALSE, sizeof (extfs_cache_file_t));
+    now = time (NULL);
+
+    while ((name = g_dir_read_name (dir)) != NULL)
+    {
+        extfs_cache_file_t file;
+        struct stat st;
+
+        file.name = g_build_filename (dir_name, name, (char *) NULL);
+        if (lstat (file.name, &st) != 0 || !S_ISREG (st.st_mode))
+            g_free (file.name);
+        else if (st.st_mtime + EXTFS_CACHE_MAX_AGE < now)
+        {
+            unlink (file.name);
+            g_free (file.name);
+        }
+        else
+        {
+            file.mtime = st.st_mtime;
+            file.size = st.st_size;
+            total += st.st_size;
+            g_array_append_val (files, file);
+        }
+    }
+    g_dir_close (dir);
+
+    g_array_sort (files, extfs_cache_file_cmp);
+
+    for (i = 0; i < files->len; i++)
+    {
+        extfs_cache_file_t *file = &g_array_index (files, extfs_cache_file_t, i);
+
+        if (total > EXTFS_CACHE_MAX_SIZE && unlink (file->name) == 0)
+            total -= file->size;
+        g_free (file->name);
+    }
+
+    g_array_free (files, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Store the records of directory entries. Directories are written before their contents,
+ * so the parent record always precedes the child one.
+ * Return FALSE if the tree cannot be represented in the cache.
+ */
+
+static gboolean
+extfs_cache_save_dir (GByteArray * buf, GHashTable * inodes, const struct entry *dir,
+                      guint32 dir_num, guint32 * count)
+{
+    const struct entry *e;
+
+    for (e = dir->inode->first_in_subdir; e != NULL; e = e->next_in_dir)
+    {
+        extfs_cache_record_t rec;
+        gpointer num;
+
+        /* created by extfs_make_dots() */
+        if (strcmp (e->name, ".") == 0 || strcmp (e->name, "..") == 0)
+            continue;
+
+        /* hard link to the root directory */
+        if (e->inode == e->inode->archive->root_entry->inode)
+            return FALSE;
+
+        (*count)++;
+
+        memset (&rec, 0, sizeof (rec));
+        rec.parent = dir_num;
+        rec.name_len = strlen (e->name);
+
+        num = g_hash_table_lookup (inodes, e->inode);
+        if (num != NULL)
+            rec.hardlink = GPOINTER_TO_UINT (num);
+        else
+        {
+            const struct inode *inode = e->inode;
+
+            g_hash_table_insert (inodes, e->inode, GUINT_TO_POINTER (*count));
+            rec.mode = inode->mode;
+            rec.uid = inode->uid;
+            rec.gid = inode->gid;
+            rec.rdev = inode->rdev;
+            rec.size = inode->size;
+            rec.mtime = inode->mtime;
+            rec.atime = inode->atime;
+            rec.ctime = inode->ctime;
+            if (inode->linkname != NULL)
+                rec.link_len = strlen (inode->linkname);
+        }
+
+        g_byte_array_append (buf, (const guint8 *) &rec, sizeof (rec));
+        g_byte_array_append (buf, (const guint8 *) e->name, rec.name_len);
+        if (rec.link_len != 0)
+            g_byte_array_append (buf, (const guint8 *) e->inode->linkname, rec.link_len);
+
+        if (rec.hardlink == 0 && S_ISDIR (rec.mode)
+            && !extfs_cache_save_dir (buf, inodes, e, *count, count))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write the just read listing of archive to the cache */
+
+static void
+extfs_cache_save (const struct archive *archive)
+{
+    struct stat mystat;
+    extfs_cache_header_t header;
+    GByteArray *buf;
+    GHashTable *inodes;
+    char *key, *file_name, *dir_name;
+    gint64 helper_mtime;
+    gboolean ok;
+
+    if (!extfs_cache_is_usable (archive->fstype, archive->name, &mystat, &helper_mtime))
+        return;
+
+    /* archive has been changed while being listed or is being changed now */
+    if (mystat.st_mtime != archive->root_entry->inode->mtime
+        || mystat.st_mtime + EXTFS_CACHE_MTIME_GUARD > time (NULL))
+        return;
+
+    key = extfs_cache_get_key (archive->fstype, archive->name);
+
+    memset (&header, 0, sizeof (header));
+    memcpy (header.signature, EXTFS_CACHE_SIGNATURE, sizeof (header.signature));
+    header.size = mystat.st_size;
+    header.mtime = mystat.st_mtime;
+    header.ino = mystat.st_ino;
+    header.helper_mtime = helper_mtime;
+    header.key_len = strlen (key);
+
+    buf = g_byte_array_sized_new (BUF_8K);
+    g_byte_array_append (buf, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (buf, (const guint8 *) key, header.key_len);
+
+    inodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    ok = extfs_cache_save_dir (buf, inodes, archive->root_entry, 0, &header.count);
+    g_hash_table_destroy (inodes);
+
+    file_name = extfs_cache_get_file_name (key);
+    g_free (key);
+
+    if (ok)
+    {
+        /* number of records is known at the end only */
+        memcpy (buf->data, &header, sizeof (header));
+
+        dir_name = g_path_get_dirname (file_name);
+        g_mkdir_with_parents (dir_name, 0700);
+        extfs_cache_prune (dir_name);
+        g_free (dir_name);
+
+        g_file_set_contents (file_name, (const gchar *) buf->data, buf->len, NULL);
+    }
+
+    g_free (file_name);
+    g_byte_array_free (buf, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Build the tree of archive from the cached listing without running the plugin.
+ * Return TRUE on success, FALSE if the cache is missed, outdated or damaged.
+ */
+
+static gboolean
+extfs_cache_load (int fstype, const char *name, struct archive **pparc)
+{
+    struct stat mystat;
+    extfs_cache_header_t header;
+    struct archive *current_archive;
+    struct entry **entries;
+    char *key, *file_name, *data;
+    const char *p, *end;
+    gsize len;
+    gint64 helper_mtime;
+    guint32 i;
+
+    if (!extfs_cache_is_usable (fstype, name, &mystat, &helper_mtime))
+        return FALSE;
+
+    key = extfs_cache_get_key (fstype, name);
+    file_name = extfs_cache_get_file_name (key);
+    if (!g_file_get_contents (file_name, &data, &len, NULL))
+        data = NULL;
+
+    if (data == NULL || len < sizeof (header))
+        goto miss;
+
+    memcpy (&header, data, sizeof (header));
+    p = data + sizeof (header);
+    end = data + len;
+
+    if (memcmp (header.signature, EXTFS_CACHE_SIGNATURE, sizeof (header.signature)) != 0
+        || header.size != (guint64) mystat.st_size || header.mtime != (gint64) mystat.st_mtime
+        || header.ino != (guint64) mystat.st_ino || header.helper_mtime != helper_mtime
+        || header.key_len != strlen (key)
+        || (size_t) (end - p) < header.key_len || memcmp (p, key, header.key_len) != 0
+        || (size_t) (end - p) / sizeof (extfs_cache_record_t) < header.count)
+        goto miss;
+
+    p += header.key_len;
+
+    current_archive = extfs_new_archive (fstype, name, NULL, &mystat);
+
+    entries = g_new (struct entry *, header.count + 1);
+    entries[0] = current_archive->root_entry;
+
+    for (i = 1; i <= header.count; i++)
+    {
+        extfs_cache_record_t rec;
+        struct entry *entry, *pent;
+
+        if ((size_t) (end - p) < sizeof (rec))
+            break;
+        memcpy (&rec, p, sizeof (rec));
+        p += sizeof (rec);
+
+        if (rec.parent >= i || rec.hardlink >= i || rec.name_len == 0
+            || (size_t) (end - p) < (size_t) rec.name_len + rec.link_len)
+            break;
+
+        pent = entries[rec.parent];
+        if (!S_ISDIR (pent->inode->mode) || pent->inode->last_in_subdir == NULL)
+            break;
+
+        entry = g_new (struct entry, 1);
+        entry->name = g_strndup (p, rec.name_len);
+        p += rec.name_len;
+        entry->next_in_dir = NULL;
+        entry->dir = pent;
+        pent->inode->last_in_subdir->next_in_dir = entry;
+        pent->inode->last_in_subdir = entry;
+
+        if (rec.hardlink != 0)
+        {
+            entry->inode = entries[rec.hardlink]->inode;
+            entry->inode->nlink++;
+        }
+        else
+        {
+            struct inode *inode;
+
+            inode = g_new (struct inode, 1);
+            entry->inode = inode;
+            inode->local_filename = NULL;
+            inode->inode = (current_archive->inode_counter)++;
+            inode->nlink = 1;
+            inode->dev = current_archive->rdev;
+            inode->archive = current_archive;
+            inode->mode = rec.mode;
+            inode->rdev = rec.rdev;
+            inode->uid = rec.uid;
+            inode->gid = rec.gid;
+            inode->size = rec.size;
+            inode->mtime = rec.mtime;
+            inode->atime = rec.atime;
+            inode->ctime = rec.ctime;
+            inode->first_in_subdir = NULL;
+            inode->last_in_subdir = NULL;
+            inode->linkname = (rec.link_len == 0) ? NULL : g_strndup (p, rec.link_len);
+            if (S_ISDIR (inode->mode))
+                extfs_make_dots (entry);
+        }
+        p += rec.link_len;
+
+        entries[i] = entry;
+    }
+
+    g_free (entries);
+
+    if (i <= header.count || p != end)
+    {
+        /* damaged cache */
+        extfs_free (current_archive);
+        goto miss;
+    }
+
+    /* keep recently used listings on pruning */
+    utime (file_name, NULL);
+
+    g_free (file_name);
+    g_free (data);
+    g_free (key);
+    *pparc = current_archive;
+    return TRUE;
+
+  miss:
+    g_free (file_name);
+    g_free (data);
+    g_free (key);
+    return FALSE;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -493,6 +959,9 @@ extfs_read_archive (int fstype, const char *name, struct archive **pparc)
     struct archive *current_archive;
     char *current_file_name, *current_link_name;
 
+    if (extfs_cache_load (fstype, name, pparc))
+        return 0;
+
     info = &g_array_index (extfs_plugins, extfs_plugin_info_t, fstype);
 
     extfsd = extfs_open_archive (fstype, name, &current_archive);
@@ -623,6 +1092,7 @@ extfs_read_archive (int fstype, const char *name, struct archive **pparc)
     }
 
     close_error_pipe (D_ERROR, NULL);
+    extfs_cache_save (current_archive);
     *pparc = current_archive;
     return 0;
 }
@@ -818,9 +1288,9 @@ extfs_get_archive_name (struct archive *archive)
 /* --------------------------------------------------------------------------------------------- */
 /** Don't pass localname as NULL */
 
-static int
-extfs_cmd (const char *str_extfs_cmd, struct archive *archive,
-           struct entry *entry, const char *localname)
+static char *
+extfs_get_cmd (const char *str_extfs_cmd, struct archive *archive,
+               struct entry *entry, const char *localname)
 {
     char *file;
     char *quoted_file;
@@ -828,7 +1298,6 @@ extfs_cmd (const char *str_extfs_cmd, struct archive *archive,
     char *archive_name, *quoted_archive_name;
     const extfs_plugin_info_t *info;
     char *cmd;
-    int retval;
 
     file = extfs_get_path_from_entry (entry);
     quoted_file = name_quote (file, 0);
@@ -845,6 +1314,21 @@ extfs_cmd (const char *str_extfs_cmd, struct archive *archive,
     g_free (quoted_localname);
     g_free (quoted_archive_name);
 
+    return cmd;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Don't pass localname as NULL */
+
+static int
+extfs_cmd (const char *str_extfs_cmd, struct archive *archive,
+           struct entry *entry, const char *localname)
+{
+    char *cmd;
+    int retval;
+
+    cmd = extfs_get_cmd (str_extfs_cmd, archive, entry, localname);
+
     open_error_pipe ();
     retval = my_system (EXECUTE_AS_SHELL, shell, cmd);
     g_free (cmd);
@@ -882,15 +1366,146 @@ extfs_run (const vfs_path_t * vpath)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Extract the member to the temporary file, which is kept until the archive is freed.
+ * Return 0 on success, -1 on error.
+ */
+
+static int
+extfs_copyout (struct archive *archive, struct entry *entry, gboolean created, int flags)
+{
+    char *local_filename;
+    int local_handle;
+
+    local_handle = vfs_mkstemps (&local_filename, "extfs", entry->name);
+
+    if (local_handle == -1)
+        return -1;
+    close (local_handle);
+
+    if (!created && ((flags & O_TRUNC) == 0)
+        && extfs_cmd (" copyout ", archive, entry, local_filename))
+    {
+        unlink (local_filename);
+        g_free (local_filename);
+        my_errno = EIO;
+        return -1;
+    }
+    entry->inode->local_filename = local_filename;
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start extraction of the member to the pipe with "cat" command of plugin.
+ * Errors are reported by the exit code: the member is extracted with "copyout" then.
+ */
+
+static FILE *
+extfs_stream_open (struct archive *archive, struct entry *entry)
+{
+    char *cmd, *full_cmd;
+    FILE *stream;
+
+    cmd = extfs_get_cmd (" cat ", archive, entry, "");
+    full_cmd = g_strconcat (cmd, " 2>/dev/null", (char *) NULL);
+    g_free (cmd);
+
+    stream = popen (full_cmd, "r");
+    g_free (full_cmd);
+
+    return stream;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop streaming of the member and continue with the local copy from the current position.
+ * Used when the seek back is required or plugin doesn't support "cat" command.
+ * Return 0 on success, -1 on error.
+ */
+
+static int
+extfs_stream_to_local (struct pseudofile *file)
+{
+    struct inode *inode = file->entry->inode;
+
+    if (file->stream != NULL)
+    {
+        pclose (file->stream);
+        file->stream = NULL;
+    }
+    file->streaming = FALSE;
+
+    if (inode->local_filename == NULL
+        && extfs_copyout (file->archive, file->entry, FALSE, O_RDONLY) != 0)
+        return -1;
+
+    file->local_handle = open (inode->local_filename, O_RDONLY);
+    if (file->local_handle == -1)
+        ERRNOR (EIO, -1);
+
+    if (lseek (file->local_handle, file->pos, SEEK_SET) == -1)
+        ERRNOR (errno, -1);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ssize_t
+extfs_stream_read (struct pseudofile *file, char *buffer, size_t count)
+{
+    extfs_plugin_info_t *info;
+    ssize_t n;
+    int status;
+
+    if (file->stream == NULL)
+        return 0;
+
+    while ((n = read (fileno (file->stream), buffer, count)) == -1 && errno == EINTR)
+        ;
+
+    if (n > 0)
+    {
+        file->pos += n;
+        return n;
+    }
+
+    if (n == -1)
+        ERRNOR (errno, -1);
+
+    status = pclose (file->stream);
+    file->stream = NULL;
+
+    if (file->pos == 0 && (status != 0 || file->entry->inode->size != 0))
+    {
+        /* nothing is extracted: plugin doesn't know the "cat" command */
+        info = &g_array_index (extfs_plugins, extfs_plugin_info_t, file->archive->fstype);
+        info->no_cat = TRUE;
+
+        if (extfs_stream_to_local (file) != 0)
+            return -1;
+        return read (file->local_handle, buffer, count);
+    }
+
+    if (status != 0)
+        ERRNOR (EIO, -1);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void *
-extfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
+extfs_open_file (const vfs_path_t * vpath, int flags, mode_t mode, gboolean allow_stream)
 {
     struct pseudofile *extfs_info;
     struct archive *archive = NULL;
     char *q;
     struct entry *entry;
-    int local_handle;
+    int local_handle = -1;
     gboolean created = FALSE;
+    FILE *stream = NULL;
 
     q = extfs_get_path (vpath, &archive, FALSE);
     if (q == NULL)
@@ -913,44 +1528,39 @@ extfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
     if (S_ISDIR (entry->inode->mode))
         ERRNOR (EISDIR, NULL);
 
-    if (entry->inode->local_filename == NULL)
+    /* sequential reader gets the data at once, without waiting for the whole member */
+    if (allow_stream && entry->inode->local_filename == NULL
+        && (flags & (O_ACCMODE | O_CREAT | O_TRUNC)) == O_RDONLY
+        && !g_array_index (extfs_plugins, extfs_plugin_info_t, archive->fstype).no_cat)
+        stream = extfs_stream_open (archive, entry);
+
+    if (stream == NULL)
     {
-        char *local_filename;
+        if (entry->inode->local_filename == NULL
+            && extfs_copyout (archive, entry, created, flags) != 0)
+            return NULL;
 
-        local_handle = vfs_mkstemps (&local_filename, "extfs", entry->name);
+        local_handle = open (entry->inode->local_filename, NO_LINEAR (flags), mode);
 
         if (local_handle == -1)
-            return NULL;
-        close (local_handle);
-
-        if (!created && ((flags & O_TRUNC) == 0)
-            && extfs_cmd (" copyout ", archive, entry, local_filename))
         {
-            unlink (local_filename);
-            g_free (local_filename);
-            my_errno = EIO;
-            return NULL;
+            /* file exists(may be). Need to drop O_CREAT flag and truncate file content */
+            flags = ~O_CREAT & (NO_LINEAR (flags) | O_TRUNC);
+            local_handle = open (entry->inode->local_filename, flags, mode);
         }
-        entry->inode->local_filename = local_filename;
-    }
 
-    local_handle = open (entry->inode->local_filename, NO_LINEAR (flags), mode);
-
-    if (local_handle == -1)
-    {
-        /* file exists(may be). Need to drop O_CREAT flag and truncate file content */
-        flags = ~O_CREAT & (NO_LINEAR (flags) | O_TRUNC);
-        local_handle = open (entry->inode->local_filename, flags, mode);
+        if (local_handle == -1)
+            ERRNOR (EIO, NULL);
     }
 
-    if (local_handle == -1)
-        ERRNOR (EIO, NULL);
-
     extfs_info = g_new (struct pseudofile, 1);
     extfs_info->archive = archive;
     extfs_info->entry = entry;
     extfs_info->has_changed = created;
     extfs_info->local_handle = local_handle;
+    extfs_info->streaming = (stream != NULL);
+    extfs_info->stream = stream;
+    extfs_info->pos = 0;
 
     /* i.e. we had no open files and now we have one */
     vfs_rmstamp (&vfs_extfs_ops, (vfsid) archive);
@@ -960,11 +1570,22 @@ extfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static void *
+extfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
+{
+    return extfs_open_file (vpath, flags, mode, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static ssize_t
 extfs_read (void *data, char *buffer, size_t count)
 {
     struct pseudofile *file = (struct pseudofile *) data;
 
+    if (file->streaming)
+        return extfs_stream_read (file, buffer, count);
+
     return read (file->local_handle, buffer, count);
 }
 
@@ -977,7 +1598,10 @@ extfs_close (void *data)
     int errno_code = 0;
     file = (struct pseudofile *) data;
 
-    close (file->local_handle);
+    if (file->stream != NULL)
+        pclose (file->stream);
+    if (file->local_handle != -1)
+        close (file->local_handle);
 
     /* Commit the file if it has changed */
     if (file->has_changed)
@@ -1367,6 +1991,55 @@ extfs_lseek (void *data, off_t offset, int whence)
 {
     struct pseudofile *file = (struct pseudofile *) data;
 
+    if (file->streaming)
+    {
+        off_t target;
+
+        switch (whence)
+        {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = file->pos + offset;
+            break;
+        case SEEK_END:
+            target = file->entry->inode->size + offset;
+            break;
+        default:
+            ERRNOR (EINVAL, -1);
+        }
+
+        if (target < 0)
+            ERRNOR (EINVAL, -1);
+
+        /* short skip forward is done by reading of the pipe */
+        if (target >= file->pos && target - file->pos <= EXTFS_STREAM_MAX_SKIP)
+        {
+            char buf[BUF_8K];
+
+            while (file->streaming && file->stream != NULL && file->pos < target)
+            {
+                ssize_t n;
+
+                n = extfs_stream_read (file, buf, MIN ((off_t) sizeof (buf), target - file->pos));
+                if (n == -1)
+                    return -1;
+            }
+
+            /* plugin has turned out not to support streaming */
+            if (!file->streaming)
+                return lseek (file->local_handle, target, SEEK_SET);
+
+            if (file->pos == target)
+                return target;
+        }
+
+        if (extfs_stream_to_local (file) != 0)
+            return -1;
+        return lseek (file->local_handle, target, SEEK_SET);
+    }
+
     return lseek (file->local_handle, offset, whence);
 }
 
@@ -1500,7 +2173,7 @@ extfs_getlocalcopy (const vfs_path_t * vpath)
     struct pseudofile *fp;
     char *p;
 
-    fp = (struct pseudofile *) extfs_open (vpath, O_RDONLY, 0);
+    fp = (struct pseudofile *) extfs_open_file (vpath, O_RDONLY, 0, FALSE);
     if (fp == NULL)
         return NULL;
     if (fp->entry->inode->local_filename == NULL)
@@ -1521,7 +2194,7 @@ extfs_ungetlocalcopy (const vfs_path_t * vpath, const char *local, int has_chang
 {
     struct pseudofile *fp;
 
-    fp = (struct pseudofile *) extfs_open (vpath, O_RDONLY, 0);
+    fp = (struct pseudofile *) extfs_open_file (vpath, O_RDONLY, 0, FALSE);
     if (fp == NULL)
         return 0;
 
@@ -1596,6 +2269,7 @@ extfs_get_plugins (const char *where, gboolean silent)
                  */
                 len = strlen (filename);
                 info.need_archive = (filename[len - 1] != '+');
+                info.no_cat = FALSE;
                 info.path = g_strconcat (dirname, PATH_SEP_STR, (char *) NULL);
                 info.prefix = g_strdup (filename);
 
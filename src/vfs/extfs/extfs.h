@@ -9,6 +9,8 @@
 
 /*** global variables defined in .c file *********************************************************/
 
+extern int extfs_use_listing_cache;
+
 /*** declarations of public functions ************************************************************/
 
 void init_extfs (void);
@@ -82,6 +82,7 @@
 /*** global variables ****************************************************************************/
 
 int fish_directory_timeout = 900;
+int fish_pipeline_commands = 0;
 
 /*** file scope macro definitions ****************************************************************/
 
@@ -94,6 +95,7 @@ int fish_directory_timeout = 900;
 
 #define OPT_FLUSH        1
 #define OPT_IGNORE_ERROR 2
+#define OPT_PIPELINE     4
 
 /*
  * Reply codes.
@@ -108,6 +110,10 @@ int fish_directory_timeout = 900;
 #define NONE        0x00
 #define WAIT_REPLY  0x01
 #define WANT_STRING 0x02
+#define PIPELINE    0x04        /* don't wait for reply, it will be read later */
+
+/* Max number of commands sent without reading their replies */
+#define FISH_PIPELINE_MAX 32
 
 /* environment flags */
 #define FISH_HAVE_HEAD         1
@@ -142,6 +148,7 @@ typedef struct
     char *scr_info;
     int host_flags;
     char *scr_env;
+    int pipelined;              /* number of commands whose replies are not read yet */
 } fish_super_data_t;
 
 typedef struct
@@ -208,14 +215,14 @@ fish_decode_reply (char *s, int was_garbage)
 /* Returns a reply code, check /usr/include/arpa/ftp.h for possible values */
 
 static int
-fish_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_len)
+fish_get_reply (struct vfs_class *me, vfs_s_reader_t * reader, char *string_buf, int string_len)
 {
     char answer[BUF_1K];
     int was_garbage = 0;
 
     for (;;)
     {
-        if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+        if (!vfs_s_get_line (me, reader, answer, sizeof (answer), '\n'))
         {
             if (string_buf)
                 *string_buf = 0;
@@ -235,6 +242,22 @@ fish_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_len
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Read the replies of pipelined commands. The replies come in order the commands were sent,
+ * so they should be read before the reply of any following command.
+ * Failed commands are only reported: their callers got success already.
+ */
+
+static void
+fish_pipeline_flush (struct vfs_class *me, struct vfs_s_super *super)
+{
+    for (; SUP->pipelined > 0; SUP->pipelined--)
+        if (fish_get_reply (me, super->reader, NULL, 0) != COMPLETE)
+            vfs_print_message (_("fish: Pipelined command failed"));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 fish_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply, const char *fmt, ...)
 {
@@ -264,8 +287,18 @@ fish_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply, c
     if (status < 0)
         return TRANSIENT;
 
+    if ((wait_reply & PIPELINE) != 0)
+    {
+        if (++SUP->pipelined >= FISH_PIPELINE_MAX)
+            fish_pipeline_flush (me, super);
+        return COMPLETE;
+    }
+
+    /* the pending replies are read while the new command is being executed */
+    fish_pipeline_flush (me, super);
+
     if (wait_reply)
-        return fish_get_reply (me, SUP->sockr,
+        return fish_get_reply (me, super->reader,
                                (wait_reply & WANT_STRING) ? reply_str :
                                NULL, sizeof (reply_str) - 1);
     return COMPLETE;
@@ -325,6 +358,7 @@ fish_pipeopen (struct vfs_s_super *super, const char *path, const char *argv[])
         SUP->sockw = fileset1[1];
         close (fileset2[1]);
         SUP->sockr = fileset2[0];
+        vfs_s_reader_set_fd (super->reader, SUP->sockr);
     }
     else
     {
@@ -388,7 +422,7 @@ fish_info (struct vfs_class *me, struct vfs_s_super *super)
         {
             int res;
 
-            res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), SUP->sockr);
+            res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), super->reader);
             if ((res == 0) || (res == EINTR))
                 ERRNOR (ECONNRESET, FALSE);
             if (strncmp (buffer, "### ", 4) == 0)
@@ -468,7 +502,7 @@ fish_open_archive_talk (struct vfs_class *me, struct vfs_s_super *super)
 
     printf ("\n%s\n", _("fish: Waiting for initial line..."));
 
-    if (!vfs_s_get_line (me, SUP->sockr, answer, sizeof (answer), ':'))
+    if (!vfs_s_get_line (me, super->reader, answer, sizeof (answer), ':'))
         return FALSE;
 
     if (strstr (answer, "assword") != NULL)
@@ -686,7 +720,7 @@ fish_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path)
     ent = vfs_s_generate_entry (me, NULL, dir, 0);
     while (TRUE)
     {
-        int res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), SUP->sockr);
+        int res = vfs_s_get_line_interruptible (me, buffer, sizeof (buffer), super->reader);
         if ((!res) || (res == EINTR))
         {
             vfs_s_free_entry (me, ent);
@@ -968,13 +1002,13 @@ fish_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, char
     close (h);
     g_free (quoted_name);
 
-    if ((fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE) || was_error)
+    if ((fish_get_reply (me, super->reader, NULL, 0) != COMPLETE) || was_error)
         ERRNOR (E_REMOTE, -1);
     return 0;
 
   error_return:
     close (h);
-    fish_get_reply (me, SUP->sockr, NULL, 0);
+    fish_get_reply (me, super->reader, NULL, 0);
     g_free (quoted_name);
     return -1;
 }
@@ -1047,7 +1081,7 @@ fish_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         n = MIN (sizeof (buffer), (size_t) (fish->total - fish->got));
         if (n != 0)
         {
-            n = read (SUP->sockr, buffer, n);
+            n = vfs_s_reader_read (super->reader, buffer, n);
             if (n < 0)
                 return;
             fish->got += n;
@@ -1055,7 +1089,7 @@ fish_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
     }
     while (n != 0);
 
-    if (fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE)
+    if (fish_get_reply (me, super->reader, NULL, 0) != COMPLETE)
         vfs_print_message (_("Error reported after abort."));
     else
         vfs_print_message (_("Aborted transfer would be successful."));
@@ -1073,7 +1107,7 @@ fish_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, size
 
     len = MIN ((size_t) (fish->total - fish->got), len);
     tty_disable_interrupt_key ();
-    while (len != 0 && ((n = read (SUP->sockr, buf, len)) < 0))
+    while (len != 0 && ((n = vfs_s_reader_read (super->reader, buf, len)) < 0))
     {
         if ((errno == EINTR) && !tty_got_interrupt ())
             continue;
@@ -1085,7 +1119,7 @@ fish_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, size
         fish->got += n;
     else if (n < 0)
         fish_linear_abort (me, fh);
-    else if (fish_get_reply (me, SUP->sockr, NULL, 0) != COMPLETE)
+    else if (fish_get_reply (me, super->reader, NULL, 0) != COMPLETE)
         ERRNOR (E_REMOTE, -1);
     ERRNOR (errno, n);
 }
@@ -1140,7 +1174,7 @@ fish_send_command (struct vfs_class *me, struct vfs_s_super *super, const char *
 {
     int r;
 
-    r = fish_command (me, super, WAIT_REPLY, "%s", cmd);
+    r = fish_command (me, super, (flags & OPT_PIPELINE) != 0 ? PIPELINE : WAIT_REPLY, "%s", cmd);
     vfs_stamp_create (&vfs_fish_ops, super);
     if (r != COMPLETE)
         ERRNOR (E_REMOTE, -1);
@@ -1268,7 +1302,8 @@ fish_chmod (const vfs_path_t * vpath, mode_t mode)
     g_snprintf (buf, sizeof (buf), shell_commands, rpath, (int) (mode & 07777));
     g_free (shell_commands);
     g_free (rpath);
-    return fish_send_command (path_element->class, super, buf, OPT_FLUSH);
+    return fish_send_command (path_element->class, super, buf,
+                              fish_pipeline_commands ? OPT_FLUSH | OPT_PIPELINE : OPT_FLUSH);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1312,11 +1347,10 @@ fish_chown (const vfs_path_t * vpath, uid_t owner, gid_t group)
                                       SUP->scr_chown, (char *) NULL);
         g_snprintf (buf, sizeof (buf), shell_commands, rpath, sowner, sgroup);
         g_free (shell_commands);
-        fish_send_command (path_element->class, super, buf, OPT_FLUSH);
-        /* FIXME: what should we report if chgrp succeeds but chown fails? */
-        /* fish_send_command(me, super, buf, OPT_FLUSH); */
         g_free (rpath);
-        return fish_send_command (path_element->class, super, buf, OPT_FLUSH);
+        /* owner and group are changed by one script */
+        return fish_send_command (path_element->class, super, buf,
+                                  fish_pipeline_commands ? OPT_FLUSH | OPT_PIPELINE : OPT_FLUSH);
     }
 }
 
@@ -117,6 +117,9 @@ What to do with this?
 /* Delay to retry a connection */
 int ftpfs_retry_seconds = 30;
 
+/* Max number of control connections to the one server (including the primary one) */
+int ftpfs_max_connections = 4;
+
 /* Method to use to connect to ftp sites */
 int ftpfs_use_passive_connections = 1;
 int ftpfs_use_passive_connections_over_proxy = 0;
@@ -155,6 +158,8 @@ int ftpfs_ignore_chattr_errors = 1;
 #define UPLOAD_ZERO_LENGTH_FILE
 #define SUP ((ftp_super_data_t *) super->data)
 #define FH_SOCK ((ftp_fh_data_t *) fh->data)->sock
+#define FH_CONN ((ftp_fh_data_t *) fh->data)->conn
+#define CONN_SUP(conn) ((ftp_super_data_t *) (conn)->data)
 
 #ifndef INADDR_NONE
 #define INADDR_NONE 0xffffffff
@@ -216,13 +221,17 @@ typedef struct
                                  * "LIST -la <path>"; use "CWD <path>"/
                                  * "LIST" instead
                                  */
-    int ctl_connection_busy;
+    int mlsd_unsupported;       /* ftp server doesn't understand "MLSD <path>" */
+    int ctl_connection_busy;    /* data transfer is in progress on this connection */
+    vfs_file_handler_t *linear_fh;      /* file being read on this connection */
+    GList *pool;                /* extra control connections (struct vfs_s_super *) */
 } ftp_super_data_t;
 
 typedef struct
 {
     int sock;
     int append;
+    struct vfs_s_super *conn;   /* control connection of the data transfer */
 } ftp_fh_data_t;
 
 /*** file scope variables ************************************************************************/
@@ -269,6 +278,7 @@ static int ftpfs_open_socket (struct vfs_class *me, struct vfs_s_super *super);
 static int ftpfs_login_server (struct vfs_class *me, struct vfs_s_super *super,
                                const char *netrcpass);
 static int ftpfs_netrc_lookup (const char *host, char **login, char **pass);
+static void ftpfs_pool_free_connection (struct vfs_class *me, struct vfs_s_super *conn);
 
 /* --------------------------------------------------------------------------------------------- */
 
@@ -369,14 +379,14 @@ ftpfs_correct_url_parameters (const vfs_path_element_t * velement)
 /* Returns a reply code, check /usr/include/arpa/ftp.h for possible values */
 
 static int
-ftpfs_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_len)
+ftpfs_get_reply (struct vfs_class *me, vfs_s_reader_t * reader, char *string_buf, int string_len)
 {
     char answer[BUF_1K];
     int i;
 
     for (;;)
     {
-        if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+        if (!vfs_s_get_line (me, reader, answer, sizeof (answer), '\n'))
         {
             if (string_buf)
                 *string_buf = 0;
@@ -395,7 +405,7 @@ ftpfs_get_reply (struct vfs_class *me, int sock, char *string_buf, int string_le
             {
                 while (1)
                 {
-                    if (!vfs_s_get_line (me, sock, answer, sizeof (answer), '\n'))
+                    if (!vfs_s_get_line (me, reader, answer, sizeof (answer), '\n'))
                     {
                         if (string_buf)
                             *string_buf = 0;
@@ -427,6 +437,7 @@ ftpfs_reconnect (struct vfs_class *me, struct vfs_s_super *super)
 
         close (SUP->sock);
         SUP->sock = sock;
+        vfs_s_reader_set_fd (super->reader, sock);
         super->path_element->path = NULL;
 
 
@@ -514,7 +525,7 @@ ftpfs_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply,
 
     if (wait_reply)
     {
-        status = ftpfs_get_reply (me, SUP->sock,
+        status = ftpfs_get_reply (me, super->reader,
                                   (wait_reply & WANT_STRING) ? reply_str : NULL,
                                   sizeof (reply_str) - 1);
         if ((wait_reply & WANT_STRING) && !retry && !level && code == 421)
@@ -541,6 +552,14 @@ ftpfs_command (struct vfs_class *me, struct vfs_s_super *super, int wait_reply,
 static void
 ftpfs_free_archive (struct vfs_class *me, struct vfs_s_super *super)
 {
+    while (SUP->pool != NULL)
+    {
+        struct vfs_s_super *conn = (struct vfs_s_super *) SUP->pool->data;
+
+        SUP->pool = g_list_delete_link (SUP->pool, SUP->pool);
+        ftpfs_pool_free_connection (me, conn);
+    }
+
     if (SUP->sock != -1)
     {
         vfs_print_message (_("ftpfs: Disconnecting from %s"), super->path_element->host);
@@ -621,7 +640,7 @@ ftpfs_login_server (struct vfs_class *me, struct vfs_s_super *super, const char
     else
         name = g_strdup (super->path_element->user);
 
-    if (ftpfs_get_reply (me, SUP->sock, reply_string, sizeof (reply_string) - 1) == COMPLETE)
+    if (ftpfs_get_reply (me, super->reader, reply_string, sizeof (reply_string) - 1) == COMPLETE)
     {
         char *reply_up;
 
@@ -923,6 +942,7 @@ ftpfs_open_archive_int (struct vfs_class *me, struct vfs_s_super *super)
         SUP->sock = ftpfs_open_socket (me, super);
         if (SUP->sock == -1)
             return -1;
+        vfs_s_reader_set_fd (super->reader, SUP->sock);
 
         if (ftpfs_login_server (me, super, NULL) != 0)
         {
@@ -936,6 +956,7 @@ ftpfs_open_archive_int (struct vfs_class *me, struct vfs_s_super *super)
 
             /* Close only the socket descriptor */
             close (SUP->sock);
+            SUP->sock = -1;
 
             if (ftpfs_retry_seconds != 0)
             {
@@ -1023,7 +1044,7 @@ ftpfs_get_current_directory (struct vfs_class *me, struct vfs_s_super *super)
     char buf[BUF_8K], *bufp, *bufq;
 
     if (ftpfs_command (me, super, NONE, "PWD") == COMPLETE &&
-        ftpfs_get_reply (me, SUP->sock, buf, sizeof (buf)) == COMPLETE)
+        ftpfs_get_reply (me, super->reader, buf, sizeof (buf)) == COMPLETE)
     {
         bufp = NULL;
         for (bufq = buf; *bufq; bufq++)
@@ -1398,18 +1419,120 @@ ftpfs_open_data_connection (struct vfs_class *me, struct vfs_s_super *super, con
     return data;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the data connection. The idle control connection could be closed by server
+ * meanwhile: in this case relogin and try again.
+ */
+
+static int
+ftpfs_pool_open_data_connection (struct vfs_class *me, struct vfs_s_super *conn, const char *cmd,
+                                 const char *remote, int isbinary, int reget)
+{
+    int sock;
+
+    sock = ftpfs_open_data_connection (me, conn, cmd, remote, isbinary, reget);
+    if (sock == -1 && code == 421 && ftpfs_reconnect (me, conn) != 0)
+        sock = ftpfs_open_data_connection (me, conn, cmd, remote, isbinary, reget);
+
+    return sock;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Open the extra control connection to the server of super */
+
+static struct vfs_s_super *
+ftpfs_pool_new_connection (struct vfs_class *me, struct vfs_s_super *super)
+{
+    struct vfs_s_super *conn;
+    ftp_super_data_t *data;
+
+    conn = g_new0 (struct vfs_s_super, 1);
+    conn->me = me;
+    conn->name = g_strdup (super->name);
+    conn->path_element = vfs_path_element_clone (super->path_element);
+    /* will be set to the home directory at login */
+    g_free (conn->path_element->path);
+    conn->path_element->path = NULL;
+    conn->reader = vfs_s_reader_new (-1);
+
+    data = g_new0 (ftp_super_data_t, 1);
+    data->sock = -1;
+    data->proxy = SUP->proxy;
+    data->use_passive_connection = ftpfs_use_passive_connections;
+    data->strict = SUP->strict;
+    data->isbinary = TYPE_UNKNOWN;
+    conn->data = data;
+
+    vfs_print_message (_("ftpfs: Opening extra connection to %s"), super->path_element->host);
+
+    if (ftpfs_open_archive_int (me, conn) != 0 || data->sock == -1)
+    {
+        ftpfs_pool_free_connection (me, conn);
+        return NULL;
+    }
+
+    return conn;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the control connection for the new data transfer: the primary one if it is free,
+ * otherwise the idle or new extra one. Returns NULL if all ftpfs_max_connections are busy.
+ */
+
+static struct vfs_s_super *
+ftpfs_pool_acquire (struct vfs_class *me, struct vfs_s_super *super)
+{
+    GList *iter;
+    struct vfs_s_super *conn;
+
+    if (!SUP->ctl_connection_busy)
+        return super;
+
+    for (iter = SUP->pool; iter != NULL; iter = g_list_next (iter))
+    {
+        conn = (struct vfs_s_super *) iter->data;
+        if (!CONN_SUP (conn)->ctl_connection_busy)
+            return conn;
+    }
+
+    if ((int) g_list_length (SUP->pool) + 1 >= ftpfs_max_connections)
+        return NULL;
+
+    conn = ftpfs_pool_new_connection (me, super);
+    if (conn != NULL)
+        SUP->pool = g_list_append (SUP->pool, conn);
+
+    return conn;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+ftpfs_pool_free_connection (struct vfs_class *me, struct vfs_s_super *conn)
+{
+    ftpfs_free_archive (me, conn);
+    vfs_s_reader_free (conn->reader);
+    vfs_path_element_free (conn->path_element);
+    g_free (conn->name);
+    g_free (conn);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static void
 ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
 {
-    struct vfs_s_super *super = FH_SUPER;
+    struct vfs_s_super *super = FH_CONN;
     static unsigned char const ipbuf[3] = { IAC, IP, IAC };
     fd_set mask;
     char buf[BUF_8K];
     int dsock = FH_SOCK;
     FH_SOCK = -1;
     SUP->ctl_connection_busy = 0;
+    if (SUP->linear_fh == fh)
+        SUP->linear_fh = NULL;
 
     vfs_print_message (_("ftpfs: aborting transfer."));
     if (send (SUP->sock, ipbuf, sizeof (ipbuf), MSG_OOB) != sizeof (ipbuf))
@@ -1450,8 +1573,8 @@ ftpfs_linear_abort (struct vfs_class *me, vfs_file_handler_t * fh)
         }
         close (dsock);
     }
-    if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) == TRANSIENT) && (code == 426))
-        ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    if ((ftpfs_get_reply (me, super->reader, NULL, 0) == TRANSIENT) && (code == 426))
+        ftpfs_get_reply (me, super->reader, NULL, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1622,7 +1745,7 @@ resolve_symlink_with_ls_options (struct vfs_class *me, struct vfs_s_super *super
     while (fgets (buffer, sizeof (buffer), fp) != NULL);
     tty_disable_interrupt_key ();
     fclose (fp);
-    ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    ftpfs_get_reply (me, super->reader, NULL, 0);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1641,14 +1764,37 @@ resolve_symlink (struct vfs_class *me, struct vfs_s_super *super, struct vfs_s_i
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Check if the reply code means that the server doesn't support the command:
+ * 500 command unrecognized, 501 syntax error in arguments, 502 command not implemented,
+ * 504 command not implemented for that parameter.
+ */
+
+static gboolean
+ftpfs_is_unsupported_reply (int reply_code)
+{
+    return (reply_code == 500 || reply_code == 501 || reply_code == 502 || reply_code == 504);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static int
 ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path)
 {
     struct vfs_s_entry *ent;
     struct vfs_s_super *super = dir->super;
+    struct vfs_s_super *conn;
     int sock, num_entries = 0;
+    vfs_s_reader_t *reader;
     char lc_buffer[BUF_8K];
     int cd_first;
+    /* machine-readable listing (RFC 3659) doesn't require guessing of format */
+    gboolean mlsd = !SUP->mlsd_unsupported;
+
+    /* don't break the data transfer in progress on the primary connection */
+    conn = ftpfs_pool_acquire (me, super);
+    if (conn == NULL)
+        conn = super;
 
     cd_first = ftpfs_first_cd_then_ls || (SUP->strict == RFC_STRICT)
         || (strchr (remote_path, ' ') != NULL);
@@ -1659,9 +1805,9 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
                        SUP->strict ==
                        RFC_STRICT ? _("(strict rfc959)") : "", cd_first ? _("(chdir first)") : "");
 
-    if (cd_first)
+    if (cd_first && !mlsd)
     {
-        if (ftpfs_chdir_internal (me, super, remote_path) != COMPLETE)
+        if (ftpfs_chdir_internal (me, conn, remote_path) != COMPLETE)
         {
             ftpfs_errno = ENOENT;
             vfs_print_message (_("ftpfs: CWD failed."));
@@ -1672,23 +1818,37 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
     gettimeofday (&dir->timestamp, NULL);
     dir->timestamp.tv_sec += ftpfs_directory_timeout;
 
-    if (SUP->strict == RFC_STRICT)
-        sock = ftpfs_open_data_connection (me, super, "LIST", 0, TYPE_ASCII, 0);
+    if (mlsd)
+    {
+        sock = ftpfs_open_data_connection (me, conn, "MLSD", remote_path, TYPE_ASCII, 0);
+        if (sock == -1)
+        {
+            /* other failures (like 550 for this path) don't disable MLSD for next listings */
+            if (ftpfs_is_unsupported_reply (code))
+                SUP->mlsd_unsupported = 1;
+            mlsd = FALSE;
+            goto again;
+        }
+    }
+    else if (SUP->strict == RFC_STRICT)
+        sock = ftpfs_open_data_connection (me, conn, "LIST", 0, TYPE_ASCII, 0);
     else if (cd_first)
         /* Dirty hack to avoid autoprepending / to . */
         /* Wu-ftpd produces strange output for '/' if 'LIST -la .' used */
-        sock = ftpfs_open_data_connection (me, super, "LIST -la", 0, TYPE_ASCII, 0);
+        sock = ftpfs_open_data_connection (me, conn, "LIST -la", 0, TYPE_ASCII, 0);
     else
     {
         /* Trailing "/." is necessary if remote_path is a symlink */
         char *path = concat_dir_and_file (remote_path, ".");
-        sock = ftpfs_open_data_connection (me, super, "LIST -la", path, TYPE_ASCII, 0);
+        sock = ftpfs_open_data_connection (me, conn, "LIST -la", path, TYPE_ASCII, 0);
         g_free (path);
     }
 
     if (sock == -1)
         goto fallback;
 
+    reader = vfs_s_reader_new (sock);
+
     /* Clear the interrupt flag */
     tty_enable_interrupt_key ();
 
@@ -1697,17 +1857,17 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
     {
         int i;
         size_t count_spaces = 0;
-        int res = vfs_s_get_line_interruptible (me, lc_buffer, sizeof (lc_buffer),
-                                                sock);
+        int res = vfs_s_get_line_interruptible (me, lc_buffer, sizeof (lc_buffer), reader);
         if (!res)
             break;
 
         if (res == EINTR)
         {
             me->verrno = ECONNRESET;
+            vfs_s_reader_free (reader);
             close (sock);
             tty_disable_interrupt_key ();
-            ftpfs_get_reply (me, SUP->sock, NULL, 0);
+            ftpfs_get_reply (me, conn->reader, NULL, 0);
             vfs_print_message (_("%s: failure"), me->name);
             return -1;
         }
@@ -1721,22 +1881,42 @@ ftpfs_dir_load (struct vfs_class *me, struct vfs_s_inode *dir, char *remote_path
 
         ent = vfs_s_generate_entry (me, NULL, dir, 0);
         i = ent->ino->st.st_nlink;
-        if (!vfs_parse_ls_lga
-            (lc_buffer, &ent->ino->st, &ent->name, &ent->ino->linkname, &count_spaces))
+        if (mlsd ? !vfs_parse_mlsx (lc_buffer, &ent->ino->st, &ent->name, &ent->ino->linkname)
+            : !vfs_parse_ls_lga (lc_buffer, &ent->ino->st, &ent->name, &ent->ino->linkname,
+                                 &count_spaces))
         {
             vfs_s_free_entry (me, ent);
             continue;
         }
         ent->ino->st.st_nlink = i;      /* Ouch, we need to preserve our counts :-( */
         num_entries++;
-        vfs_s_store_filename_leading_spaces (ent, count_spaces);
+        if (!mlsd)
+            vfs_s_store_filename_leading_spaces (ent, count_spaces);
         vfs_s_insert_entry (me, dir, ent);
     }
 
+    vfs_s_reader_free (reader);
     close (sock);
     me->verrno = E_REMOTE;
-    if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE))
-        goto fallback;
+    if ((ftpfs_get_reply (me, conn->reader, NULL, 0) != COMPLETE))
+    {
+        if (!mlsd)
+            goto fallback;
+        if (ftpfs_is_unsupported_reply (code))
+            SUP->mlsd_unsupported = 1;
+        /* drop the partial MLSD listing before reading it again with LIST */
+        while (dir->subdir != NULL)
+            vfs_s_free_entry (me, (struct vfs_s_entry *) dir->subdir->data);
+        num_entries = 0;
+        mlsd = FALSE;
+        goto again;
+    }
+
+    if (mlsd)
+    {
+        vfs_print_message (_("%s: done."), me->name);
+        return 0;
+    }
 
     if (num_entries == 0 && cd_first == 0)
     {
@@ -1792,15 +1972,20 @@ ftpfs_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, cha
     char lc_buffer[BUF_8K];
     struct stat s;
     char *w_buf;
-    struct vfs_s_super *super = FH_SUPER;
+    struct vfs_s_super *super;
     ftp_fh_data_t *ftp = (ftp_fh_data_t *) fh->data;
 
+    super = ftpfs_pool_acquire (me, FH_SUPER);
+    if (super == NULL)
+        super = FH_SUPER;
+
     h = open (localname, O_RDONLY);
     if (h == -1)
         ERRNOR (EIO, -1);
 
     sock =
-        ftpfs_open_data_connection (me, super, ftp->append ? "APPE" : "STOR", name, TYPE_BINARY, 0);
+        ftpfs_pool_open_data_connection (me, super, ftp->append ? "APPE" : "STOR", name,
+                                         TYPE_BINARY, 0);
     if (sock < 0 || fstat (h, &s) == -1)
     {
         close (h);
@@ -1857,14 +2042,14 @@ ftpfs_file_store (struct vfs_class *me, vfs_file_handler_t * fh, char *name, cha
     tty_disable_interrupt_key ();
     close (sock);
     close (h);
-    if (ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE)
+    if (ftpfs_get_reply (me, super->reader, NULL, 0) != COMPLETE)
         ERRNOR (EIO, -1);
     return 0;
   error_return:
     tty_disable_interrupt_key ();
     close (sock);
     close (h);
-    ftpfs_get_reply (me, SUP->sock, NULL, 0);
+    ftpfs_get_reply (me, super->reader, NULL, 0);
     return -1;
 }
 
@@ -1881,12 +2066,22 @@ ftpfs_linear_start (struct vfs_class *me, vfs_file_handler_t * fh, off_t offset)
     name = vfs_s_fullpath (me, fh->ino);
     if (name == NULL)
         return 0;
-    FH_SOCK = ftpfs_open_data_connection (me, FH_SUPER, "RETR", name, TYPE_BINARY, offset);
+    /* the primary connection can be busy by the other transfer, i.e. at ftp-to-ftp copying */
+    FH_CONN = ftpfs_pool_acquire (me, FH_SUPER);
+    if (FH_CONN == NULL)
+    {
+        /* all connections are busy: abort the transfer on the primary one and reuse it */
+        FH_CONN = FH_SUPER;
+        if (CONN_SUP (FH_CONN)->linear_fh != NULL)
+            ftpfs_linear_abort (me, CONN_SUP (FH_CONN)->linear_fh);
+    }
+    FH_SOCK = ftpfs_pool_open_data_connection (me, FH_CONN, "RETR", name, TYPE_BINARY, offset);
     g_free (name);
     if (FH_SOCK == -1)
         ERRNOR (EACCES, 0);
     fh->linear = LS_LINEAR_OPEN;
-    ((ftp_super_data_t *) (FH_SUPER->data))->ctl_connection_busy = 1;
+    CONN_SUP (FH_CONN)->ctl_connection_busy = 1;
+    CONN_SUP (FH_CONN)->linear_fh = fh;
     ((ftp_fh_data_t *) fh->data)->append = 0;
     return 1;
 }
@@ -1897,7 +2092,11 @@ static int
 ftpfs_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, size_t len)
 {
     ssize_t n;
-    struct vfs_s_super *super = FH_SUPER;
+    struct vfs_s_super *super = FH_CONN;
+
+    /* the transfer was aborted to free the connection for another one */
+    if (FH_SOCK == -1)
+        ERRNOR (EIO, -1);
 
     while ((n = read (FH_SOCK, buf, len)) < 0)
     {
@@ -1912,9 +2111,10 @@ ftpfs_linear_read (struct vfs_class *me, vfs_file_handler_t * fh, void *buf, siz
     if (n == 0)
     {
         SUP->ctl_connection_busy = 0;
+        SUP->linear_fh = NULL;
         close (FH_SOCK);
         FH_SOCK = -1;
-        if ((ftpfs_get_reply (me, SUP->sock, NULL, 0) != COMPLETE))
+        if ((ftpfs_get_reply (me, super->reader, NULL, 0) != COMPLETE))
             ERRNOR (E_REMOTE, -1);
         return 0;
     }
@@ -2135,11 +2335,12 @@ ftpfs_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t
 #endif
         char *name;
 
-        /* ftpfs_linear_start() called, so data will be written
+        /* all connections are busy by other transfers, so data will be written
          * to local temporary file and stored to ftp server
          * by vfs_s_close later
          */
-        if (((ftp_super_data_t *) (FH_SUPER->data))->ctl_connection_busy)
+        ftp->conn = ftpfs_pool_acquire (me, FH_SUPER);
+        if (ftp->conn == NULL)
         {
             if (!fh->ino->localname)
             {
@@ -2156,12 +2357,13 @@ ftpfs_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t
         if (name == NULL)
             goto fail;
         fh->handle =
-            ftpfs_open_data_connection (me, fh->ino->super,
-                                        (flags & O_APPEND) ? "APPE" : "STOR", name, TYPE_BINARY, 0);
+            ftpfs_pool_open_data_connection (me, ftp->conn, (flags & O_APPEND) ? "APPE" : "STOR",
+                                             name, TYPE_BINARY, 0);
         g_free (name);
 
         if (fh->handle < 0)
             goto fail;
+        CONN_SUP (ftp->conn)->ctl_connection_busy = 1;
 #ifdef HAVE_STRUCT_LINGER_L_LINGER
         li.l_onoff = 1;
         li.l_linger = 120;
@@ -2195,7 +2397,7 @@ ftpfs_fh_close (struct vfs_class *me, vfs_file_handler_t * fh)
 {
     if (fh->handle != -1 && !fh->ino->localname)
     {
-        ftp_super_data_t *ftp = (ftp_super_data_t *) fh->ino->super->data;
+        int reply;
 
         close (fh->handle);
         fh->handle = -1;
@@ -2203,7 +2405,10 @@ ftpfs_fh_close (struct vfs_class *me, vfs_file_handler_t * fh)
          * we prevent MEDATA->ftpfs_file_store() call from vfs_s_close ()
          */
         fh->changed = 0;
-        if (ftpfs_get_reply (me, ftp->sock, NULL, 0) != COMPLETE)
+        reply = ftpfs_get_reply (me, FH_CONN->reader, NULL, 0);
+        /* connection is free for the next transfer */
+        CONN_SUP (FH_CONN)->ctl_connection_busy = 0;
+        if (reply != COMPLETE)
             ERRNOR (EIO, -1);
         vfs_s_invalidate (me, FH_SUPER);
     }
@@ -70,6 +70,10 @@
 #include "undelfs/undelfs.h"
 #endif
 
+#ifdef ENABLE_VFS_ZIP
+#include "zip/zip.h"
+#endif
+
 #include "plugins_init.h"
 
 /*** global variables ****************************************************************************/
@@ -99,6 +103,10 @@ vfs_plugins_init (void)
 #ifdef ENABLE_VFS_TAR
     init_tarfs ();
 #endif /* ENABLE_VFS_TAR */
+#ifdef ENABLE_VFS_ZIP
+    /* must be registered before extfs to take over its "uzip" prefix */
+    init_zipfs ();
+#endif /* ENABLE_VFS_ZIP */
 #ifdef ENABLE_VFS_SFS
     init_sfs ();
 #endif /* ENABLE_VFS_SFS */
@@ -32,6 +32,11 @@
  * If you want to gunzip something, you should open it with \verbatim #ugz \endverbatim
  * suffix, DON'T try to gunzip it yourself.
  *
+ * gzip, bzip2 and xz files opened for reading are decompressed in-process
+ * while they are read (see stream.c), if mc is built with the libraries.
+ * Other operations and other filesystems run the command from sfs.ini which
+ * writes the whole file into the local cache.
+ *
  * Namespace: exports vfs_sfs_ops
  */
 
@@ -55,6 +60,7 @@
 #include "lib/vfs/gc.h"         /* vfs_stamp_create */
 
 #include "sfs.h"
+#include "stream.h"
 
 /*** global variables ****************************************************************************/
 
@@ -96,6 +102,13 @@ typedef struct cachedfile
     char *cache;
 } cachedfile;
 
+/* opened file */
+typedef struct
+{
+    int fd;                     /* local cache file, -1 if the file is decompressed in-process */
+    sfs_stream_t *stream;
+} sfs_fh_t;
+
 /*** file scope variables ************************************************************************/
 
 static GSList *head;
@@ -255,21 +268,122 @@ sfs_redirect (const vfs_path_t * vpath)
 
 /* --------------------------------------------------------------------------------------------- */
 
+/** Opens the stream decompressed in-process, if there is a built-in decoder for the filesystem */
+
+static sfs_stream_t *
+sfs_open_stream (const vfs_path_t * vpath)
+{
+    sfs_stream_t *stream;
+    vfs_path_element_t *path_element;
+    sfs_stream_type_t type;
+    char *pname;
+    int w;
+
+    path_element = vfs_path_get_by_index (vpath, -1);
+    w = (*path_element->class->which) (path_element->class, path_element->vfs_prefix);
+    if (w == -1 || (sfs_flags[w] & F_1) == 0)
+        return NULL;
+
+    type = sfs_stream_type (sfs_prefix[w]);
+    if (type == SFS_STREAM_NONE)
+        return NULL;
+
+    /* the parent file is read through VFS, no local copy is needed */
+    pname = vfs_path_to_str_elements_count (vpath, -1);
+    stream = sfs_stream_open (pname, type);
+    g_free (pname);
+
+    return stream;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void *
 sfs_open (const vfs_path_t * vpath /*struct vfs_class *me, const char *path */ , int flags,
           mode_t mode)
 {
-    int *sfs_info;
-    int fd;
+    sfs_fh_t *fh;
+    sfs_stream_t *stream = NULL;
+    int fd = -1;
 
-    fd = open (sfs_redirect (vpath), NO_LINEAR (flags), mode);
-    if (fd == -1)
-        return 0;
+    /* files which are not in the cache yet are decompressed while they are read */
+    if ((flags & O_ACCMODE) == O_RDONLY)
+    {
+        char *path = vfs_path_to_str (vpath);
+
+        if (g_slist_find_custom (head, path, cachedfile_compare) == NULL)
+            stream = sfs_open_stream (vpath);
+        g_free (path);
+    }
+
+    if (stream == NULL)
+    {
+        fd = open (sfs_redirect (vpath), NO_LINEAR (flags), mode);
+        if (fd == -1)
+            return 0;
+    }
+
+    fh = g_new (sfs_fh_t, 1);
+    fh->fd = fd;
+    fh->stream = stream;
+
+    return fh;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sfs_close (void *data)
+{
+    sfs_fh_t *fh = (sfs_fh_t *) data;
+    int result = 0;
+
+    if (fh->stream != NULL)
+        sfs_stream_close (fh->stream);
+    else
+        result = close (fh->fd);
+
+    g_free (fh);
+    return result;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ssize_t
+sfs_read (void *data, char *buffer, size_t count)
+{
+    sfs_fh_t *fh = (sfs_fh_t *) data;
+
+    if (fh->stream != NULL)
+        return sfs_stream_read (fh->stream, buffer, count);
+
+    return local_read (&fh->fd, buffer, count);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static off_t
+sfs_lseek (void *data, off_t offset, int whence)
+{
+    sfs_fh_t *fh = (sfs_fh_t *) data;
+
+    if (fh->stream != NULL)
+        return sfs_stream_lseek (fh->stream, offset, whence);
+
+    return local_lseek (&fh->fd, offset, whence);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sfs_fstat (void *data, struct stat *buf)
+{
+    sfs_fh_t *fh = (sfs_fh_t *) data;
 
-    sfs_info = g_new (int, 1);
-    *sfs_info = fd;
+    if (fh->stream != NULL)
+        return sfs_stream_fstat (fh->stream, buf);
 
-    return sfs_info;
+    return local_fstat (&fh->fd, buf);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -541,17 +655,17 @@ init_sfs (void)
     vfs_sfs_ops.fill_names = sfs_fill_names;
     vfs_sfs_ops.which = sfs_which;
     vfs_sfs_ops.open = sfs_open;
-    vfs_sfs_ops.close = local_close;
-    vfs_sfs_ops.read = local_read;
+    vfs_sfs_ops.close = sfs_close;
+    vfs_sfs_ops.read = sfs_read;
     vfs_sfs_ops.stat = sfs_stat;
     vfs_sfs_ops.lstat = sfs_lstat;
-    vfs_sfs_ops.fstat = local_fstat;
+    vfs_sfs_ops.fstat = sfs_fstat;
     vfs_sfs_ops.chmod = sfs_chmod;
     vfs_sfs_ops.chown = sfs_chown;
     vfs_sfs_ops.utime = sfs_utime;
     vfs_sfs_ops.readlink = sfs_readlink;
     vfs_sfs_ops.ferrno = local_errno;
-    vfs_sfs_ops.lseek = local_lseek;
+    vfs_sfs_ops.lseek = sfs_lseek;
     vfs_sfs_ops.getid = sfs_getid;
     vfs_sfs_ops.nothingisopen = sfs_nothingisopen;
     vfs_sfs_ops.free = sfs_free;
@@ -0,0 +1,923 @@
+/*
+   Single File fileSystem: in-process decompression
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: in-process decompression for sfs
+ *
+ *  gzip, bzip2 and xz files are decoded while they are read, instead of writing
+ *  the whole decompressed file to the temporary directory first.
+ *  Seeks are lazy: forward seeks decode and throw away the data, backward seeks
+ *  restart the decoder. While a gzip file is decoded, access points are remembered
+ *  every SFS_GZ_SPAN bytes (the way zran.c from zlib examples does), so a backward
+ *  seek restarts from the nearest access point instead of the beginning of file.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BZLIB
+#include <bzlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "stream.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* size of buffer for compressed data */
+#define SFS_INBUF_SIZE (64 * 1024)
+
+/* size of buffer for data skipped by forward seeks */
+#define SFS_SKIPBUF_SIZE (16 * 1024)
+
+/* size of deflate window */
+#define SFS_GZ_WINSIZE 32768
+
+/* distance between gzip access points in decompressed data */
+#define SFS_GZ_SPAN ((off_t) 16 * 1024 * 1024)
+
+/* gzip header flags */
+#define GZ_FHCRC    0x02
+#define GZ_FEXTRA   0x04
+#define GZ_FNAME    0x08
+#define GZ_FCOMMENT 0x10
+#define GZ_RESERVED 0xe0
+
+/*** file scope type declarations ****************************************************************/
+
+#ifdef HAVE_ZLIB
+/* point of gzip file where decoding can be started */
+typedef struct
+{
+    off_t out;                  /* offset in decompressed data */
+    off_t in;                   /* offset of the next byte of compressed data */
+    int bits;                   /* number of unused bits in the byte before in, 0..7 */
+    unsigned char *window;      /* decompressed data before out */
+    size_t wsize;
+} sfs_gz_point_t;
+#endif
+
+struct sfs_stream
+{
+    sfs_stream_type_t type;
+    int fd;                     /* compressed file */
+    unsigned char *inbuf;
+    const unsigned char *next_in;
+    size_t avail_in;
+    gboolean in_eof;            /* whole compressed file is read */
+    off_t in_pos;               /* offset in compressed file of the end of data in inbuf */
+    off_t out_pos;              /* offset in decompressed data of the decoder */
+    off_t pos;                  /* offset set by lseek */
+    off_t size;                 /* size of decompressed data, -1 while it is not known */
+    gboolean eof;               /* decoder reached end of data */
+    union
+    {
+#ifdef HAVE_ZLIB
+        z_stream z;
+#endif
+#ifdef HAVE_BZLIB
+        bz_stream bz;
+#endif
+#ifdef HAVE_LZMA
+        lzma_stream lz;
+#endif
+        int none;
+    } u;
+#ifdef HAVE_ZLIB
+    unsigned char *window;      /* last decompressed data, circular */
+    size_t win_next;            /* offset of next byte in window */
+    size_t win_have;            /* number of valid bytes in window */
+    GArray *points;             /* sfs_gz_point_t, ordered by offset */
+#endif
+};
+
+/*** file scope variables ************************************************************************/
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Reads next chunk of compressed data. Returns number of read bytes, 0 on EOF, -1 on error */
+
+static ssize_t
+sfs_stream_fill (sfs_stream_t * st)
+{
+    ssize_t n;
+
+    n = mc_read (st->fd, (char *) st->inbuf, SFS_INBUF_SIZE);
+    if (n < 0)
+        return -1;
+
+    st->next_in = st->inbuf;
+    st->avail_in = (size_t) n;
+    st->in_pos += n;
+    st->in_eof = (n == 0);
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sfs_stream_getc (sfs_stream_t * st)
+{
+    if (st->avail_in == 0 && sfs_stream_fill (st) <= 0)
+        return -1;
+
+    st->avail_in--;
+    return *st->next_in++;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_stream_seek_in (sfs_stream_t * st, off_t offset)
+{
+    if (mc_lseek (st->fd, offset, SEEK_SET) != offset)
+        return FALSE;
+
+    st->in_pos = offset;
+    st->next_in = st->inbuf;
+    st->avail_in = 0;
+    st->in_eof = FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_ZLIB
+/** Skips header of gzip member. Returns FALSE if there is no valid header */
+
+static gboolean
+sfs_gz_header (sfs_stream_t * st)
+{
+    int flags, c, i;
+
+    if (sfs_stream_getc (st) != 0x1f || sfs_stream_getc (st) != 0x8b
+        || sfs_stream_getc (st) != Z_DEFLATED)
+        return FALSE;
+
+    flags = sfs_stream_getc (st);
+    if (flags < 0 || (flags & GZ_RESERVED) != 0)
+        return FALSE;
+
+    /* mtime, extra flags, OS */
+    for (i = 0; i < 6; i++)
+        if (sfs_stream_getc (st) < 0)
+            return FALSE;
+
+    if ((flags & GZ_FEXTRA) != 0)
+    {
+        int len;
+
+        c = sfs_stream_getc (st);
+        i = sfs_stream_getc (st);
+        if (c < 0 || i < 0)
+            return FALSE;
+        for (len = c | (i << 8); len > 0; len--)
+            if (sfs_stream_getc (st) < 0)
+                return FALSE;
+    }
+
+    if ((flags & GZ_FNAME) != 0)
+    {
+        while ((c = sfs_stream_getc (st)) > 0)
+            ;
+        if (c < 0)
+            return FALSE;
+    }
+
+    if ((flags & GZ_FCOMMENT) != 0)
+    {
+        while ((c = sfs_stream_getc (st)) > 0)
+            ;
+        if (c < 0)
+            return FALSE;
+    }
+
+    if ((flags & GZ_FHCRC) != 0 && (sfs_stream_getc (st) < 0 || sfs_stream_getc (st) < 0))
+        return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Starts decoding of the gzip file from the beginning */
+
+static gboolean
+sfs_gz_rewind (sfs_stream_t * st)
+{
+    if (!sfs_stream_seek_in (st, 0) || !sfs_gz_header (st))
+        return FALSE;
+
+    inflateReset (&st->u.z);
+    st->win_next = st->win_have = 0;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Skips the trailer of gzip member and the header of the next one, if any */
+
+static gboolean
+sfs_gz_next_member (sfs_stream_t * st)
+{
+    int i;
+
+    /* CRC32 and ISIZE */
+    for (i = 0; i < 8; i++)
+        if (sfs_stream_getc (st) < 0)
+            return FALSE;
+
+    /* concatenated members are decoded as one stream, anything else ends the data */
+    if (!sfs_gz_header (st))
+        return FALSE;
+
+    inflateReset (&st->u.z);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sfs_gz_add_point (sfs_stream_t * st)
+{
+    sfs_gz_point_t p;
+
+    p.out = st->out_pos;
+    p.in = st->in_pos - (off_t) st->avail_in;
+    p.bits = st->u.z.data_type & 7;
+    p.wsize = st->win_have;
+    p.window = g_malloc (p.wsize);
+
+    if (st->win_have < SFS_GZ_WINSIZE)
+        memcpy (p.window, st->window, p.wsize);
+    else
+    {
+        /* unroll the circular window */
+        size_t tail = SFS_GZ_WINSIZE - st->win_next;
+
+        memcpy (p.window, st->window + st->win_next, tail);
+        memcpy (p.window + tail, st->window, st->win_next);
+    }
+
+    g_array_append_val (st->points, p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Returns the last access point before offset, NULL if there is none */
+
+static const sfs_gz_point_t *
+sfs_gz_find_point (sfs_stream_t * st, off_t offset)
+{
+    guint low = 0, high = st->points->len;
+
+    while (low < high)
+    {
+        guint mid = low + (high - low) / 2;
+
+        if (g_array_index (st->points, sfs_gz_point_t, mid).out <= offset)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low == 0 ? NULL : &g_array_index (st->points, sfs_gz_point_t, low - 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_gz_restore (sfs_stream_t * st, const sfs_gz_point_t * p)
+{
+    z_stream *zs = &st->u.z;
+
+    if (!sfs_stream_seek_in (st, p->in - (p->bits != 0 ? 1 : 0)))
+        return FALSE;
+
+    inflateReset (zs);
+
+    if (p->bits != 0)
+    {
+        int c;
+
+        c = sfs_stream_getc (st);
+        if (c < 0)
+            return FALSE;
+        inflatePrime (zs, p->bits, c >> (8 - p->bits));
+    }
+
+    if (p->wsize != 0)
+        inflateSetDictionary (zs, p->window, (uInt) p->wsize);
+
+    memcpy (st->window, p->window, p->wsize);
+    st->win_next = st->win_have = p->wsize;
+    st->out_pos = p->out;
+    st->eof = FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Decodes gzip data. The data is inflated into the window first, so it can be saved
+ * with access points, and copied to buf then.
+ */
+
+static ssize_t
+sfs_gz_decode (sfs_stream_t * st, char *buf, size_t len)
+{
+    z_stream *zs = &st->u.z;
+    size_t done = 0;
+
+    while (done < len && !st->eof)
+    {
+        unsigned char *out;
+        size_t have, avail_in;
+        int ret;
+
+        if (st->avail_in == 0)
+        {
+            ssize_t n;
+
+            n = sfs_stream_fill (st);
+            if (n < 0)
+                return -1;
+            if (n == 0)
+            {
+                /* truncated file */
+                st->eof = TRUE;
+                break;
+            }
+        }
+
+        if (st->win_next == SFS_GZ_WINSIZE)
+            st->win_next = 0;
+        out = st->window + st->win_next;
+
+        avail_in = st->avail_in;
+        zs->next_in = (Bytef *) st->next_in;
+        zs->avail_in = (uInt) avail_in;
+        zs->next_out = out;
+        zs->avail_out = (uInt) MIN (SFS_GZ_WINSIZE - st->win_next, len - done);
+
+        ret = inflate (zs, Z_BLOCK);
+
+        st->next_in = zs->next_in;
+        st->avail_in = zs->avail_in;
+
+        have = (size_t) (zs->next_out - out);
+        memcpy (buf + done, out, have);
+        done += have;
+        st->out_pos += (off_t) have;
+        st->win_next += have;
+        st->win_have = MIN (st->win_have + have, SFS_GZ_WINSIZE);
+
+        if (ret == Z_STREAM_END)
+        {
+            if (!sfs_gz_next_member (st))
+                st->eof = TRUE;
+        }
+        else if ((ret != Z_OK && ret != Z_BUF_ERROR)
+                 || (have == 0 && st->avail_in == avail_in))
+        {
+            errno = EIO;
+            return -1;
+        }
+        else if ((zs->data_type & 128) != 0 && (zs->data_type & 64) == 0)
+        {
+            /* end of block which is not the last one */
+            off_t last = 0;
+
+            if (st->points->len != 0)
+                last = g_array_index (st->points, sfs_gz_point_t, st->points->len - 1).out;
+            if (st->out_pos - last >= SFS_GZ_SPAN)
+                sfs_gz_add_point (st);
+        }
+    }
+
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_gz_open (sfs_stream_t * st)
+{
+    /* raw deflate data, gzip headers are parsed by sfs_gz_header() */
+    if (inflateInit2 (&st->u.z, -MAX_WBITS) != Z_OK)
+        return FALSE;
+
+    st->window = g_malloc (SFS_GZ_WINSIZE);
+    st->points = g_array_new (FALSE, FALSE, sizeof (sfs_gz_point_t));
+
+    return sfs_gz_header (st);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sfs_gz_close (sfs_stream_t * st)
+{
+    if (st->points != NULL)
+    {
+        guint i;
+
+        inflateEnd (&st->u.z);
+
+        for (i = 0; i < st->points->len; i++)
+            g_free (g_array_index (st->points, sfs_gz_point_t, i).window);
+        g_array_free (st->points, TRUE);
+    }
+
+    g_free (st->window);
+}
+#endif /* HAVE_ZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_BZLIB
+static ssize_t
+sfs_bz_decode (sfs_stream_t * st, char *buf, size_t len)
+{
+    bz_stream *bz = &st->u.bz;
+    size_t done = 0;
+
+    while (done < len && !st->eof)
+    {
+        int ret;
+
+        if (st->avail_in == 0)
+        {
+            ssize_t n;
+
+            n = sfs_stream_fill (st);
+            if (n < 0)
+                return -1;
+            if (n == 0)
+            {
+                /* truncated file */
+                st->eof = TRUE;
+                break;
+            }
+        }
+
+        bz->next_in = (char *) st->next_in;
+        bz->avail_in = (unsigned int) st->avail_in;
+        bz->next_out = buf + done;
+        bz->avail_out = (unsigned int) MIN (len - done, G_MAXINT);
+
+        ret = BZ2_bzDecompress (bz);
+
+        st->next_in = (const unsigned char *) bz->next_in;
+        st->avail_in = bz->avail_in;
+        done = (size_t) (bz->next_out - buf);
+
+        if (ret == BZ_STREAM_END)
+        {
+            /* concatenated streams are decoded as one, anything else ends the data */
+            if ((st->avail_in == 0 && sfs_stream_fill (st) <= 0) || st->next_in[0] != 'B')
+                st->eof = TRUE;
+            else
+            {
+                BZ2_bzDecompressEnd (bz);
+                if (BZ2_bzDecompressInit (bz, 0, 0) != BZ_OK)
+                {
+                    errno = ENOMEM;
+                    return -1;
+                }
+            }
+        }
+        else if (ret != BZ_OK)
+        {
+            errno = EIO;
+            return -1;
+        }
+    }
+
+    st->out_pos += (off_t) done;
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_bz_rewind (sfs_stream_t * st)
+{
+    BZ2_bzDecompressEnd (&st->u.bz);
+    memset (&st->u.bz, 0, sizeof (st->u.bz));
+
+    return BZ2_bzDecompressInit (&st->u.bz, 0, 0) == BZ_OK && sfs_stream_seek_in (st, 0);
+}
+#endif /* HAVE_BZLIB */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef HAVE_LZMA
+static ssize_t
+sfs_xz_decode (sfs_stream_t * st, char *buf, size_t len)
+{
+    lzma_stream *lz = &st->u.lz;
+    size_t done = 0;
+
+    while (done < len && !st->eof)
+    {
+        lzma_ret ret;
+
+        if (st->avail_in == 0 && !st->in_eof && sfs_stream_fill (st) < 0)
+            return -1;
+
+        lz->next_in = st->next_in;
+        lz->avail_in = st->avail_in;
+        lz->next_out = (uint8_t *) buf + done;
+        lz->avail_out = len - done;
+
+        /* concatenated streams are decoded until the end of file */
+        ret = lzma_code (lz, st->in_eof ? LZMA_FINISH : LZMA_RUN);
+
+        st->next_in = lz->next_in;
+        st->avail_in = lz->avail_in;
+        done = (size_t) (lz->next_out - (uint8_t *) buf);
+
+        if (ret == LZMA_STREAM_END)
+            st->eof = TRUE;
+        else if (ret == LZMA_BUF_ERROR && st->in_eof)
+            st->eof = TRUE;     /* truncated file */
+        else if (ret != LZMA_OK)
+        {
+            errno = (ret == LZMA_MEM_ERROR) ? ENOMEM : EIO;
+            return -1;
+        }
+    }
+
+    st->out_pos += (off_t) done;
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_xz_init (sfs_stream_t * st)
+{
+    memset (&st->u.lz, 0, sizeof (st->u.lz));   /* the same as LZMA_STREAM_INIT */
+
+    return lzma_stream_decoder (&st->u.lz, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+}
+#endif /* HAVE_LZMA */
+
+/* --------------------------------------------------------------------------------------------- */
+/** Checks the signature of compressed file, leaves the input at the beginning of file */
+
+static gboolean
+sfs_stream_check_magic (sfs_stream_t * st, const char *magic, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++)
+        if (sfs_stream_getc (st) != (unsigned char) magic[i])
+            return FALSE;
+
+    return sfs_stream_seek_in (st, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ssize_t
+sfs_stream_decode (sfs_stream_t * st, char *buf, size_t len)
+{
+    ssize_t n;
+
+    switch (st->type)
+    {
+#ifdef HAVE_ZLIB
+    case SFS_STREAM_GZIP:
+        n = sfs_gz_decode (st, buf, len);
+        break;
+#endif
+#ifdef HAVE_BZLIB
+    case SFS_STREAM_BZIP2:
+        n = sfs_bz_decode (st, buf, len);
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case SFS_STREAM_XZ:
+        n = sfs_xz_decode (st, buf, len);
+        break;
+#endif
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (st->eof)
+        st->size = st->out_pos;
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sfs_stream_rewind (sfs_stream_t * st)
+{
+    gboolean ok = FALSE;
+
+    switch (st->type)
+    {
+#ifdef HAVE_ZLIB
+    case SFS_STREAM_GZIP:
+        ok = sfs_gz_rewind (st);
+        break;
+#endif
+#ifdef HAVE_BZLIB
+    case SFS_STREAM_BZIP2:
+        ok = sfs_bz_rewind (st);
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case SFS_STREAM_XZ:
+        lzma_end (&st->u.lz);
+        ok = sfs_xz_init (st) && sfs_stream_seek_in (st, 0);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    st->out_pos = 0;
+    st->eof = FALSE;
+
+    if (!ok)
+        errno = EIO;
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Moves the decoder to the offset set by lseek */
+
+static gboolean
+sfs_stream_reposition (sfs_stream_t * st)
+{
+    char skip[SFS_SKIPBUF_SIZE];
+
+#ifdef HAVE_ZLIB
+    if (st->type == SFS_STREAM_GZIP)
+    {
+        const sfs_gz_point_t *p;
+
+        p = sfs_gz_find_point (st, st->pos);
+        if (p != NULL && (st->pos < st->out_pos || p->out > st->out_pos)
+            && !sfs_gz_restore (st, p))
+        {
+            errno = EIO;
+            return FALSE;
+        }
+    }
+#endif
+
+    if (st->pos < st->out_pos && !sfs_stream_rewind (st))
+        return FALSE;
+
+    while (st->out_pos < st->pos && !st->eof)
+        if (sfs_stream_decode (st, skip, (size_t) MIN ((off_t) sizeof (skip),
+                                                       st->pos - st->out_pos)) < 0)
+            return FALSE;
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/** Returns the built-in decoder for sfs prefix */
+
+sfs_stream_type_t
+sfs_stream_type (const char *prefix)
+{
+#ifdef HAVE_ZLIB
+    if (strcmp (prefix, "ugz") == 0)
+        return SFS_STREAM_GZIP;
+#endif
+#ifdef HAVE_BZLIB
+    if (strcmp (prefix, "ubz2") == 0)
+        return SFS_STREAM_BZIP2;
+#endif
+#ifdef HAVE_LZMA
+    if (strcmp (prefix, "uxz") == 0)
+        return SFS_STREAM_XZ;
+#endif
+    (void) prefix;
+
+    return SFS_STREAM_NONE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Opens compressed file for decoding.
+ *
+ * @param name name of compressed file
+ * @param type decoder
+ * @return stream or NULL if the file cannot be opened or is not in the format of decoder
+ *         (e. g. a compress'ed file for "ugz"), the external command is used then
+ */
+
+sfs_stream_t *
+sfs_stream_open (const char *name, sfs_stream_type_t type)
+{
+    sfs_stream_t *st;
+    gboolean ok = FALSE;
+    int fd;
+
+    if (type == SFS_STREAM_NONE)
+        return NULL;
+
+    fd = mc_open (name, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+
+    st = g_new0 (sfs_stream_t, 1);
+    st->type = type;
+    st->fd = fd;
+    st->inbuf = g_malloc (SFS_INBUF_SIZE);
+    st->next_in = st->inbuf;
+    st->size = -1;
+
+    switch (type)
+    {
+#ifdef HAVE_ZLIB
+    case SFS_STREAM_GZIP:
+        ok = sfs_gz_open (st);
+        break;
+#endif
+#ifdef HAVE_BZLIB
+    case SFS_STREAM_BZIP2:
+        ok = sfs_stream_check_magic (st, "BZh", 3) && BZ2_bzDecompressInit (&st->u.bz, 0, 0) == BZ_OK;
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case SFS_STREAM_XZ:
+        ok = sfs_stream_check_magic (st, "\xfd" "7zXZ", 6) && sfs_xz_init (st);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    if (!ok)
+    {
+        /* bzip2 and xz decoders are initialized last and are not set up here,
+           gzip one is freed by sfs_gz_close() as far as it is set up */
+        if (type != SFS_STREAM_GZIP)
+            st->type = SFS_STREAM_NONE;
+        sfs_stream_close (st);
+        return NULL;
+    }
+
+    return st;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+ssize_t
+sfs_stream_read (sfs_stream_t * st, char *buf, size_t count)
+{
+    ssize_t n;
+
+    if (st->pos != st->out_pos && !sfs_stream_reposition (st))
+        return -1;
+
+    /* beyond the end of data */
+    if (st->out_pos != st->pos)
+        return 0;
+
+    n = sfs_stream_decode (st, buf, count);
+    if (n > 0)
+        st->pos += n;
+
+    return n;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+off_t
+sfs_stream_lseek (sfs_stream_t * st, off_t offset, int whence)
+{
+    switch (whence)
+    {
+    case SEEK_SET:
+        break;
+    case SEEK_CUR:
+        offset += st->pos;
+        break;
+    case SEEK_END:
+        /* the size is known only when all data is decoded */
+        while (st->size < 0)
+        {
+            char skip[SFS_SKIPBUF_SIZE];
+
+            if (sfs_stream_decode (st, skip, sizeof (skip)) < 0)
+                return -1;
+        }
+        offset += st->size;
+        break;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* data is decoded on the next read */
+    st->pos = offset;
+    return offset;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+sfs_stream_fstat (sfs_stream_t * st, struct stat *buf)
+{
+    if (mc_fstat (st->fd, buf) != 0)
+        return -1;
+
+    /* size of decompressed data is not known until it is decoded, so report
+       the file like a pipe is reported: it is read until the end */
+    buf->st_size = st->size >= 0 ? st->size : 0;
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+sfs_stream_close (sfs_stream_t * st)
+{
+    if (st == NULL)
+        return;
+
+    switch (st->type)
+    {
+#ifdef HAVE_ZLIB
+    case SFS_STREAM_GZIP:
+        sfs_gz_close (st);
+        break;
+#endif
+#ifdef HAVE_BZLIB
+    case SFS_STREAM_BZIP2:
+        BZ2_bzDecompressEnd (&st->u.bz);
+        break;
+#endif
+#ifdef HAVE_LZMA
+    case SFS_STREAM_XZ:
+        lzma_end (&st->u.lz);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    mc_close (st->fd);
+    g_free (st->inbuf);
+    g_free (st);
+}
+
+/* --------------------------------------------------------------------------------------------- */
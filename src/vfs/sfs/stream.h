@@ -0,0 +1,40 @@
+/** \file stream.h
+ *  \brief Header: in-process decompression for sfs
+ */
+
+#ifndef MC__VFS_SFS_STREAM_H
+#define MC__VFS_SFS_STREAM_H
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+typedef enum
+{
+    SFS_STREAM_NONE = 0,        /* no built-in decoder, the external command is used */
+    SFS_STREAM_GZIP,
+    SFS_STREAM_BZIP2,
+    SFS_STREAM_XZ
+} sfs_stream_type_t;
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct sfs_stream sfs_stream_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+sfs_stream_type_t sfs_stream_type (const char *prefix);
+sfs_stream_t *sfs_stream_open (const char *name, sfs_stream_type_t type);
+ssize_t sfs_stream_read (sfs_stream_t * st, char *buf, size_t count);
+off_t sfs_stream_lseek (sfs_stream_t * st, off_t offset, int whence);
+int sfs_stream_fstat (sfs_stream_t * st, struct stat *buf);
+void sfs_stream_close (sfs_stream_t * st);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__VFS_SFS_STREAM_H */
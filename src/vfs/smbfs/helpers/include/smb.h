@@ -1471,6 +1471,7 @@ extern int dcelogin_atmost_once;
 #define CAP_NT_FIND          0x0200
 #define CAP_DFS              0x1000
 #define CAP_LARGE_READX      0x4000
+#define CAP_LARGE_WRITEX     0x8000
 
 /* protocol types. It assumes that higher protocols include lower protocols
    as subsets */
@@ -777,7 +777,7 @@ BOOL cli_session_setup(struct cli_state *cli,
 		SIVAL(cli->outbuf,smb_vwv5,cli->sesskey);
 		SSVAL(cli->outbuf,smb_vwv7,passlen);
 		SSVAL(cli->outbuf,smb_vwv8,ntpasslen);
-		SSVAL(cli->outbuf,smb_vwv11,0);
+		SIVAL(cli->outbuf,smb_vwv11,CAP_LARGE_READX|CAP_LARGE_WRITEX);
 		p = smb_buf(cli->outbuf);
 		memcpy(p,pword,passlen); 
 		p += SVAL(cli->outbuf,smb_vwv7);
@@ -1316,6 +1316,20 @@ BOOL cli_unlock(struct cli_state *cli, int fnum, uint32 offset, uint32 len, int
 #endif /*0 */
 
 
+/****************************************************************************
+size of data in a single SMBreadX/SMBwriteX. If the server negotiated large
+reads or writes the request is limited by our buffer only, not by max_xmit
+****************************************************************************/
+static int cli_block_size(struct cli_state *cli, uint32 large_cap)
+{
+	int max_xmit = cli->max_xmit;
+
+	if (cli->capabilities & large_cap)
+		max_xmit = CLI_BUFFER_SIZE;
+
+	return (max_xmit - (smb_size+32)) & ~1023;
+}
+
 /****************************************************************************
 issue a single SMBread and don't wait for a reply
 ****************************************************************************/
@@ -1351,7 +1365,7 @@ size_t cli_read(struct cli_state *cli, int fnum, char *buf, off_t offset, size_t
 	int issued=0;
 	int received=0;
 	int mpx = MAX(cli->max_mux-1, 1);
-	int block = (cli->max_xmit - (smb_size+32)) & ~1023;
+	int block = cli_block_size(cli, CAP_LARGE_READX);
 	int mid;
 	int blocks = (size + (block-1)) / block;
 
@@ -1463,7 +1477,7 @@ ssize_t cli_write(struct cli_state *cli,
 	int issued = 0;
 	int received = 0;
 	int mpx = MAX(cli->max_mux-1, 1);
-	int block = (cli->max_xmit - (smb_size+32)) & ~1023;
+	int block = cli_block_size(cli, CAP_LARGE_WRITEX);
 	int blocks = (size + (block-1)) / block;
 
 	while (received < blocks) {
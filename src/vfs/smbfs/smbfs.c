@@ -85,6 +85,10 @@ extern FILE *dbf;
 
 #define HEADER_LEN      6
 
+/* size of readahead and write-behind buffer of opened file: large enough to keep
+   many read/write requests in flight (see cli_read() and cli_write()) */
+#define SMBFS_BUFFER_SIZE (1024 * 1024)
+
 #define CNV_LANG(s) dos_to_unix(s,False)
 #define GNAL_VNC(s) unix_to_dos(s,False)
 
@@ -100,6 +104,11 @@ typedef struct
     int fnum;
     off_t nread;
     uint16 attr;
+    char *buf;                  /* data read ahead or not written yet */
+    off_t buf_offset;           /* file offset of buf */
+    size_t buf_len;
+    gboolean buf_dirty;         /* buf contains data not written yet */
+    off_t next_read;            /* where the last read ended, to detect sequential reading */
 } smbfs_handle;
 
 typedef struct dir_entry
@@ -449,6 +458,34 @@ smbfs_fill_names (struct vfs_class *me, fill_names_f func)
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/** Write the data collected by smbfs_write() to the server */
+
+static gboolean
+smbfs_flush (smbfs_handle * info)
+{
+    ssize_t n;
+    gboolean ret;
+
+    if (!info->buf_dirty)
+        return TRUE;
+
+    DEBUG (3, ("smbfs_flush(fnum:%d, offset:%d, len:%zu)\n",
+               info->fnum, (int) info->buf_offset, info->buf_len));
+    n = cli_write (info->cli, info->fnum, 0, info->buf, info->buf_offset, info->buf_len);
+    ret = (n == (ssize_t) info->buf_len);
+    if (!ret)
+    {
+        my_errno = cli_error (info->cli, NULL, &err, NULL);
+        if (my_errno == 0)
+            my_errno = EIO;
+    }
+
+    info->buf_dirty = FALSE;
+    info->buf_len = 0;
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /* does same as do_get() in client.c */
 /* called from vfs.c:1080, count = buffer size */
@@ -460,9 +497,47 @@ smbfs_read (void *data, char *buffer, size_t count)
     ssize_t n;
 
     DEBUG (3, ("smbfs_read(fnum:%d, nread:%d, count:%zu)\n", info->fnum, (int) info->nread, count));
-    n = cli_read (info->cli, info->fnum, buffer, info->nread, count);
-    if (n > 0)
+
+    if (!smbfs_flush (info))
+        return -1;
+
+    if (info->buf_len != 0 && info->nread >= info->buf_offset
+        && info->nread < info->buf_offset + (off_t) info->buf_len)
+    {
+        /* read ahead already */
+        n = MIN (count, (size_t) (info->buf_offset + info->buf_len - info->nread));
+        memcpy (buffer, info->buf + (info->nread - info->buf_offset), n);
         info->nread += n;
+        info->next_read = info->nread;
+        return n;
+    }
+
+    if (info->nread != info->next_read || count >= SMBFS_BUFFER_SIZE)
+    {
+        /* random access or large read: don't read ahead */
+        n = cli_read (info->cli, info->fnum, buffer, info->nread, count);
+        if (n > 0)
+            info->nread += n;
+        info->next_read = info->nread;
+        return n;
+    }
+
+    if (info->buf == NULL)
+        info->buf = g_malloc (SMBFS_BUFFER_SIZE);
+
+    /* sequential reading: fetch a large chunk in one pipelined transfer */
+    info->buf_len = 0;
+    n = cli_read (info->cli, info->fnum, info->buf, info->nread, SMBFS_BUFFER_SIZE);
+    if (n <= 0)
+        return n;
+
+    info->buf_offset = info->nread;
+    info->buf_len = n;
+
+    n = MIN (count, (size_t) n);
+    memcpy (buffer, info->buf, n);
+    info->nread += n;
+    info->next_read = info->nread;
     return n;
 }
 
@@ -476,10 +551,38 @@ smbfs_write (void *data, const char *buf, size_t nbyte)
 
     DEBUG (3, ("smbfs_write(fnum:%d, nread:%d, nbyte:%zu)\n",
                info->fnum, (int) info->nread, nbyte));
-    n = cli_write (info->cli, info->fnum, 0, buf, info->nread, nbyte);
-    if (n > 0)
-        info->nread += n;
-    return n;
+
+    if (!info->buf_dirty)
+        info->buf_len = 0;      /* drop data read ahead */
+    else if (info->nread != info->buf_offset + (off_t) info->buf_len
+             || info->buf_len + nbyte > SMBFS_BUFFER_SIZE)
+    {
+        if (!smbfs_flush (info))
+            return -1;
+    }
+
+    if (nbyte >= SMBFS_BUFFER_SIZE)
+    {
+        n = cli_write (info->cli, info->fnum, 0, buf, info->nread, nbyte);
+        if (n > 0)
+            info->nread += n;
+        return n;
+    }
+
+    /* collect small writes to send them in one pipelined transfer */
+    if (info->buf == NULL)
+        info->buf = g_malloc (SMBFS_BUFFER_SIZE);
+
+    if (!info->buf_dirty)
+    {
+        info->buf_dirty = TRUE;
+        info->buf_offset = info->nread;
+    }
+
+    memcpy (info->buf + info->buf_len, buf, nbyte);
+    info->buf_len += nbyte;
+    info->nread += nbyte;
+    return nbyte;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -488,6 +591,8 @@ static int
 smbfs_close (void *data)
 {
     smbfs_handle *info = (smbfs_handle *) data;
+    gboolean flushed;
+
     DEBUG (3, ("smbfs_close(fnum:%d)\n", info->fnum));
 
     /* FIXME: Why too different cli have the same outbuf
@@ -495,9 +600,15 @@ smbfs_close (void *data)
      */
     if (info->cli->outbuf == NULL)
     {
+        g_free (info->buf);
+        info->buf = NULL;
         my_errno = EINVAL;
         return -1;
     }
+
+    flushed = smbfs_flush (info);
+    g_free (info->buf);
+    info->buf = NULL;
 #if 0
     /* if imlementing archive_level:    add rname to smbfs_handle */
     if (archive_level >= 2 && (inf->attr & aARCH))
@@ -505,7 +616,7 @@ smbfs_close (void *data)
         cli_setatr (info->cli, rname, info->attr & ~(uint16) aARCH, 0);
     }
 #endif
-    return (cli_close (info->cli, info->fnum) == True) ? 0 : -1;
+    return (cli_close (info->cli, info->fnum) == True && flushed) ? 0 : -1;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -1824,6 +1935,9 @@ smbfs_lseek (void *data, off_t offset, int whence)
            ("smbfs_lseek(info->nread => %d, offset => %d, whence => %d) \n",
             (int) info->nread, (int) offset, whence));
 
+    if (!smbfs_flush (info))
+        return -1;
+
     switch (whence)
     {
     case SEEK_SET:
@@ -2081,7 +2195,7 @@ smbfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
 
     remote_file = free_after (smbfs_convert_path (remote_file, FALSE), remote_file);
 
-    remote_handle = g_new (smbfs_handle, 2);
+    remote_handle = g_new0 (smbfs_handle, 2);
     remote_handle->cli = sc->cli;
     remote_handle->nread = 0;
 
@@ -337,6 +337,7 @@ tar_open_archive_int (struct vfs_class *me, const vfs_path_t * vpath, struct vfs
     root->st.st_dev = MEDATA->rdev++;
 
     archive->root = root;
+    vfs_s_index_init (archive);
 
     return result;
 }
@@ -602,10 +603,8 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
     else
     {
         struct stat st;
-        struct vfs_s_entry *entry;
-        struct vfs_s_inode *inode = NULL, *parent;
+        guint32 num = 0;
         long data_position;
-        char *q;
         int len;
         char *current_file_name, *current_link_name;
 
@@ -659,76 +658,36 @@ tar_read_header (struct vfs_class *me, struct vfs_s_super *archive, int tard, si
         }
 
         canonicalize_pathname (current_file_name);
-        len = strlen (current_file_name);
 
         data_position = current_tar_position;
 
-        p = strrchr (current_file_name, '/');
-        if (p == NULL)
-        {
-            p = current_file_name;
-            q = current_file_name + len;        /* "" */
-        }
-        else
-        {
-            *(p++) = 0;
-            q = current_file_name;
-        }
-
-        parent = vfs_s_find_inode (me, archive, q, LINK_NO_FOLLOW, FL_MKDIR);
-        if (parent == NULL)
-        {
-            message (D_ERROR, MSG_ERROR, _("Inconsistent tar archive"));
-            return STATUS_BADCHECKSUM;
-        }
-
         if (header->header.linkflag == LF_LINK)
         {
-            inode = vfs_s_find_inode (me, archive, current_link_name, LINK_NO_FOLLOW, 0);
-            if (inode == NULL)
-            {
+            canonicalize_pathname (current_link_name);
+            num = vfs_s_index_lookup (me, archive, current_link_name);
+            if (num == 0)
                 message (D_ERROR, MSG_ERROR, _("Inconsistent tar archive"));
-            }
             else
-            {
-                entry = vfs_s_new_entry (me, p, inode);
-                vfs_s_insert_entry (me, parent, entry);
-                g_free (current_link_name);
-                goto done;
-            }
+                num = vfs_s_index_add_link (me, archive, current_file_name, num);
         }
 
-        tar_fill_stat (archive, &st, header, *h_size);
-        if (S_ISDIR (st.st_mode))
+        if (num == 0)
         {
-            entry = MEDATA->find_entry (me, parent, p, LINK_NO_FOLLOW, FL_NONE);
-            if (entry)
-                goto done;
+            tar_fill_stat (archive, &st, header, *h_size);
+            num = vfs_s_index_add (me, archive, current_file_name, &st, current_link_name,
+                                   data_position);
         }
-        inode = vfs_s_new_inode (me, archive, &st);
 
-        inode->data_offset = data_position;
-        if (*current_link_name)
-        {
-            inode->linkname = current_link_name;
-        }
-        else if (current_link_name != next_long_link)
-        {
-            g_free (current_link_name);
-        }
-        entry = vfs_s_new_entry (me, p, inode);
-
-        vfs_s_insert_entry (me, parent, entry);
         g_free (current_file_name);
-
-      done:
+        g_free (current_link_name);
         next_long_link = next_long_name = NULL;
 
         if (arch->type == TAR_GNU && header->header.unused.oldgnu.isextended)
         {
             while (tar_get_next_record (archive, tard)->ext_hdr.isextended != 0)
                 ;
-            inode->data_offset = current_tar_position;
+            if (num != 0)
+                vfs_s_index_get (archive, num)->offset = current_tar_position;
         }
         return STATUS_SUCCESS;
     }
@@ -796,6 +755,7 @@ tar_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
                 return -1;
 
             case STATUS_EOF:
+                vfs_s_index_finish (vpath_element->class, archive);
                 return 0;
             }
 
@@ -809,6 +769,8 @@ tar_open_archive (struct vfs_s_super *archive, const vfs_path_t * vpath,
         }
         break;
     };
+
+    vfs_s_index_finish (vpath_element->class, archive);
     return 0;
 }
 
@@ -42,6 +42,10 @@
  * 2. Files are on the local file system (we do not support vfs files
  *    because we would have to provide an io_manager for the ext2fs tools,
  *    and I don't think it would be too useful to undelete files
+ *
+ * The scan skips inodes which are in use and block groups without free inodes.
+ * Its result is saved in the cache directory and is used again while the
+ * superblock of file system is not changed.
  */
 
 #include <config.h>
@@ -64,6 +68,8 @@
 
 #include "lib/global.h"
 
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
 #include "lib/widget.h"         /* message() */
 #include "lib/vfs/utilvfs.h"
 #include "lib/vfs/vfs.h"
@@ -79,6 +85,8 @@
 
 #define undelfs_stat undelfs_lstat
 
+#define UNDELFS_CACHE_SIGNATURE "MCUNDEL1"
+
 /*** file scope type declarations ****************************************************************/
 
 struct deleted_info
@@ -101,6 +109,18 @@ struct lsdel_struct
     int bad_blocks;
 };
 
+/* header of the file with saved scan result, followed by count of struct deleted_info */
+typedef struct
+{
+    char signature[8];
+    guint8 uuid[16];            /* of file system */
+    guint32 wtime;              /* the superblock state the scan was made for */
+    guint32 free_inodes;
+    guint32 free_blocks;
+    guint32 record_size;
+    guint32 count;
+} undelfs_cache_header_t;
+
 typedef struct
 {
     int f_index;                /* file index into delarray */
@@ -225,6 +245,137 @@ undelfs_lsdel_proc (ext2_filsys _fs, blk_t * block_nr, int blockcnt, void *priva
     return 0;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+undelfs_cache_get_file_name (void)
+{
+    char base[sizeof (fs->super->s_uuid) * 2 + 1];
+    size_t i;
+
+    for (i = 0; i < sizeof (fs->super->s_uuid); i++)
+        g_snprintf (base + i * 2, 3, "%02x", (unsigned int) fs->super->s_uuid[i]);
+
+    return g_build_filename (mc_config_get_cache_path (), MC_UNDELFS_CACHE_DIR, base,
+                             (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+undelfs_cache_fill_header (undelfs_cache_header_t * header)
+{
+    memset (header, 0, sizeof (*header));
+    memcpy (header->signature, UNDELFS_CACHE_SIGNATURE, sizeof (header->signature));
+    memcpy (header->uuid, fs->super->s_uuid, sizeof (header->uuid));
+    header->wtime = fs->super->s_wtime;
+    header->free_inodes = fs->super->s_free_inodes_count;
+    header->free_blocks = fs->super->s_free_blocks_count;
+    header->record_size = sizeof (struct deleted_info);
+    header->count = num_delarray;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Save the information about deleted files, so the file system is not scanned next time */
+
+static void
+undelfs_cache_save (void)
+{
+    undelfs_cache_header_t header;
+    GByteArray *buf;
+    char *file_name, *dir_name;
+
+    undelfs_cache_fill_header (&header);
+
+    buf = g_byte_array_sized_new (sizeof (header) + num_delarray * sizeof (struct deleted_info));
+    g_byte_array_append (buf, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (buf, (const guint8 *) delarray,
+                         num_delarray * sizeof (struct deleted_info));
+
+    file_name = undelfs_cache_get_file_name ();
+    dir_name = g_path_get_dirname (file_name);
+    g_mkdir_with_parents (dir_name, 0700);
+    g_free (dir_name);
+
+    g_file_set_contents (file_name, (const gchar *) buf->data, buf->len, NULL);
+
+    g_free (file_name);
+    g_byte_array_free (buf, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load the information about deleted files saved by the previous scan.
+ * Return FALSE if there is no saved result for the current state of file system.
+ */
+
+static gboolean
+undelfs_cache_load (void)
+{
+    undelfs_cache_header_t header, saved;
+    char *file_name, *data;
+    gsize len;
+    gboolean ok;
+
+    file_name = undelfs_cache_get_file_name ();
+    if (!g_file_get_contents (file_name, &data, &len, NULL))
+        data = NULL;
+    g_free (file_name);
+
+    if (data == NULL)
+        return FALSE;
+
+    num_delarray = 0;
+    undelfs_cache_fill_header (&header);
+
+    ok = len >= sizeof (saved);
+    if (ok)
+    {
+        memcpy (&saved, data, sizeof (saved));
+        header.count = saved.count;
+        ok = memcmp (&header, &saved, sizeof (header)) == 0
+            && (len - sizeof (saved)) / sizeof (struct deleted_info) == saved.count;
+    }
+
+    if (ok)
+    {
+        max_delarray = num_delarray = (int) saved.count;
+        delarray = g_try_malloc (sizeof (struct deleted_info) * MAX (max_delarray, 1));
+        ok = delarray != NULL;
+        if (ok)
+            memcpy (delarray, data + sizeof (saved), sizeof (struct deleted_info) * num_delarray);
+    }
+
+    g_free (data);
+
+    if (!ok)
+    {
+        num_delarray = 0;
+        return FALSE;
+    }
+
+    readdir_ptr = READDIR_PTR_INIT;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Check whether there are free inodes in the block group, i. e. it can contain deleted files */
+
+static gboolean
+undelfs_group_has_free_inodes (dgrp_t group)
+{
+    ext2_ino_t ino, last;
+
+    ino = group * fs->super->s_inodes_per_group + 1;
+    last = MIN (ino + fs->super->s_inodes_per_group, fs->super->s_inodes_count + 1);
+
+    for (; ino < last; ino++)
+        if (!ext2fs_test_inode_bitmap (fs->inode_map, ino))
+            return TRUE;
+
+    return FALSE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Load information about deleted files.
@@ -238,6 +389,7 @@ undelfs_loaddel (void)
     ext2_ino_t ino;
     struct ext2_inode inode;
     ext2_inode_scan scan;
+    dgrp_t group = (dgrp_t) - 1;
 
     max_delarray = 100;
     num_delarray = 0;
@@ -259,6 +411,10 @@ undelfs_loaddel (void)
         message (D_ERROR, undelfserr, _("open_inode_scan: %d"), retval);
         goto free_block_buf;
     }
+#ifdef EXT2_SF_DO_LAZY
+    /* inode tables which were never initialized (uninit_bg) hold no deleted files */
+    ext2fs_inode_scan_flags (scan, EXT2_SF_DO_LAZY, 0);
+#endif
     retval = ext2fs_get_next_inode (scan, &ino, &inode);
     if (retval != 0)
     {
@@ -270,7 +426,28 @@ undelfs_loaddel (void)
     {
         if ((count++ % 1024) == 0)
             vfs_print_message (_("undelfs: loading deleted files information %d inodes"), count);
-        if (inode.i_dtime == 0)
+
+        if ((ino - 1) / fs->super->s_inodes_per_group != group)
+        {
+            group = (ino - 1) / fs->super->s_inodes_per_group;
+
+            /* all inodes of the group are in use: don't read its inode table */
+            if (!undelfs_group_has_free_inodes (group))
+            {
+                if (group + 1 >= fs->group_desc_count)
+                    break;
+                retval = ext2fs_inode_scan_goto_blockgroup (scan, group + 1);
+                if (retval != 0)
+                {
+                    message (D_ERROR, undelfserr, _("while doing inode scan %d"), retval);
+                    goto error_out;
+                }
+                goto next;
+            }
+        }
+
+        /* inodes in use aren't deleted, even if they have dtime (orphans) */
+        if (inode.i_dtime == 0 || ext2fs_test_inode_bitmap (fs->inode_map, ino))
             goto next;
 
         if (S_ISDIR (inode.i_mode))
@@ -293,14 +470,14 @@ undelfs_loaddel (void)
             {
                 struct deleted_info *delarray_new = g_try_realloc (delarray,
                                                                    sizeof (struct deleted_info) *
-                                                                   (max_delarray + 50));
+                                                                   (max_delarray * 2));
                 if (!delarray_new)
                 {
                     message (D_ERROR, undelfserr, _("no more memory while reallocating array"));
                     goto error_out;
                 }
                 delarray = delarray_new;
-                max_delarray += 50;
+                max_delarray *= 2;
             }
 
             delarray[num_delarray].ino = ino;
@@ -324,6 +501,7 @@ undelfs_loaddel (void)
     }
     readdir_ptr = READDIR_PTR_INIT;
     ext2fs_close_inode_scan (scan);
+    undelfs_cache_save ();
     return 1;
 
   error_out:
@@ -384,7 +562,7 @@ undelfs_opendir (const vfs_path_t * vpath)
         goto quit_opendir;
     }
     /* Now load the deleted information */
-    if (!undelfs_loaddel ())
+    if (!undelfs_cache_load () && !undelfs_loaddel ())
         goto quit_opendir;
     vfs_print_message (_("%s: done."), path_element->class->name);
     return fs;
@@ -431,6 +609,29 @@ undelfs_closedir (void *vfs_info)
     return 0;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static long
+undelfs_getindex (char *path)
+{
+    ext2_ino_t inode = atol (path);
+    long lo = 0, hi = num_delarray;
+
+    /* delarray is filled in the inode scan order */
+    while (lo < hi)
+    {
+        long i = lo + (hi - lo) / 2;
+
+        if (delarray[i].ino == inode)
+            return i;
+        if (delarray[i].ino < inode)
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    return -1;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /* We do not support lseek */
 
@@ -438,7 +639,8 @@ static void *
 undelfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
 {
     char *file, *f;
-    ext2_ino_t inode, i;
+    ext2_ino_t inode;
+    long i;
     undelfs_file *p = NULL;
     (void) flags;
     (void) mode;
@@ -458,11 +660,9 @@ undelfs_open (const vfs_path_t * vpath, int flags, mode_t mode)
     inode = atol (f);
 
     /* Search the file into delarray */
-    for (i = 0; i < (ext2_ino_t) num_delarray; i++)
+    i = undelfs_getindex (f);
+    if (i >= 0)
     {
-        if (inode != delarray[i].ino)
-            continue;
-
         /* Found: setup all the structures needed by read */
         p = (undelfs_file *) g_try_malloc (((gsize) sizeof (undelfs_file)));
         if (!p)
@@ -607,22 +807,6 @@ undelfs_read (void *vfs_info, char *buffer, size_t count)
 
 /* --------------------------------------------------------------------------------------------- */
 
-static long
-undelfs_getindex (char *path)
-{
-    ext2_ino_t inode = atol (path);
-    int i;
-
-    for (i = 0; i < num_delarray; i++)
-    {
-        if (delarray[i].ino == inode)
-            return i;
-    }
-    return -1;
-}
-
-/* --------------------------------------------------------------------------------------------- */
-
 static int
 undelfs_stat_int (int inode_index, struct stat *buf)
 {
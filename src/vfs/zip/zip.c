@@ -0,0 +1,921 @@
+/*
+   Virtual File System: zip file system.
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file
+ *  \brief Source: Virtual File System: zip file system.
+ *
+ *  The directory tree is built from the central directory of archive which is read
+ *  at once. The members are read directly from the archive: stored members are
+ *  copied, deflated ones are inflated by zlib while they are read.
+ *  Only the offset of central directory record is kept for every member; the rest of
+ *  member attributes is read again when the member is opened.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "lib/global.h"
+#include "lib/util.h"
+#include "lib/widget.h"         /* message() */
+
+#include "lib/vfs/vfs.h"
+#include "lib/vfs/utilvfs.h"
+#include "lib/vfs/xdirentry.h"
+#include "lib/vfs/gc.h"         /* vfs_rmstamp */
+
+#include "zip.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* signatures */
+#define ZIP_LOCAL_SIG       0x04034b50
+#define ZIP_CDIR_SIG        0x02014b50
+#define ZIP_EOCD_SIG        0x06054b50
+#define ZIP_EOCD64_LOC_SIG  0x07064b50
+#define ZIP_EOCD64_SIG      0x06064b50
+
+/* lengths of fixed parts of records */
+#define ZIP_LOCAL_LEN       30
+#define ZIP_CDIR_LEN        46
+#define ZIP_EOCD_LEN        22
+#define ZIP_EOCD64_LOC_LEN  20
+#define ZIP_EOCD64_LEN      56
+#define ZIP_MAX_COMMENT     0xffff
+
+/* extra fields */
+#define ZIP_EXTRA_ZIP64     0x0001
+#define ZIP_EXTRA_TIME      0x5455
+
+#define ZIP_FLAG_ENCRYPTED  0x0001
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+#define ZIP_HOST_UNIX       3
+#define ZIP_DOS_DIR         0x10
+#define ZIP_DOS_RDONLY      0x01
+
+/* size of buffer for compressed data */
+#define ZIP_INBUF_SIZE      (64 * 1024)
+
+/* little endian numbers */
+#define GET16(p) ((guint16) ((p)[0] | ((p)[1] << 8)))
+#define GET32(p) ((guint32) GET16 (p) | ((guint32) GET16 ((p) + 2) << 16))
+#define GET64(p) ((guint64) GET32 (p) | ((guint64) GET32 ((p) + 4) << 32))
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    int fd;
+    struct stat st;             /* stat of archive */
+    /* cache of mktime() for DOS times: the same date and hour */
+    guint32 dos_hour;
+    time_t dos_hour_time;
+} zip_super_data_t;
+
+/* Central directory record */
+typedef struct
+{
+    guint16 made_by;
+    guint16 flags;
+    guint16 method;
+    guint16 dos_time;
+    guint16 dos_date;
+    guint32 ext_attr;
+    guint64 csize;
+    guint64 usize;
+    guint64 offset;             /* offset of local header */
+    const char *name;
+    size_t name_len;
+    gboolean have_mtime;        /* mtime is taken from extended timestamp */
+    time_t mtime;
+    size_t len;                 /* length of whole record */
+} zip_cdir_entry_t;
+
+/* Opened member */
+typedef struct
+{
+    guint16 method;
+    guint64 csize;
+    off_t data_start;           /* offset of member data in the archive */
+    z_stream zs;
+    unsigned char *inbuf;
+    guint64 cpos;               /* compressed bytes read */
+    off_t upos;                 /* uncompressed bytes produced */
+} zip_fh_data_t;
+
+/*** file scope variables ************************************************************************/
+
+static struct vfs_class vfs_zipfs_ops;
+
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+zip_read_at (int fd, off_t offset, void *buf, size_t len)
+{
+    char *p = (char *) buf;
+
+    if (mc_lseek (fd, offset, SEEK_SET) != offset)
+        return FALSE;
+
+    while (len != 0)
+    {
+        ssize_t n;
+
+        n = mc_read (fd, p, len);
+        if (n <= 0)
+            return FALSE;
+        p += n;
+        len -= (size_t) n;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse record of central directory.
+ * @return FALSE if the record is broken
+ */
+
+static gboolean
+zip_parse_cdir (const unsigned char *p, size_t avail, zip_cdir_entry_t * e)
+{
+    const unsigned char *x, *end;
+    size_t extra_len;
+
+    if (avail < ZIP_CDIR_LEN || GET32 (p) != ZIP_CDIR_SIG)
+        return FALSE;
+
+    e->made_by = GET16 (p + 4);
+    e->flags = GET16 (p + 8);
+    e->method = GET16 (p + 10);
+    e->dos_time = GET16 (p + 12);
+    e->dos_date = GET16 (p + 14);
+    e->csize = GET32 (p + 20);
+    e->usize = GET32 (p + 24);
+    e->name_len = GET16 (p + 28);
+    extra_len = GET16 (p + 30);
+    e->ext_attr = GET32 (p + 38);
+    e->offset = GET32 (p + 42);
+    e->len = ZIP_CDIR_LEN + e->name_len + extra_len + GET16 (p + 32);
+    if (e->len > avail)
+        return FALSE;
+
+    e->name = (const char *) p + ZIP_CDIR_LEN;
+    e->have_mtime = FALSE;
+
+    end = p + ZIP_CDIR_LEN + e->name_len + extra_len;
+    for (x = p + ZIP_CDIR_LEN + e->name_len; x + 4 <= end; x += 4 + GET16 (x + 2))
+    {
+        const unsigned char *data = x + 4;
+        const unsigned char *data_end = data + GET16 (x + 2);
+
+        if (data_end > end)
+            break;
+
+        switch (GET16 (x))
+        {
+        case ZIP_EXTRA_ZIP64:
+            /* only the values which don't fit into the record are present */
+            if (e->usize == 0xffffffff && data + 8 <= data_end)
+            {
+                e->usize = GET64 (data);
+                data += 8;
+            }
+            if (e->csize == 0xffffffff && data + 8 <= data_end)
+            {
+                e->csize = GET64 (data);
+                data += 8;
+            }
+            if (e->offset == 0xffffffff && data + 8 <= data_end)
+                e->offset = GET64 (data);
+            break;
+        case ZIP_EXTRA_TIME:
+            if (data + 5 <= data_end && (data[0] & 1) != 0)
+            {
+                e->mtime = (time_t) (gint32) GET32 (data + 1);
+                e->have_mtime = TRUE;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find central directory.
+ * @return FALSE if the file is not a zip archive
+ */
+
+static gboolean
+zip_find_cdir (int fd, off_t size, off_t * cdir_offset, off_t * cdir_size)
+{
+    unsigned char *buf, *p;
+    size_t tail_len;
+    guint64 offset, len;
+    gboolean found = FALSE;
+
+    if (size < ZIP_EOCD_LEN)
+        return FALSE;
+
+    tail_len = (size_t) MIN (size, ZIP_EOCD_LEN + ZIP_MAX_COMMENT);
+    buf = g_malloc (tail_len);
+    if (!zip_read_at (fd, size - (off_t) tail_len, buf, tail_len))
+    {
+        g_free (buf);
+        return FALSE;
+    }
+
+    /* end of central directory record is followed by comment */
+    for (p = buf + tail_len - ZIP_EOCD_LEN; p >= buf; p--)
+        if (GET32 (p) == ZIP_EOCD_SIG && p + ZIP_EOCD_LEN + GET16 (p + 20) <= buf + tail_len)
+        {
+            found = TRUE;
+            break;
+        }
+
+    if (!found)
+    {
+        g_free (buf);
+        return FALSE;
+    }
+
+    len = GET32 (p + 12);
+    offset = GET32 (p + 16);
+
+    if ((offset == 0xffffffff || len == 0xffffffff || GET16 (p + 10) == 0xffff)
+        && p - buf >= ZIP_EOCD64_LOC_LEN && GET32 (p - ZIP_EOCD64_LOC_LEN) == ZIP_EOCD64_LOC_SIG)
+    {
+        unsigned char eocd64[ZIP_EOCD64_LEN];
+        guint64 eocd64_offset;
+
+        eocd64_offset = GET64 (p - ZIP_EOCD64_LOC_LEN + 8);
+        if (eocd64_offset + ZIP_EOCD64_LEN <= (guint64) size
+            && zip_read_at (fd, (off_t) eocd64_offset, eocd64, sizeof (eocd64))
+            && GET32 (eocd64) == ZIP_EOCD64_SIG)
+        {
+            len = GET64 (eocd64 + 40);
+            offset = GET64 (eocd64 + 48);
+        }
+    }
+
+    g_free (buf);
+
+    if (offset + len > (guint64) size)
+        return FALSE;
+
+    *cdir_offset = (off_t) offset;
+    *cdir_size = (off_t) len;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static time_t
+zip_dos_time (zip_super_data_t * arch, guint16 dos_date, guint16 dos_time)
+{
+    guint32 hour;
+
+    /* the same hour of the same day is met again and again: don't call mktime() */
+    hour = ((guint32) dos_date << 5) | (dos_time >> 11);
+    if (hour != arch->dos_hour || arch->dos_hour_time == (time_t) - 1)
+    {
+        struct tm tm;
+
+        memset (&tm, 0, sizeof (tm));
+        tm.tm_year = ((dos_date >> 9) & 0x7f) + 80;
+        tm.tm_mon = ((dos_date >> 5) & 0x0f) - 1;
+        tm.tm_mday = dos_date & 0x1f;
+        tm.tm_hour = dos_time >> 11;
+        tm.tm_isdst = -1;
+
+        arch->dos_hour = hour;
+        arch->dos_hour_time = mktime (&tm);
+    }
+
+    return arch->dos_hour_time + ((dos_time >> 5) & 0x3f) * 60 + (dos_time & 0x1f) * 2;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Insert entry into directory.
+ * Entries are prepended: appending to the long list is too slow, the lists are
+ * reversed when the whole archive is read.
+ */
+
+static void
+zip_insert_entry (struct vfs_s_inode *dir, struct vfs_s_entry *ent)
+{
+    ent->dir = dir;
+    ent->ino->st.st_nlink++;
+    dir->subdir = g_list_prepend (dir->subdir, ent);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get directory by path inside archive, create it and its parents if needed.
+ * @param path normalized path, may be changed temporarily
+ */
+
+static struct vfs_s_inode *
+zip_get_dir (struct vfs_class *me, struct vfs_s_super *super, GHashTable * dirs,
+             char *path, size_t len)
+{
+    struct vfs_s_inode *dir, *parent;
+    struct vfs_s_entry *entry;
+    struct stat st;
+    char *name, save;
+
+    if (len == 0)
+        return super->root;
+
+    save = path[len];
+    path[len] = '\0';
+    dir = (struct vfs_s_inode *) g_hash_table_lookup (dirs, path);
+    path[len] = save;
+
+    if (dir != NULL)
+        return dir;
+
+    for (name = path + len; name > path && name[-1] != PATH_SEP; name--)
+        ;
+
+    parent = zip_get_dir (me, super, dirs, path, name > path ? (size_t) (name - path - 1) : 0);
+
+    st = super->root->st;
+    st.st_size = 0;
+    dir = vfs_s_new_inode (me, super, &st);
+
+    save = path[len];
+    path[len] = '\0';
+    entry = vfs_s_new_entry (me, name, dir);
+    g_hash_table_insert (dirs, g_strdup (path), dir);
+    path[len] = save;
+
+    zip_insert_entry (parent, entry);
+
+    return dir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove empty and "." components of path.
+ * @return FALSE if the path contains ".." component
+ */
+
+static gboolean
+zip_normalize_path (char *path)
+{
+    char *src = path, *dst = path;
+
+    while (*src != '\0')
+    {
+        char *end;
+        size_t len;
+
+        end = strchr (src, PATH_SEP);
+        len = end != NULL ? (size_t) (end - src) : strlen (src);
+
+        if (len == 2 && src[0] == '.' && src[1] == '.')
+            return FALSE;
+
+        if (len != 0 && !(len == 1 && src[0] == '.'))
+        {
+            if (dst != path)
+                *dst++ = PATH_SEP;
+            memmove (dst, src, len);
+            dst += len;
+        }
+
+        src += len;
+        if (*src == PATH_SEP)
+            src++;
+    }
+
+    *dst = '\0';
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static zip_fh_data_t *
+zip_open_member (struct vfs_class *me, struct vfs_s_super *super, off_t cdir_offset)
+{
+    zip_super_data_t *arch = (zip_super_data_t *) super->data;
+    unsigned char head[ZIP_CDIR_LEN], *rec;
+    zip_cdir_entry_t e;
+    zip_fh_data_t *zfh;
+    size_t len;
+
+    /* central directory record */
+    if (!zip_read_at (arch->fd, cdir_offset, head, sizeof (head)))
+        ERRNOR (EIO, NULL);
+
+    len = ZIP_CDIR_LEN + GET16 (head + 28) + GET16 (head + 30) + GET16 (head + 32);
+    rec = g_malloc (len);
+    memcpy (rec, head, sizeof (head));
+    if (!zip_read_at (arch->fd, cdir_offset + ZIP_CDIR_LEN, rec + ZIP_CDIR_LEN,
+                      len - ZIP_CDIR_LEN) || !zip_parse_cdir (rec, len, &e))
+    {
+        g_free (rec);
+        ERRNOR (EIO, NULL);
+    }
+    g_free (rec);
+
+    if ((e.flags & ZIP_FLAG_ENCRYPTED) != 0)
+        ERRNOR (EACCES, NULL);
+    if (e.method != ZIP_METHOD_STORED && e.method != ZIP_METHOD_DEFLATED)
+        ERRNOR (E_NOTSUPP, NULL);
+
+    /* local header */
+    if (!zip_read_at (arch->fd, (off_t) e.offset, head, ZIP_LOCAL_LEN)
+        || GET32 (head) != ZIP_LOCAL_SIG)
+        ERRNOR (EIO, NULL);
+
+    zfh = g_new0 (zip_fh_data_t, 1);
+    zfh->method = e.method;
+    zfh->csize = e.csize;
+    zfh->data_start = (off_t) e.offset + ZIP_LOCAL_LEN + GET16 (head + 26) + GET16 (head + 28);
+
+    if (zfh->method == ZIP_METHOD_DEFLATED)
+    {
+        /* raw deflate data without zlib header */
+        if (inflateInit2 (&zfh->zs, -MAX_WBITS) != Z_OK)
+        {
+            g_free (zfh);
+            ERRNOR (ENOMEM, NULL);
+        }
+        zfh->inbuf = g_malloc (ZIP_INBUF_SIZE);
+    }
+
+    return zfh;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_close_member (zip_fh_data_t * zfh)
+{
+    if (zfh == NULL)
+        return;
+
+    if (zfh->method == ZIP_METHOD_DEFLATED)
+        inflateEnd (&zfh->zs);
+    g_free (zfh->inbuf);
+    g_free (zfh);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Inflate next len bytes of member */
+
+static ssize_t
+zip_inflate (struct vfs_class *me, int fd, zip_fh_data_t * zfh, char *buf, size_t len)
+{
+    z_stream *zs = &zfh->zs;
+    size_t done;
+
+    zs->next_out = (Bytef *) buf;
+    zs->avail_out = (uInt) len;
+
+    while (zs->avail_out != 0)
+    {
+        int ret;
+
+        if (zs->avail_in == 0)
+        {
+            size_t n;
+            ssize_t got;
+
+            n = (size_t) MIN (ZIP_INBUF_SIZE, zfh->csize - zfh->cpos);
+            if (n == 0)
+                break;
+
+            if (mc_lseek (fd, zfh->data_start + (off_t) zfh->cpos, SEEK_SET) == -1)
+                ERRNOR (EIO, -1);
+            got = mc_read (fd, zfh->inbuf, n);
+            if (got <= 0)
+                ERRNOR (EIO, -1);
+
+            zfh->cpos += (guint64) got;
+            zs->next_in = zfh->inbuf;
+            zs->avail_in = (uInt) got;
+        }
+
+        ret = inflate (zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END)
+            break;
+        if (ret != Z_OK)
+            ERRNOR (EIO, -1);
+    }
+
+    done = len - zs->avail_out;
+    zfh->upos += (off_t) done;
+    return (ssize_t) done;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Read count bytes of member from position pos */
+
+static ssize_t
+zip_read_member (struct vfs_class *me, int fd, zip_fh_data_t * zfh, off_t pos, char *buf,
+                 size_t count)
+{
+    ssize_t res;
+
+    if (zfh->method == ZIP_METHOD_STORED)
+    {
+        if (mc_lseek (fd, zfh->data_start + pos, SEEK_SET) != zfh->data_start + pos)
+            ERRNOR (EIO, -1);
+        res = mc_read (fd, buf, count);
+        if (res == -1)
+            ERRNOR (errno, -1);
+        return res;
+    }
+
+    /* deflated data can be read only sequentially */
+    if (pos < zfh->upos)
+    {
+        inflateReset (&zfh->zs);
+        zfh->zs.avail_in = 0;
+        zfh->cpos = 0;
+        zfh->upos = 0;
+    }
+
+    /* skip data before pos using buf as scratch */
+    while (zfh->upos < pos)
+    {
+        res = zip_inflate (me, fd, zfh, buf, (size_t) MIN ((off_t) count, pos - zfh->upos));
+        if (res <= 0)
+            return res;
+    }
+
+    return zip_inflate (me, fd, zfh, buf, count);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+zip_read_link (struct vfs_class *me, struct vfs_s_super *super, off_t cdir_offset, guint64 size)
+{
+    zip_fh_data_t *zfh;
+    char *link;
+    ssize_t n;
+
+    if (size == 0 || size >= MC_MAXPATHLEN)
+        return NULL;
+
+    zfh = zip_open_member (me, super, cdir_offset);
+    if (zfh == NULL)
+        return NULL;
+
+    link = g_malloc ((size_t) size + 1);
+    n = zip_read_member (me, ((zip_super_data_t *) super->data)->fd, zfh, 0, link, (size_t) size);
+    zip_close_member (zfh);
+
+    if (n <= 0)
+    {
+        g_free (link);
+        return NULL;
+    }
+
+    link[n] = '\0';
+    return link;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_add_entry (struct vfs_class *me, struct vfs_s_super *super, GHashTable * dirs,
+               const zip_cdir_entry_t * e, off_t cdir_offset)
+{
+    zip_super_data_t *arch = (zip_super_data_t *) super->data;
+    struct stat st;
+    struct vfs_s_inode *dir, *inode;
+    struct vfs_s_entry *entry;
+    char *path, *name;
+    size_t len;
+    gboolean is_dir;
+
+    path = g_strndup (e->name, e->name_len);
+    len = strlen (path);
+    is_dir = len != 0 && path[len - 1] == PATH_SEP;
+
+    if (!zip_normalize_path (path) || path[0] == '\0')
+    {
+        g_free (path);
+        return;
+    }
+
+    st = super->root->st;
+    st.st_rdev = 0;
+    st.st_size = (off_t) e->usize;
+    st.st_mtime = e->have_mtime ? e->mtime : zip_dos_time (arch, e->dos_date, e->dos_time);
+    st.st_atime = st.st_mtime;
+    st.st_ctime = st.st_mtime;
+
+    if ((e->made_by >> 8) == ZIP_HOST_UNIX && (e->ext_attr >> 16) != 0)
+    {
+        st.st_mode = (mode_t) (e->ext_attr >> 16);
+        if ((st.st_mode & S_IFMT) == 0)
+            st.st_mode |= is_dir ? S_IFDIR : S_IFREG;
+    }
+    else if (is_dir || (e->ext_attr & ZIP_DOS_DIR) != 0)
+        st.st_mode = S_IFDIR | 0755;
+    else if ((e->ext_attr & ZIP_DOS_RDONLY) != 0)
+        st.st_mode = S_IFREG | 0444;
+    else
+        st.st_mode = S_IFREG | 0644;
+
+    len = strlen (path);
+
+    if (S_ISDIR (st.st_mode))
+    {
+        /* directory could be already created for its entries */
+        inode = zip_get_dir (me, super, dirs, path, len);
+        inode->st.st_mode = st.st_mode;
+        inode->st.st_mtime = st.st_mtime;
+        inode->st.st_atime = st.st_atime;
+        inode->st.st_ctime = st.st_ctime;
+        g_free (path);
+        return;
+    }
+
+    name = strrchr (path, PATH_SEP);
+    if (name == NULL)
+    {
+        dir = super->root;
+        name = path;
+    }
+    else
+    {
+        dir = zip_get_dir (me, super, dirs, path, (size_t) (name - path));
+        name++;
+    }
+
+    inode = vfs_s_new_inode (me, super, &st);
+    inode->data_offset = cdir_offset;
+    if (S_ISLNK (st.st_mode))
+        inode->linkname = zip_read_link (me, super, cdir_offset, e->usize);
+
+    entry = vfs_s_new_entry (me, name, inode);
+    zip_insert_entry (dir, entry);
+
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_reverse_subdir (gpointer key, gpointer value, gpointer user_data)
+{
+    struct vfs_s_inode *dir = (struct vfs_s_inode *) value;
+
+    (void) key;
+    (void) user_data;
+
+    dir->subdir = g_list_reverse (dir->subdir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_free_archive (struct vfs_class *me, struct vfs_s_super *super)
+{
+    zip_super_data_t *arch = (zip_super_data_t *) super->data;
+
+    (void) me;
+
+    if (arch == NULL)
+        return;
+
+    if (arch->fd != -1)
+        mc_close (arch->fd);
+    g_free (super->data);
+    super->data = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_open_archive (struct vfs_s_super *super, const vfs_path_t * vpath,
+                  const vfs_path_element_t * vpath_element)
+{
+    struct vfs_class *me = vpath_element->class;
+    zip_super_data_t *arch;
+    struct vfs_s_inode *root;
+    GHashTable *dirs;
+    unsigned char *cdir;
+    off_t cdir_offset, cdir_size;
+    size_t pos;
+    int fd;
+
+    super->name = vfs_path_to_str (vpath);
+
+    fd = mc_open (super->name, O_RDONLY);
+    if (fd == -1)
+    {
+        message (D_ERROR, MSG_ERROR, _("Cannot open zip archive\n%s"), super->name);
+        return -1;
+    }
+
+    super->data = g_new0 (zip_super_data_t, 1);
+    arch = (zip_super_data_t *) super->data;
+    arch->fd = fd;
+    arch->dos_hour_time = (time_t) - 1;
+    mc_stat (super->name, &arch->st);
+
+    root = vfs_s_new_inode (me, super, &arch->st);
+    root->st.st_mode = (arch->st.st_mode & 07777) | ((arch->st.st_mode & 0444) >> 2) | S_IFDIR;
+    root->st.st_size = 0;
+    root->data_offset = -1;
+    root->st.st_nlink++;
+    root->st.st_dev = MEDATA->rdev++;
+    super->root = root;
+
+    if (!zip_find_cdir (fd, arch->st.st_size, &cdir_offset, &cdir_size))
+    {
+        message (D_ERROR, MSG_ERROR, _("Not a zip archive\n%s"), super->name);
+        return -1;
+    }
+
+    cdir = g_try_malloc ((gsize) cdir_size);
+    if (cdir == NULL || !zip_read_at (fd, cdir_offset, cdir, (size_t) cdir_size))
+    {
+        g_free (cdir);
+        message (D_ERROR, MSG_ERROR, _("Cannot read zip archive\n%s"), super->name);
+        return -1;
+    }
+
+    dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+    for (pos = 0; pos < (size_t) cdir_size;)
+    {
+        zip_cdir_entry_t e;
+
+        if (!zip_parse_cdir (cdir + pos, (size_t) cdir_size - pos, &e))
+            break;
+
+        zip_add_entry (me, super, dirs, &e, cdir_offset + (off_t) pos);
+        pos += e.len;
+    }
+
+    g_free (cdir);
+
+    root->subdir = g_list_reverse (root->subdir);
+    g_hash_table_foreach (dirs, zip_reverse_subdir, NULL);
+    g_hash_table_destroy (dirs);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void *
+zip_super_check (const vfs_path_t * vpath)
+{
+    static struct stat sb;
+    char *archive_name = vfs_path_to_str (vpath);
+    int stat_result;
+
+    stat_result = mc_stat (archive_name, &sb);
+    g_free (archive_name);
+    return (stat_result == 0 ? &sb : NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_super_same (const vfs_path_element_t * vpath_element, struct vfs_s_super *parc,
+                const vfs_path_t * vpath, void *cookie)
+{
+    struct stat *archive_stat = cookie; /* stat of main archive */
+    char *archive_name = vfs_path_to_str (vpath);
+
+    (void) vpath_element;
+
+    if (strcmp (parc->name, archive_name))
+    {
+        g_free (archive_name);
+        return 0;
+    }
+    g_free (archive_name);
+
+    /* Has the cached archive been changed on the disk? */
+    if (((zip_super_data_t *) parc->data)->st.st_mtime < archive_stat->st_mtime)
+    {
+        /* Yes, reload! */
+        (*vfs_zipfs_ops.free) ((vfsid) parc);
+        vfs_rmstamp (&vfs_zipfs_ops, (vfsid) parc);
+        return 2;
+    }
+    /* Hasn't been modified, give it a new timeout */
+    vfs_stamp (&vfs_zipfs_ops, (vfsid) parc);
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static ssize_t
+zip_read (void *fh, char *buffer, size_t count)
+{
+    struct vfs_class *me = FH_SUPER->me;
+    ssize_t res;
+
+    count = MIN (count, (size_t) (FH->ino->st.st_size - FH->pos));
+    if (count == 0)
+        return 0;
+
+    res = zip_read_member (me, ((zip_super_data_t *) FH_SUPER->data)->fd,
+                           (zip_fh_data_t *) FH->data, FH->pos, buffer, count);
+    if (res > 0)
+        FH->pos += res;
+    return res;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+zip_fh_open (struct vfs_class *me, vfs_file_handler_t * fh, int flags, mode_t mode)
+{
+    (void) mode;
+
+    fh->data = NULL;
+
+    if ((flags & O_ACCMODE) != O_RDONLY)
+        ERRNOR (EROFS, -1);
+
+    fh->data = zip_open_member (me, FH_SUPER, fh->ino->data_offset);
+    return fh->data != NULL ? 0 : -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+zip_fh_free_data (vfs_file_handler_t * fh)
+{
+    zip_close_member ((zip_fh_data_t *) fh->data);
+    fh->data = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+void
+init_zipfs (void)
+{
+    static struct vfs_s_subclass zip_subclass;
+
+    zip_subclass.flags = VFS_S_READONLY;
+    zip_subclass.archive_check = zip_super_check;
+    zip_subclass.archive_same = zip_super_same;
+    zip_subclass.open_archive = zip_open_archive;
+    zip_subclass.free_archive = zip_free_archive;
+    zip_subclass.fh_open = zip_fh_open;
+    zip_subclass.fh_free_data = zip_fh_free_data;
+
+    vfs_s_init_class (&vfs_zipfs_ops, &zip_subclass);
+    vfs_zipfs_ops.name = "zipfs";
+    /* the same prefix as extfs helper has: native reader takes precedence over it */
+    vfs_zipfs_ops.prefix = "uzip";
+    vfs_zipfs_ops.read = zip_read;
+    vfs_zipfs_ops.setctl = NULL;
+    vfs_register_class (&vfs_zipfs_ops);
+}
+
+/* --------------------------------------------------------------------------------------------- */
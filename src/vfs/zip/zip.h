@@ -0,0 +1,18 @@
+#ifndef MC__VFS_ZIP_H
+#define MC__VFS_ZIP_H
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void init_zipfs (void);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__VFS_ZIP_H */
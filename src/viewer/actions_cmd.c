@@ -178,14 +178,8 @@ mcview_hook (void *v)
 static cb_ret_t
 mcview_handle_editkey (mcview_t * view, int key)
 {
-    struct hexedit_change_node *node;
     int byte_val;
 
-    /* Has there been a change at this position? */
-    node = view->change_list;
-    while ((node != NULL) && (node->offset != view->hex_cursor))
-        node = node->next;
-
     if (!view->hexview_in_text)
     {
         /* Hex editing */
@@ -200,9 +194,8 @@ mcview_handle_editkey (mcview_t * view, int key)
         else
             return MSG_NOT_HANDLED;
 
-        if (node != NULL)
-            byte_val = node->value;
-        else
+        /* Has there been a change at this position? */
+        if (!mcview_hexedit_get_change (view, view->hex_cursor, &byte_val))
             mcview_get_byte (view, view->hex_cursor, &byte_val);
 
         if (view->hexedit_lownibble)
@@ -222,15 +215,7 @@ mcview_handle_editkey (mcview_t * view, int key)
     if ((view->filename != NULL) && (view->filename[0] != '\0') && (view->change_list == NULL))
         view->locked = mcview_lock_file (view);
 
-    if (node == NULL)
-    {
-        node = g_new (struct hexedit_change_node, 1);
-        node->offset = view->hex_cursor;
-        node->value = byte_val;
-        mcview_enqueue_change (&view->change_list, node);
-    }
-    else
-        node->value = byte_val;
+    mcview_hexedit_set_change (view, view->hex_cursor, (byte) byte_val);
 
     view->dirty++;
     mcview_move_right (view, 1);
@@ -51,10 +51,29 @@
    data source. If the growing buffer is used, this size may increase
    later on. Use the mcview_may_still_grow() function when you want to
    know if the size can change later.
+
+   Files of the local file system are mapped into memory if possible.
+   If the file is truncated while it is viewed, access beyond its new end
+   raises SIGBUS: the handler puts zero pages in place of the mapping and
+   the file is read through the page cache from then on.
+   Other files are read through the small page cache: a set of aligned
+   blocks replaced in LRU order. On a miss several adjacent blocks are
+   read at once in the direction the viewer moves to, so paging through
+   the file costs one seek per few screens. The block containing the last
+   requested byte is exposed as ds_file_data for mcview_get_byte_file().
  */
 
 #include <config.h>
 
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #include "lib/global.h"
 #include "lib/vfs/vfs.h"
 #include "lib/util.h"
@@ -66,13 +85,286 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Size of the page cache block */
+#define MCVIEW_FILE_BLOCK_SIZE (16 * 1024)
+
+/* Number of blocks in the page cache */
+#define MCVIEW_FILE_BLOCKS 32
+
+/* Number of blocks read at once on a cache miss */
+#define MCVIEW_FILE_READAHEAD 4
+
+#if defined (HAVE_MMAP) && defined (SA_SIGINFO)
+#if !defined (MAP_ANONYMOUS) && defined (MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifdef MAP_ANONYMOUS
+#define MCVIEW_USE_MMAP 1
+#endif
+#endif
+
+/* Number of viewers which can have the file mapped at once */
+#define MCVIEW_MAX_MAPS 4
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
 
+#ifdef MCVIEW_USE_MMAP
+/* Viewers having the file mapped, to find the mapping in SIGBUS handler */
+static mcview_t *volatile mapped_views[MCVIEW_MAX_MAPS];
+
+static struct sigaction old_sigbus_action;
+static gboolean sigbus_handler_installed = FALSE;
+#endif
+
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+static mcview_file_block_t *
+mcview_file_find_block (mcview_t * view, off_t blockoffset)
+{
+    int i;
+
+    for (i = 0; i < MCVIEW_FILE_BLOCKS; i++)
+        if (view->ds_file_blocks[i].offset == blockoffset)
+            return &view->ds_file_blocks[i];
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static mcview_file_block_t *
+mcview_file_lru_block (mcview_t * view)
+{
+    mcview_file_block_t *lru = &view->ds_file_blocks[0];
+    int i;
+
+    for (i = 1; i < MCVIEW_FILE_BLOCKS && lru->offset != INVALID_OFFSET; i++)
+        if (view->ds_file_blocks[i].offset == INVALID_OFFSET
+            || view->ds_file_blocks[i].stamp < lru->stamp)
+            lru = &view->ds_file_blocks[i];
+
+    return lru;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_file_alloc_blocks (mcview_t * view)
+{
+    byte *data;
+    int i;
+
+    view->ds_file_blocks = g_new (mcview_file_block_t, MCVIEW_FILE_BLOCKS);
+    data = g_malloc (MCVIEW_FILE_BLOCKS * MCVIEW_FILE_BLOCK_SIZE);
+
+    for (i = 0; i < MCVIEW_FILE_BLOCKS; i++)
+    {
+        view->ds_file_blocks[i].offset = INVALID_OFFSET;
+        view->ds_file_blocks[i].len = 0;
+        view->ds_file_blocks[i].stamp = 0;
+        view->ds_file_blocks[i].data = data + i * MCVIEW_FILE_BLOCK_SIZE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_file_drop_blocks (mcview_t * view)
+{
+    int i;
+
+    if (view->ds_file_blocks != NULL)
+        for (i = 0; i < MCVIEW_FILE_BLOCKS; i++)
+            view->ds_file_blocks[i].offset = INVALID_OFFSET;
+    view->ds_file_datalen = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the consecutive blocks starting from first one into the page cache.
+ * Returns FALSE if file cannot be read.
+ */
+
+static gboolean
+mcview_file_read_blocks (mcview_t * view, off_t first, int count)
+{
+    int i;
+
+    if (mc_lseek (view->ds_file_fd, first, SEEK_SET) == -1)
+        return FALSE;
+
+    for (i = 0; i < count; i++)
+    {
+        mcview_file_block_t *block;
+        size_t bytes_read = 0;
+
+        block = mcview_file_lru_block (view);
+        block->offset = INVALID_OFFSET;
+
+        while (bytes_read < MCVIEW_FILE_BLOCK_SIZE)
+        {
+            ssize_t res;
+
+            res = mc_read (view->ds_file_fd, block->data + bytes_read,
+                           MCVIEW_FILE_BLOCK_SIZE - bytes_read);
+            if (res == -1)
+                return (i != 0);
+            if (res == 0)
+                break;
+            bytes_read += (size_t) res;
+        }
+
+        if (bytes_read == 0)
+            break;
+
+        block->offset = first + (off_t) i * MCVIEW_FILE_BLOCK_SIZE;
+        if ((off_t) bytes_read > view->ds_file_filesize - block->offset)
+        {
+            /* the file has grown in the meantime -- stick to the old size */
+            block->len = view->ds_file_filesize - block->offset;
+        }
+        else
+            block->len = bytes_read;
+        block->stamp = ++view->ds_file_stamp;
+
+        if (bytes_read < MCVIEW_FILE_BLOCK_SIZE)
+            break;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef MCVIEW_USE_MMAP
+/**
+ * Access to the page of mapped file beyond its end, i.e. the file was truncated.
+ * Replace the mapping with zero pages, so the access can be completed, and mark it lost.
+ */
+
+static void
+mcview_sigbus_handler (int sig, siginfo_t * info, void *context)
+{
+    const byte *addr = (const byte *) info->si_addr;
+    size_t i;
+
+    (void) sig;
+    (void) context;
+
+    for (i = 0; i < MCVIEW_MAX_MAPS; i++)
+    {
+        mcview_t *view = mapped_views[i];
+
+        if (view != NULL && addr >= view->ds_file_map
+            && addr < view->ds_file_map + view->ds_file_maplen
+            && mmap (view->ds_file_map, view->ds_file_maplen, PROT_READ,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+        {
+            /* the next access goes to mcview_file_load_data() */
+            view->ds_file_datalen = 0;
+            view->ds_file_map_lost = TRUE;
+            return;
+        }
+    }
+
+    /* not our fault: the access is repeated with the previous handler */
+    sigaction (SIGBUS, &old_sigbus_action, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get descriptor of the local file opened by mc_open(), -1 for files of other VFS */
+
+static int
+mcview_file_get_local_fd (int fd)
+{
+    struct vfs_class *vclass;
+    int *local_fd;
+
+    vclass = vfs_class_find_by_handle (fd);
+    if (vclass == NULL || (vclass->flags & VFSF_LOCAL) == 0)
+        return -1;
+
+    /* local VFS keeps the descriptor as its file info (see local_open()) */
+    local_fd = (int *) vfs_class_data_find_by_handle (fd);
+    return local_fd != NULL ? *local_fd : -1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mcview_file_unmap (mcview_t * view)
+{
+    size_t i;
+
+    if (view->ds_file_map == NULL)
+        return;
+
+    for (i = 0; i < MCVIEW_MAX_MAPS; i++)
+        if (mapped_views[i] == view)
+            mapped_views[i] = NULL;
+
+    munmap (view->ds_file_map, view->ds_file_maplen);
+    view->ds_file_map = NULL;
+    view->ds_file_maplen = 0;
+    view->ds_file_map_lost = FALSE;
+    view->ds_file_datalen = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Map the viewed file of size into memory, if it is a local file */
+
+static void
+mcview_file_map (mcview_t * view, off_t size)
+{
+    int fd;
+    size_t i;
+    void *map;
+
+    mcview_file_unmap (view);
+
+    /* mapping of huge file on 32-bit system isn't possible */
+    if (size <= 0 || (off_t) (size_t) size != size)
+        return;
+
+    fd = mcview_file_get_local_fd (view->ds_file_fd);
+    if (fd == -1)
+        return;
+
+    for (i = 0; i < MCVIEW_MAX_MAPS && mapped_views[i] != NULL; i++)
+        ;
+    if (i == MCVIEW_MAX_MAPS)
+        return;
+
+    if (!sigbus_handler_installed)
+    {
+        struct sigaction sa;
+
+        memset (&sa, 0, sizeof (sa));
+        sa.sa_sigaction = mcview_sigbus_handler;
+        sa.sa_flags = SA_SIGINFO;
+        sigemptyset (&sa.sa_mask);
+        if (sigaction (SIGBUS, &sa, &old_sigbus_action) != 0)
+            return;
+        sigbus_handler_installed = TRUE;
+    }
+
+    /* shared mapping shows the changes saved by hexedit */
+    map = mmap (NULL, (size_t) size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return;
+
+    view->ds_file_map = (byte *) map;
+    view->ds_file_maplen = (size_t) size;
+    view->ds_file_map_lost = FALSE;
+    mapped_views[i] = view;
+}
+#endif /* MCVIEW_USE_MMAP */
+
+/* --------------------------------------------------------------------------------------------- */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -125,8 +417,16 @@ mcview_update_filesize (mcview_t * view)
     if (view->datasource == DS_FILE)
     {
         struct stat st;
-        if (mc_fstat (view->ds_file_fd, &st) != -1)
+        if (mc_fstat (view->ds_file_fd, &st) != -1 && view->ds_file_filesize != st.st_size)
+        {
             view->ds_file_filesize = st.st_size;
+            /* file was changed: don't use the stale data */
+            mcview_file_drop_blocks (view);
+#ifdef MCVIEW_USE_MMAP
+            if (view->ds_file_map != NULL)
+                mcview_file_map (view, st.st_size);
+#endif
+        }
     }
 }
 
@@ -245,7 +545,7 @@ mcview_set_byte (mcview_t * view, off_t offset, byte b)
     (void) &b;
     assert (offset < mcview_get_filesize (view));
     assert (view->datasource == DS_FILE);
-    view->ds_file_datalen = 0;  /* just force reloading */
+    mcview_file_drop_blocks (view);     /* just force reloading */
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -254,44 +554,86 @@ mcview_set_byte (mcview_t * view, off_t offset, byte b)
 void
 mcview_file_load_data (mcview_t * view, off_t byte_index)
 {
-    off_t blockoffset;
-    ssize_t res;
-    size_t bytes_read;
+    off_t blockoffset, first;
+    mcview_file_block_t *block;
+    int count;
 
     assert (view->datasource == DS_FILE);
 
+#ifdef MCVIEW_USE_MMAP
+    if (view->ds_file_map_lost)
+    {
+        /* the file was truncated: read it from now on */
+        mcview_file_unmap (view);
+        mcview_update_filesize (view);
+    }
+#endif
+
     if (mcview_already_loaded (view->ds_file_offset, byte_index, view->ds_file_datalen))
         return;
 
     if (byte_index >= view->ds_file_filesize)
         return;
 
-    blockoffset = mcview_offset_rounddown (byte_index, view->ds_file_datasize);
-    if (mc_lseek (view->ds_file_fd, blockoffset, SEEK_SET) == -1)
-        goto error;
-
-    bytes_read = 0;
-    while (bytes_read < view->ds_file_datasize)
+    if (view->ds_file_map != NULL && byte_index < (off_t) view->ds_file_maplen)
     {
-        res =
-            mc_read (view->ds_file_fd, view->ds_file_data + bytes_read,
-                     view->ds_file_datasize - bytes_read);
-        if (res == -1)
-            goto error;
-        if (res == 0)
-            break;
-        bytes_read += (size_t) res;
+        view->ds_file_offset = 0;
+        view->ds_file_data = view->ds_file_map;
+        view->ds_file_datalen = min (view->ds_file_maplen, (size_t) view->ds_file_filesize);
+        return;
     }
-    view->ds_file_offset = blockoffset;
-    if ((off_t) bytes_read > view->ds_file_filesize - view->ds_file_offset)
+
+    /* the page cache is allocated on demand: it isn't needed if the file is mapped */
+    if (view->ds_file_blocks == NULL)
+        mcview_file_alloc_blocks (view);
+
+    blockoffset = mcview_offset_rounddown (byte_index, MCVIEW_FILE_BLOCK_SIZE);
+
+    block = mcview_file_find_block (view, blockoffset);
+    if (block != NULL && !mcview_already_loaded (block->offset, byte_index, block->len))
     {
-        /* the file has grown in the meantime -- stick to the old size */
-        view->ds_file_datalen = view->ds_file_filesize - view->ds_file_offset;
+        /* short block: the file has grown since it was read */
+        block->offset = INVALID_OFFSET;
+        block = NULL;
     }
-    else
+
+    if (block == NULL)
     {
-        view->ds_file_datalen = bytes_read;
+        /* read ahead in the direction of movement, up to the first cached block */
+        first = blockoffset;
+        for (count = 1; count < MCVIEW_FILE_READAHEAD; count++)
+        {
+            off_t next;
+
+            if (blockoffset < view->ds_file_lastblock)
+            {
+                next = first - MCVIEW_FILE_BLOCK_SIZE;
+                if (next < 0 || mcview_file_find_block (view, next) != NULL)
+                    break;
+                first = next;
+            }
+            else
+            {
+                next = blockoffset + (off_t) count * MCVIEW_FILE_BLOCK_SIZE;
+                if (next >= view->ds_file_filesize || mcview_file_find_block (view, next) != NULL)
+                    break;
+            }
+        }
+
+        view->ds_file_lastblock = blockoffset;
+
+        if (!mcview_file_read_blocks (view, first, count))
+            goto error;
+
+        block = mcview_file_find_block (view, blockoffset);
+        if (block == NULL || !mcview_already_loaded (block->offset, byte_index, block->len))
+            goto error;
     }
+
+    block->stamp = ++view->ds_file_stamp;
+    view->ds_file_offset = block->offset;
+    view->ds_file_data = block->data;
+    view->ds_file_datalen = block->len;
     return;
 
   error:
@@ -328,8 +670,19 @@ mcview_close_datasource (mcview_t * view)
     case DS_FILE:
         (void) mc_close (view->ds_file_fd);
         view->ds_file_fd = -1;
-        g_free (view->ds_file_data);
+#ifdef MCVIEW_USE_MMAP
+        mcview_file_unmap (view);
+#endif
+        view->ds_file_map = NULL;
+        if (view->ds_file_blocks != NULL)
+        {
+            /* all blocks share one buffer */
+            g_free (view->ds_file_blocks[0].data);
+            g_free (view->ds_file_blocks);
+            view->ds_file_blocks = NULL;
+        }
         view->ds_file_data = NULL;
+        view->ds_file_datalen = 0;
         break;
     case DS_STRING:
         g_free (view->ds_string_data);
@@ -350,9 +703,20 @@ mcview_set_datasource_file (mcview_t * view, int fd, const struct stat *st)
     view->ds_file_fd = fd;
     view->ds_file_filesize = st->st_size;
     view->ds_file_offset = 0;
-    view->ds_file_data = g_malloc (4096);
+    view->ds_file_data = NULL;
     view->ds_file_datalen = 0;
-    view->ds_file_datasize = 4096;
+    view->ds_file_datasize = MCVIEW_FILE_BLOCK_SIZE;
+
+    view->ds_file_map = NULL;
+    view->ds_file_maplen = 0;
+    view->ds_file_map_lost = FALSE;
+#ifdef MCVIEW_USE_MMAP
+    mcview_file_map (view, st->st_size);
+#endif
+
+    view->ds_file_blocks = NULL;
+    view->ds_file_stamp = 0;
+    view->ds_file_lastblock = 0;
 }
 
 /* --------------------------------------------------------------------------------------------- */
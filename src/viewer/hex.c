@@ -39,6 +39,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>           /* uintmax_t */
+#include <string.h>
 
 #include "lib/global.h"
 #include "lib/tty/tty.h"
@@ -54,6 +55,8 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+#define HEXEDIT_PAGE_CHANGED(page, i) (((page)->mask[(i) / 32] & (1U << ((i) % 32))) != 0)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -114,6 +117,130 @@ utf8_to_int (char *str, int *char_width, gboolean * result)
     return ch;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the page of the change set which covers the offset.
+ * Returns TRUE if page exists; otherwise idx is set to the position where such page
+ * should be inserted. Displaying and editing access the pages in sequence, so the
+ * last accessed page and its neighbour are checked before the binary search.
+ */
+
+static gboolean
+mcview_hexedit_find_page (mcview_t * view, off_t offset, guint * idx)
+{
+    GPtrArray *pages = view->change_list;
+    const off_t page_offset = offset - offset % HEXEDIT_PAGE_SIZE;
+    const struct hexedit_change_page *page;
+    guint lo, hi;
+
+    if (view->change_last < pages->len)
+    {
+        page = g_ptr_array_index (pages, view->change_last);
+        if (page->offset == page_offset)
+        {
+            *idx = view->change_last;
+            return TRUE;
+        }
+
+        if (page->offset < page_offset)
+        {
+            if (view->change_last + 1 == pages->len)
+            {
+                *idx = pages->len;
+                return FALSE;
+            }
+
+            page = g_ptr_array_index (pages, view->change_last + 1);
+            if (page->offset == page_offset)
+            {
+                *idx = ++view->change_last;
+                return TRUE;
+            }
+        }
+    }
+
+    lo = 0;
+    hi = pages->len;
+    while (lo < hi)
+    {
+        const guint mid = lo + (hi - lo) / 2;
+
+        page = g_ptr_array_index (pages, mid);
+        if (page->offset < page_offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *idx = lo;
+
+    if (lo < pages->len && ((struct hexedit_change_page *) g_ptr_array_index (pages, lo))->offset
+        == page_offset)
+    {
+        view->change_last = lo;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mcview_hexedit_write_run (mcview_t * view, int fd, off_t offset, const byte * buf, size_t len)
+{
+    if (mc_lseek (fd, offset, SEEK_SET) == -1 || mc_write (fd, buf, len) != (ssize_t) len)
+        return FALSE;
+
+    mcview_set_byte (view, offset, buf[0]);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/** Write the change set to the file: every run of adjacent changed bytes is written at once */
+
+static gboolean
+mcview_hexedit_write_changes (mcview_t * view, int fd)
+{
+    byte run[BUF_8K];
+    off_t run_offset = 0;
+    size_t run_len = 0;
+    guint i;
+
+    for (i = 0; i < view->change_list->len; i++)
+    {
+        const struct hexedit_change_page *page = g_ptr_array_index (view->change_list, i);
+        int j;
+
+        for (j = 0; j < HEXEDIT_PAGE_SIZE; j++)
+        {
+            /* skip the unchanged parts of page quickly */
+            if (j % 32 == 0 && page->mask[j / 32] == 0)
+            {
+                j += 31;
+                continue;
+            }
+
+            if (!HEXEDIT_PAGE_CHANGED (page, j))
+                continue;
+
+            if (run_len != 0
+                && (page->offset + j != run_offset + (off_t) run_len || run_len == sizeof (run)))
+            {
+                if (!mcview_hexedit_write_run (view, fd, run_offset, run, run_len))
+                    return FALSE;
+                run_len = 0;
+            }
+
+            if (run_len == 0)
+                run_offset = page->offset + j;
+            run[run_len++] = page->value[j];
+        }
+    }
+
+    return (run_len == 0 || mcview_hexedit_write_run (view, fd, run_offset, run, run_len));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -137,7 +264,7 @@ mcview_display_hex (mcview_t * view)
     off_t from;
     int c;
     mark_t boldflag = MARK_NORMAL;
-    struct hexedit_change_node *curr = view->change_list;
+    gboolean changed;
     int ch = 0;
 
     char hex_buff[10];          /* A temporary buffer for sprintf and mvwaddstr */
@@ -145,12 +272,7 @@ mcview_display_hex (mcview_t * view)
 
     mcview_display_clean (view);
 
-    /* Find the first displayable changed byte */
     from = view->dpy_start;
-    while (curr && (curr->offset < from))
-    {
-        curr = curr->next;
-    }
 
     for (row = 0; mcview_get_byte (view, from, NULL) == TRUE && row < height; row++)
     {
@@ -184,21 +306,18 @@ mcview_display_hex (mcview_t * view)
                 /* char width is greater 0 bytes */
                 if (cw != 0)
                 {
-                    struct hexedit_change_node *corr = curr;
                     int res = g_unichar_to_utf8 (ch, (char *) corr_buf);
                     for (cnt = 0; cnt < cw; cnt++)
                     {
-                        if (curr != NULL && from + cnt == curr->offset)
-                        {
-                            /* replace only changed bytes in array of multibyte char */
-                            corr_buf[cnt] = curr->value;
-                            curr = curr->next;
-                        }
+                        int value;
+
+                        /* replace only changed bytes in array of multibyte char */
+                        if (mcview_hexedit_get_change (view, from + cnt, &value))
+                            corr_buf[cnt] = value;
                     }
                     corr_buf[res] = '\0';
                     /* Determine the state of the current multibyte char */
                     ch = utf8_to_int ((char *) corr_buf, &cw, &read_res);
-                    curr = corr;
                 }
             }
 #endif
@@ -212,20 +331,16 @@ mcview_display_hex (mcview_t * view)
                 view->cursor_col = col;
             }
 
+            /* Determine the value of the current byte */
+            changed = mcview_hexedit_get_change (view, from, &c);
+
             /* Determine the state of the current byte */
             boldflag =
                 (from == view->hex_cursor) ? MARK_CURSOR
-                : (curr != NULL && from == curr->offset) ? MARK_CHANGED
+                : changed ? MARK_CHANGED
                 : (view->search_start <= from &&
                    from < view->search_end) ? MARK_SELECTED : MARK_NORMAL;
 
-            /* Determine the value of the current byte */
-            if (curr != NULL && from == curr->offset)
-            {
-                c = curr->value;
-                curr = curr->next;
-            }
-
             /* Select the color for the hex number */
             tty_setcolor (boldflag == MARK_NORMAL ? NORMAL_COLOR :
                           boldflag == MARK_SELECTED ? VIEW_BOLD_COLOR :
@@ -346,39 +461,23 @@ mcview_hexedit_save_changes (mcview_t * view)
     {
         int fp;
         char *text;
-        struct hexedit_change_node *curr, *next;
 
         assert (view->filename != NULL);
 
         fp = mc_open (view->filename, O_WRONLY);
         if (fp != -1)
         {
-            for (curr = view->change_list; curr != NULL; curr = next)
-            {
-                next = curr->next;
-
-                if (mc_lseek (fp, curr->offset, SEEK_SET) == -1
-                    || mc_write (fp, &(curr->value), 1) != 1)
-                    goto save_error;
-
-                /* delete the saved item from the change list */
-                view->change_list = next;
-                view->dirty++;
-                mcview_set_byte (view, curr->offset, curr->value);
-                g_free (curr);
-            }
-
-            view->change_list = NULL;
+            if (!mcview_hexedit_write_changes (view, fp))
+                goto save_error;
 
-            if (view->locked)
-                view->locked = mcview_unlock_file (view);
+            /* unlocks the file as well */
+            mcview_hexedit_free_change_list (view);
 
             if (mc_close (fp) == -1)
                 message (D_ERROR, _("Save file"),
                          _("Error while closing the file:\n%s\n"
                            "Data may have been written or not"), unix_error_string (errno));
 
-            view->dirty++;
             return TRUE;
         }
 
@@ -408,14 +507,13 @@ mcview_toggle_hexedit_mode (mcview_t * view)
 void
 mcview_hexedit_free_change_list (mcview_t * view)
 {
-    struct hexedit_change_node *curr, *next;
-
-    for (curr = view->change_list; curr != NULL; curr = next)
+    if (view->change_list != NULL)
     {
-        next = curr->next;
-        g_free (curr);
+        g_ptr_array_foreach (view->change_list, (GFunc) g_free, NULL);
+        g_ptr_array_free (view->change_list, TRUE);
+        view->change_list = NULL;
     }
-    view->change_list = NULL;
+    view->change_last = 0;
 
     if (view->locked)
         view->locked = mcview_unlock_file (view);
@@ -423,21 +521,62 @@ mcview_hexedit_free_change_list (mcview_t * view)
     view->dirty++;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the new value of byte from the change set.
+ * Returns FALSE if the byte at this offset was not changed.
+ */
+
+gboolean
+mcview_hexedit_get_change (mcview_t * view, off_t offset, int *value)
+{
+    const struct hexedit_change_page *page;
+    guint idx;
+    int i;
+
+    if (view->change_list == NULL || !mcview_hexedit_find_page (view, offset, &idx))
+        return FALSE;
+
+    page = g_ptr_array_index (view->change_list, idx);
+    i = offset - page->offset;
+    if (!HEXEDIT_PAGE_CHANGED (page, i))
+        return FALSE;
+
+    if (value != NULL)
+        *value = page->value[i];
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
-mcview_enqueue_change (struct hexedit_change_node **head, struct hexedit_change_node *node)
+mcview_hexedit_set_change (mcview_t * view, off_t offset, byte value)
 {
-    /* chnode always either points to the head of the list or
-     * to one of the ->next fields in the list. The value at
-     * this location will be overwritten with the new node.   */
-    struct hexedit_change_node **chnode = head;
+    struct hexedit_change_page *page;
+    guint idx;
+    int i;
 
-    while (*chnode != NULL && (*chnode)->offset < node->offset)
-        chnode = &((*chnode)->next);
+    if (view->change_list == NULL)
+        view->change_list = g_ptr_array_new ();
+
+    if (mcview_hexedit_find_page (view, offset, &idx))
+        page = g_ptr_array_index (view->change_list, idx);
+    else
+    {
+        page = g_new0 (struct hexedit_change_page, 1);
+        page->offset = offset - offset % HEXEDIT_PAGE_SIZE;
+
+        /* insert the page at idx */
+        g_ptr_array_add (view->change_list, NULL);
+        memmove (&view->change_list->pdata[idx + 1], &view->change_list->pdata[idx],
+                 (view->change_list->len - 1 - idx) * sizeof (gpointer));
+        view->change_list->pdata[idx] = page;
+        view->change_last = idx;
+    }
 
-    node->next = *chnode;
-    *chnode = node;
+    i = offset - page->offset;
+    page->mask[i / 32] |= 1U << (i % 32);
+    page->value[i] = value;
 }
 
 /* --------------------------------------------------------------------------------------------- */
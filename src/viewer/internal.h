@@ -22,6 +22,9 @@ typedef unsigned int screen_dimen;
 extern const off_t INVALID_OFFSET;
 extern const off_t OFFSETTYPE_MAX;
 
+/* Number of bytes covered by one page of the hexedit change set */
+#define HEXEDIT_PAGE_SIZE 1024
+
 /*** enums ***************************************************************************************/
 
 /* data sources of the view */
@@ -49,14 +52,23 @@ typedef enum
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
-/* A node for building a change list on change_list */
-struct hexedit_change_node
+/* A page of the hexedit change set. Pages are kept in change_list sorted by offset */
+struct hexedit_change_page
 {
-    struct hexedit_change_node *next;
-    off_t offset;
-    byte value;
+    off_t offset;               /* offset of the first byte of page, multiple of HEXEDIT_PAGE_SIZE */
+    guint32 mask[HEXEDIT_PAGE_SIZE / 32];       /* bit is set for every changed byte */
+    byte value[HEXEDIT_PAGE_SIZE];      /* new values of changed bytes */
 };
 
+/* A block of the page cache of DS_FILE data source */
+typedef struct
+{
+    off_t offset;               /* offset of the block in file, INVALID_OFFSET for unused block */
+    size_t len;                 /* number of valid bytes in data */
+    unsigned long stamp;        /* time of the last use, for LRU replacement */
+    byte *data;
+} mcview_file_block_t;
+
 struct area
 {
     screen_dimen top, left;
@@ -108,6 +120,12 @@ typedef struct mcview_struct
     byte *ds_file_data;         /* Currently loaded data */
     size_t ds_file_datalen;     /* Number of valid bytes in file_data */
     size_t ds_file_datasize;    /* Number of allocated bytes in file_data */
+    byte *ds_file_map;          /* The whole file mapped into memory, or NULL */
+    size_t ds_file_maplen;      /* Length of the mapping */
+    volatile gboolean ds_file_map_lost; /* File was truncated, the mapping shows zeros now */
+    mcview_file_block_t *ds_file_blocks;        /* Page cache of the file */
+    unsigned long ds_file_stamp;        /* LRU clock of the page cache */
+    off_t ds_file_lastblock;    /* Offset of the last block read, to detect the direction */
 
     /* string data source */
     byte *ds_string_data;       /* The characters of the string */
@@ -143,7 +161,8 @@ typedef struct mcview_struct
     off_t hex_cursor;           /* Hexview cursor position in file */
     screen_dimen cursor_col;    /* Cursor column */
     screen_dimen cursor_row;    /* Cursor row */
-    struct hexedit_change_node *change_list;    /* Linked list of changes */
+    GPtrArray *change_list;     /* Pages of changes, NULL if there are no changes */
+    guint change_last;          /* Index of the last accessed page of change_list */
     struct area status_area;    /* Where the status line is displayed */
     struct area ruler_area;     /* Where the ruler is displayed */
     struct area data_area;      /* Where the data is displayed */
@@ -270,7 +289,8 @@ void mcview_display_hex (mcview_t * view);
 gboolean mcview_hexedit_save_changes (mcview_t * view);
 void mcview_toggle_hexedit_mode (mcview_t * view);
 void mcview_hexedit_free_change_list (mcview_t * view);
-void mcview_enqueue_change (struct hexedit_change_node **, struct hexedit_change_node *);
+gboolean mcview_hexedit_get_change (mcview_t * view, off_t offset, int *value);
+void mcview_hexedit_set_change (mcview_t * view, off_t offset, byte value);
 
 /* lib.c: */
 void mcview_toggle_magic_mode (mcview_t * view);
@@ -205,6 +205,7 @@ mcview_init (mcview_t * view)
     view->cursor_col = 0;
     view->cursor_row = 0;
     view->change_list = NULL;
+    view->change_last = 0;
 
     /* {status,ruler,data}_area are left uninitialized */
 
@@ -103,17 +103,11 @@ mcview_display_nroff (mcview_t * view)
     int c;
     int c_prev = 0;
     int c_next = 0;
-    struct hexedit_change_node *curr = view->change_list;
 
     mcview_display_clean (view);
     mcview_display_ruler (view);
 
-    /* Find the first displayable changed byte */
     from = view->dpy_start;
-    while (curr && (curr->offset < from))
-    {
-        curr = curr->next;
-    }
 
     tty_setcolor (NORMAL_COLOR);
     for (row = 0, col = 0; row < height;)
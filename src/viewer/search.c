@@ -48,6 +48,13 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Backward search scans the file forward in windows of this size */
+#define MCVIEW_SEARCH_WINDOW (4 * 1024)
+
+/* Backward search scans the text past the window up to the end of line, but not further
+   than this length at once; the limit is raised while the match reaches it */
+#define MCVIEW_SEARCH_MAX_MATCH (4 * 1024)
+
 /*** file scope type declarations ****************************************************************/
 
 /*** file scope variables ************************************************************************/
@@ -75,43 +82,124 @@ mcview_search_update_steps (mcview_t * view)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-mcview_find (mcview_t * view, gsize search_start, gsize * len)
+mcview_find_run (mcview_t * view, gsize search_start, gsize search_end, gsize * len)
 {
-    gsize search_end;
-
     view->search_numNeedSkipChar = 0;
     search_cb_char_curr_index = -1;
 
-    if (mcview_search_options.backwards)
+    view->search_nroff_seq->index = search_start;
+    mcview_nroff_seq_info (view->search_nroff_seq);
+
+    return mc_search_run (view->search, (void *) view, search_start, search_end, len);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find the last match which starts not after search_start.
+ * The text before search_start is scanned forward in windows, from the nearest one to
+ * the beginning of file; the last match within the window is the result. Matches don't
+ * cross the line ends, so the window is scanned up to the end of line where it ends,
+ * but not further than MCVIEW_SEARCH_MAX_MATCH bytes past the window. If a match reaches
+ * this limit, the scan is extended until the match ends before it or the line ends.
+ * A regular expression which can match only with more than MCVIEW_SEARCH_MAX_MATCH bytes
+ * past the window (e.g. "a.*b" with the distant "b") is not found in this window.
+ * Every scan continues right after the start of previous match, so overlapping
+ * matches are found too.
+ */
+
+static gboolean
+mcview_find_backward (mcview_t * view, gsize search_start, gsize * len)
+{
+    off_t win_start, win_end;
+
+    win_end = search_start;
+
+    while (win_end >= 0)
     {
-        search_end = mcview_get_filesize (view);
-        while ((int) search_start >= 0)
+        off_t pos, search_end, search_limit = 0;
+        gboolean found = FALSE;
+        off_t found_offset = 0, found_buffer = 0;
+        gsize found_len = 0;
+
+        win_start = mcview_offset_doz (win_end, MCVIEW_SEARCH_WINDOW - 1);
+
+        if (mc_search_is_fixed_search_str (view->search))
+            search_end = win_end + view->search->original_len;
+        else
         {
-            view->search_nroff_seq->index = search_start;
-            mcview_nroff_seq_info (view->search_nroff_seq);
+            search_limit = win_end + MCVIEW_SEARCH_MAX_MATCH;
+            search_end = mcview_eol (view, win_end, search_limit);
+        }
 
-            if (search_end > search_start + view->search->original_len
-                && mc_search_is_fixed_search_str (view->search))
-                search_end = search_start + view->search->original_len;
+        for (pos = win_start; pos <= win_end;)
+        {
+            gsize match_len;
+            int c;
 
-            if (mc_search_run (view->search, (void *) view, search_start, search_end, len)
-                && view->search->normal_offset == (off_t) search_start)
+            if (!mcview_find_run (view, pos, search_end, &match_len))
             {
-                if (view->text_nroff_mode)
-                    view->search->normal_offset++;
-                return TRUE;
+                /* interrupted by user */
+                if (view->search->error_str == NULL)
+                    return FALSE;
+                break;
+            }
+
+            if (view->search->normal_offset > win_end)
+                break;
+
+            /* the match could be cut at the limit inside of line: scan further and try again */
+            if (search_end == search_limit
+                && view->search->normal_offset + (off_t) match_len >= search_end
+                && mcview_get_byte (view, search_end - 1, &c) && c != '\n')
+            {
+                off_t line_end;
+
+                search_limit += MCVIEW_SEARCH_MAX_MATCH;
+                line_end = mcview_eol (view, search_end, search_limit);
+                if (line_end > search_end)
+                {
+                    search_end = line_end;
+                    continue;
+                }
             }
 
-            search_start--;
+            found = TRUE;
+            found_offset = view->search->normal_offset;
+            found_buffer = view->search->start_buffer;
+            found_len = match_len;
+            /* the next match can overlap this one */
+            pos = found_offset + 1;
         }
-        view->search->error_str = g_strdup (_("Search string not found"));
-        return FALSE;
+
+        if (found)
+        {
+            g_free (view->search->error_str);
+            view->search->error_str = NULL;
+            view->search->normal_offset = found_offset;
+            view->search->start_buffer = found_buffer;
+            if (view->text_nroff_mode)
+                view->search->normal_offset++;
+            *len = found_len;
+            return TRUE;
+        }
+
+        win_end = win_start - 1;
     }
-    view->search_nroff_seq->index = search_start;
-    mcview_nroff_seq_info (view->search_nroff_seq);
 
-    return mc_search_run (view->search, (void *) view, search_start, mcview_get_filesize (view),
-                          len);
+    g_free (view->search->error_str);
+    view->search->error_str = g_strdup (_("Search string not found"));
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+mcview_find (mcview_t * view, gsize search_start, gsize * len)
+{
+    if (mcview_search_options.backwards)
+        return mcview_find_backward (view, search_start, len);
+
+    return mcview_find_run (view, search_start, mcview_get_filesize (view), len);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,146 @@
+/*
+   lib/vfs - benchmark vfs_parse_mlsx() and vfs_parse_ls_lga()
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+   This program is not a part of the test suite: build it with
+   "make vfs_parse_benchmark" and run it by hand. An optional argument
+   sets the number of passes over the recorded listings.
+ */
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/global.h"
+#include "lib/vfs/utilvfs.h"
+
+/* default number of passes over the recorded listings */
+#define BENCHMARK_PASSES 2000
+
+typedef gboolean (*parse_fn) (const char *line, struct stat * st, char **filename,
+                              char **linkname);
+
+void message (int flags, const char *title, const char *text, ...);
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    char *p;
+    va_list ap;
+
+    (void) flags;
+    (void) title;
+
+    va_start (ap, text);
+    p = g_strdup_vprintf (text, ap);
+    va_end (ap);
+    printf ("message(): %s\n", p);
+    g_free (p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+parse_mlsx (const char *line, struct stat * st, char **filename, char **linkname)
+{
+    return vfs_parse_mlsx (line, st, filename, linkname);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+parse_ls_lga (const char *line, struct stat * st, char **filename, char **linkname)
+{
+    size_t num_spaces;
+
+    return line[0] != '\0' && vfs_parse_ls_lga (line, st, filename, linkname, &num_spaces);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+run (const char *name, const char *listing, parse_fn parse, int passes)
+{
+    char *file_name, *data;
+    char **lines;
+    GTimer *timer;
+    int pass, count = 0;
+    size_t i;
+
+    file_name = g_build_filename (TEST_SHARE_DIR, listing, (char *) NULL);
+    if (!g_file_get_contents (file_name, &data, NULL, NULL))
+    {
+        fprintf (stderr, "Cannot read recorded listing %s\n", file_name);
+        g_free (file_name);
+        return FALSE;
+    }
+    g_free (file_name);
+
+    lines = g_strsplit (data, "\n", -1);
+    g_free (data);
+
+    vfs_parse_ls_lga_init ();
+    timer = g_timer_new ();
+
+    for (pass = 0; pass < passes; pass++)
+        for (i = 0; lines[i] != NULL; i++)
+        {
+            struct stat st;
+            char *filename = NULL;
+            char *linkname = NULL;
+
+            if (parse (lines[i], &st, &filename, &linkname))
+                count++;
+            g_free (filename);
+            g_free (linkname);
+        }
+
+    printf ("%-17s %d entries in %.3f s\n", name, count, g_timer_elapsed (timer, NULL));
+
+    g_timer_destroy (timer);
+    g_strfreev (lines);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    int passes = BENCHMARK_PASSES;
+    gboolean ok;
+
+    if (argc > 1)
+        passes = atoi (argv[1]);
+    if (passes <= 0)
+        passes = BENCHMARK_PASSES;
+
+    ok = run ("vfs_parse_mlsx:", "mlsd_listing.txt", parse_mlsx, passes);
+    ok = run ("vfs_parse_ls_lga:", "list_listing.txt", parse_ls_lga, passes) && ok;
+
+    return ok ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,180 @@
+/*
+   lib/vfs - fuzz vfs_parse_ls_lga()
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "lib/global.h"
+#include "lib/vfs/utilvfs.h"
+
+/* fixed seed: failures must be reproducible */
+#define FUZZ_SEED 20111019
+#define FUZZ_ITERATIONS 200000
+
+void message (int flags, const char *title, const char *text, ...);
+
+static const char *fuzz_seeds[] = {
+    "drwxrwxr-x   10 500      500          4096 Jun 23 17:09 build_root",
+    "lrwxrwxrwx    1 500      500            11 Mar 13  2010 COPYING -> doc/COPYING",
+    "drwxrwxr-x      10   500        500             4096   Jun   23   17:09   build_root 0",
+    "crw-rw----    1 root     tty        4,  64 Jun 23 17:09 ttyS0",
+    "brw-rw----    1 root     disk       8,0 Jun 23 17:09 sda",
+    "-rw-r--r--    1 user     group      1234 Thu Jun 23 17:09:11 2011 extfs",
+    "-rw-r--r--    1 user               1234 Jun 23  2011 nogroup",
+    "-rw-r--r--    1 user     group      1234 06-23-2011 17:09:33 dosdate",
+    "-rw-r--r--    2 user     group      1234 Jun 23 17:09 hard -> link",
+    "-rw-r--r-- [RWCEAFMS] user     1234 Jun 23 17:09 netware",
+    "-rw-r--r--    1 user     group      1234 Jun 23 17:09 crlf\r\n",
+    NULL
+};
+
+/* characters which are significant for the parser */
+static const char fuzz_chars[] = " \r\n-:/\\>,0123456789JanFebDecThurwxdlcb[]";
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    (void) flags;
+    (void) title;
+    (void) text;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+fuzz_mutate (GRand * rand, GString * line)
+{
+    int i, n;
+
+    n = g_rand_int_range (rand, 1, 5);
+    for (i = 0; i < n; i++)
+    {
+        gsize pos;
+        char c;
+
+        pos = line->len == 0 ? 0 : (gsize) g_rand_int_range (rand, 0, line->len);
+        c = fuzz_chars[g_rand_int_range (rand, 0, sizeof (fuzz_chars) - 1)];
+
+        switch (g_rand_int_range (rand, 0, 4))
+        {
+        case 0:
+            if (line->len != 0)
+                g_string_erase (line, pos, 1);
+            break;
+        case 1:
+            g_string_insert_c (line, pos, c);
+            break;
+        case 2:
+            if (line->len != 0)
+                line->str[pos] = c;
+            break;
+        default:
+            g_string_truncate (line, pos);
+            break;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Parse the randomly damaged lines. The parser must not crash, and the name
+ * of successfully parsed entry must be taken from the line.
+ */
+
+START_TEST (test_vfs_parse_ls_lga_fuzz)
+{
+    GRand *rand;
+    GString *line;
+    int i;
+    size_t num_seeds;
+
+    for (num_seeds = 0; fuzz_seeds[num_seeds] != NULL; num_seeds++)
+        ;
+
+    rand = g_rand_new_with_seed (FUZZ_SEED);
+    line = g_string_sized_new (BUF_SMALL);
+
+    vfs_parse_ls_lga_init ();
+
+    for (i = 0; i < FUZZ_ITERATIONS; i++)
+    {
+        struct stat st;
+        char *filename = NULL;
+        char *linkname = NULL;
+        size_t num_spaces = 0;
+
+        g_string_assign (line, fuzz_seeds[g_rand_int_range (rand, 0, num_seeds)]);
+        fuzz_mutate (rand, line);
+
+        memset (&st, 0, sizeof (st));
+        if (vfs_parse_ls_lga (line->str, &st, &filename, &linkname, &num_spaces))
+        {
+            fail_unless (filename != NULL, "\nno file name for '%s'", line->str);
+            fail_unless (strstr (line->str, filename) != NULL,
+                         "\nfile name '%s' is not from '%s'", filename, line->str);
+            fail_unless (linkname == NULL || strstr (line->str, linkname) != NULL,
+                         "\nlink name '%s' is not from '%s'", linkname, line->str);
+            fail_unless (num_spaces < line->len, "\nwrong number of spaces for '%s'", line->str);
+        }
+
+        g_free (filename);
+        g_free (linkname);
+    }
+
+    g_string_free (line, TRUE);
+    g_rand_free (rand);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* fuzzing takes a while */
+    tcase_set_timeout (tc_core, 60);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_vfs_parse_ls_lga_fuzz);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_parse_ls_lga_fuzz.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
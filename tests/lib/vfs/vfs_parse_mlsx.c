@@ -0,0 +1,193 @@
+/*
+   lib/vfs - test vfs_parse_mlsx() functionality
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include <config.h>
+
+#include <check.h>
+#include <stdio.h>
+
+#include "lib/global.h"
+#include "lib/vfs/utilvfs.h"
+
+void message (int flags, const char *title, const char *text, ...);
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    char *p;
+    va_list ap;
+
+    (void) flags;
+    (void) title;
+
+    va_start (ap, text);
+    p = g_strdup_vprintf (text, ap);
+    va_end (ap);
+    printf ("message(): %s\n", p);
+    g_free (p);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char **
+read_listing (const char *name)
+{
+    char *file_name, *data;
+    char **lines;
+
+    file_name = g_build_filename (TEST_SHARE_DIR, name, (char *) NULL);
+    if (!g_file_get_contents (file_name, &data, NULL, NULL))
+        fail ("Cannot read recorded listing %s", file_name);
+    g_free (file_name);
+
+    lines = g_strsplit (data, "\n", -1);
+    g_free (data);
+    return lines;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_vfs_parse_mlsx)
+{
+    struct stat st;
+    char *filename = NULL;
+    char *linkname = NULL;
+
+    memset (&st, 0, sizeof (st));
+    fail_unless (vfs_parse_mlsx
+                 ("type=dir;sizd=4096;modify=20110623170900;UNIX.mode=0775;unix.uid=500;"
+                  "unix.gid=501; build_root\r\n", &st, &filename, &linkname));
+    fail_unless (strcmp (filename, "build_root") == 0, "\nactual filename '%s'", filename);
+    fail_unless (linkname == NULL);
+    fail_unless (st.st_mode == (S_IFDIR | 0775), "\nactual mode %04o", (int) st.st_mode);
+    fail_unless (st.st_uid == 500 && st.st_gid == 501);
+    fail_unless (st.st_size == 4096);
+    /* MLSx time is UTC: no dependence on time zone */
+    fail_unless (st.st_mtime == 1308848940, "\nactual mtime %ld", (long) st.st_mtime);
+    g_free (filename);
+
+    /* name with spaces and semicolons, mode from "perm" fact */
+    memset (&st, 0, sizeof (st));
+    fail_unless (vfs_parse_mlsx ("Type=file;Size=123;Perm=rw; a b;c", &st, &filename, &linkname));
+    fail_unless (strcmp (filename, "a b;c") == 0, "\nactual filename '%s'", filename);
+    fail_unless (st.st_mode == (S_IFREG | S_IRUSR | S_IWUSR), "\nactual mode %04o",
+                 (int) st.st_mode);
+    fail_unless (st.st_size == 123);
+    g_free (filename);
+
+    /* symlink */
+    memset (&st, 0, sizeof (st));
+    fail_unless (vfs_parse_mlsx ("type=OS.unix=slink:doc/NEWS;unix.mode=0777; NEWS", &st,
+                                 &filename, &linkname));
+    fail_unless (strcmp (filename, "NEWS") == 0, "\nactual filename '%s'", filename);
+    fail_unless (linkname != NULL && strcmp (linkname, "doc/NEWS") == 0,
+                 "\nactual linkname '%s'", linkname);
+    fail_unless (S_ISLNK (st.st_mode));
+    g_free (filename);
+    g_free (linkname);
+
+    /* current and parent directories are skipped */
+    fail_if (vfs_parse_mlsx ("type=cdir;modify=20110623170900; .", &st, NULL, NULL));
+    fail_if (vfs_parse_mlsx ("type=pdir;modify=20110623170900; ..", &st, NULL, NULL));
+    /* malformed lines */
+    fail_if (vfs_parse_mlsx ("type=file;size=1;", &st, NULL, NULL));
+    fail_if (vfs_parse_mlsx ("type=file;size=1; ", &st, NULL, NULL));
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+/** Parse the same directory recorded as MLSD and as LIST output: both parsers must agree */
+
+START_TEST (test_vfs_parse_mlsx_list)
+{
+    char **mlsd, **list;
+    size_t i, j;
+
+    mlsd = read_listing ("mlsd_listing.txt");
+    list = read_listing ("list_listing.txt");
+
+    vfs_parse_ls_lga_init ();
+
+    /* entries must be the same, except "." and ".." which are not returned by vfs_parse_mlsx */
+    for (i = 0, j = 0; mlsd[i] != NULL && mlsd[i][0] != '\0'; i++)
+    {
+        struct stat st1, st2;
+        char *name1 = NULL, *name2 = NULL;
+
+        memset (&st1, 0, sizeof (st1));
+        if (!vfs_parse_mlsx (mlsd[i], &st1, &name1, NULL))
+            continue;
+
+        do
+        {
+            g_free (name2);
+            name2 = NULL;
+            fail_if (list[j] == NULL || list[j][0] == '\0', "\nno LIST entry for %s", name1);
+            memset (&st2, 0, sizeof (st2));
+        }
+        while (!vfs_parse_ls_lga (list[j++], &st2, &name2, NULL, NULL)
+               || strcmp (name2, ".") == 0 || strcmp (name2, "..") == 0);
+
+        fail_unless (strcmp (name1, name2) == 0, "\nMLSD '%s' LIST '%s'", name1, name2);
+        fail_unless (st1.st_mode == st2.st_mode, "\n%s: MLSD mode %04o LIST mode %04o", name1,
+                     (int) st1.st_mode, (int) st2.st_mode);
+        fail_unless (st1.st_size == st2.st_size, "\n%s: MLSD size %lld LIST size %lld", name1,
+                     (long long) st1.st_size, (long long) st2.st_size);
+        g_free (name1);
+        g_free (name2);
+    }
+
+    g_strfreev (mlsd);
+    g_strfreev (list);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_vfs_parse_mlsx);
+    tcase_add_test (tc_core, test_vfs_parse_mlsx_list);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_parse_mlsx.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
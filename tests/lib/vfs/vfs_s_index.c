@@ -0,0 +1,200 @@
+/*
+   lib/vfs - test compact index of archive entries
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/lib/vfs"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/vfs/direntry.c"   /* for testing static methods  */
+
+#include "src/vfs/local/local.c"
+
+struct vfs_s_subclass test_subclass;
+struct vfs_class vfs_test_ops;
+
+static struct vfs_s_super *super;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    init_localfs ();
+    vfs_setup_work_dir ();
+
+    vfs_s_init_class (&vfs_test_ops, &test_subclass);
+    vfs_test_ops.name = "testfs";
+    vfs_test_ops.prefix = "test:";
+    vfs_register_class (&vfs_test_ops);
+
+    super = vfs_s_new_super (&vfs_test_ops);
+    super->name = g_strdup ("/test.tar");
+    super->root = vfs_s_new_inode (&vfs_test_ops, super,
+                                   vfs_s_default_stat (&vfs_test_ops, S_IFDIR | 0755));
+    vfs_s_index_init (super);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+teardown (void)
+{
+    vfs_s_free_super (&vfs_test_ops, super);
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+vfs_die (const char *m)
+{
+    printf ("VFS_DIE: '%s'\n", m);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+add_file (const char *path, off_t data_offset)
+{
+    struct stat *st;
+
+    st = vfs_s_default_stat (&vfs_test_ops, S_IFREG | 0644);
+    st->st_size = 10;
+    fail_if (vfs_s_index_add (&vfs_test_ops, super, path, st, NULL, data_offset) == 0,
+             "\n%s is not added", path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_vfs_s_index_expand)
+{
+    struct vfs_s_inode *ino, *dir;
+    struct vfs_s_entry *ent;
+    struct stat *st;
+    guint32 num;
+
+    add_file ("a/b/c.txt", 100);
+    add_file ("./a/b/d.txt", 200);
+    add_file ("e.txt", 300);
+    /* directory after its contents */
+    st = vfs_s_default_stat (&vfs_test_ops, S_IFDIR | 0700);
+    fail_if (vfs_s_index_add (&vfs_test_ops, super, "a/b/", st, NULL, 0) == 0);
+    /* these are skipped */
+    fail_unless (vfs_s_index_add (&vfs_test_ops, super, ".", st, NULL, 0) == 0);
+    fail_unless (vfs_s_index_add (&vfs_test_ops, super, "../x", st, NULL, 0) == 0);
+
+    num = vfs_s_index_lookup (&vfs_test_ops, super, "a/b/c.txt");
+    fail_if (num == 0);
+    fail_if (vfs_s_index_add_link (&vfs_test_ops, super, "z/hard", num) == 0);
+    fail_unless (vfs_s_index_lookup (&vfs_test_ops, super, "a/b/c.txt/x") == 0);
+
+    vfs_s_index_finish (&vfs_test_ops, super);
+
+    /* only the root directory is expanded */
+    fail_unless (g_list_length (super->root->subdir) == 3);
+    ent = (struct vfs_s_entry *) super->root->subdir->data;
+    fail_unless (strcmp (ent->name, "a") == 0, "\nactual name '%s'", ent->name);
+    fail_unless (ent->ino->subdir == NULL);
+    fail_unless (ent->ino->index_dir != 0);
+
+    ino = vfs_s_find_inode (&vfs_test_ops, super, "a/b/d.txt", LINK_NO_FOLLOW, FL_NONE);
+    fail_if (ino == NULL);
+    fail_unless (ino->data_offset == 200, "\nactual offset %lld", (long long) ino->data_offset);
+    fail_unless (ino->st.st_size == 10);
+
+    dir = vfs_s_find_inode (&vfs_test_ops, super, "a/b", LINK_NO_FOLLOW, FL_DIR);
+    fail_if (dir == NULL);
+    fail_unless (dir->st.st_mode == (S_IFDIR | 0700), "\nactual mode %o", (int) dir->st.st_mode);
+    fail_unless (g_list_length (dir->subdir) == 2);
+
+    /* hard link shares the inode */
+    ino = vfs_s_find_inode (&vfs_test_ops, super, "a/b/c.txt", LINK_NO_FOLLOW, FL_NONE);
+    fail_unless (vfs_s_find_inode (&vfs_test_ops, super, "z/hard", LINK_NO_FOLLOW, FL_NONE) == ino);
+    fail_unless (ino->st.st_nlink == 2);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_vfs_s_index_many)
+{
+    char name[BUF_SMALL];
+    int i;
+
+    for (i = 0; i < 10000; i++)
+    {
+        g_snprintf (name, sizeof (name), "dir%d/file%d", i % 7, i);
+        add_file (name, i);
+    }
+
+    for (i = 0; i < 10000; i++)
+    {
+        guint32 num;
+
+        g_snprintf (name, sizeof (name), "dir%d/file%d", i % 7, i);
+        num = vfs_s_index_lookup (&vfs_test_ops, super, name);
+        fail_if (num == 0, "\n%s is not found", name);
+        fail_unless (vfs_s_index_get (super, num)->offset == i);
+    }
+
+    vfs_s_index_finish (&vfs_test_ops, super);
+
+    fail_unless (g_list_length (super->root->subdir) == 7);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_vfs_s_index_expand);
+    tcase_add_test (tc_core, test_vfs_s_index_many);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "vfs_s_index.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,164 @@
+/*
+   lib/widget - test virtual mode of WListbox
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/lib/widget"
+
+#include <config.h>
+
+#include <check.h>
+#include <stdio.h>
+
+#include "lib/global.h"
+#include "lib/widget.h"
+
+/* number of items supplied by the owner: the listbox must not store them */
+#define ITEMS_COUNT 1000000
+
+static char item_buffer[BUF_TINY];
+static int item_requests;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const char *
+get_item (WListbox * l, int index)
+{
+    (void) l;
+
+    item_requests++;
+    g_snprintf (item_buffer, sizeof (item_buffer), "item %d", index);
+    return item_buffer;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static WListbox *
+test_listbox_new (void)
+{
+    return listbox_new (0, 0, 10, 20, FALSE, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_listbox_free (WListbox * l)
+{
+    send_message (&l->widget, WIDGET_DESTROY, 0);
+    g_free (l);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_listbox_virtual_items)
+{
+    WListbox *l;
+    char *text = NULL;
+    void *data = (void *) &text;
+
+    l = test_listbox_new ();
+    listbox_set_virtual (l, ITEMS_COUNT, get_item);
+
+    fail_unless (l->count == ITEMS_COUNT, "\nactual count %d", l->count);
+    fail_unless (l->list->len == 0, "\nvirtual listbox stores %u entries", l->list->len);
+
+    /* only the requested item is built */
+    item_requests = 0;
+    listbox_select_last (l);
+    listbox_get_current (l, &text, &data);
+    fail_unless (strcmp (text, "item 999999") == 0, "\nactual text '%s'", text);
+    fail_unless (data == NULL);
+    fail_unless (item_requests == 1, "\nactual number of requests %d", item_requests);
+
+    listbox_select_entry (l, 12345);
+    listbox_get_current (l, &text, NULL);
+    fail_unless (strcmp (text, "item 12345") == 0, "\nactual text '%s'", text);
+
+    fail_unless (listbox_search_text (l, "item 4321") == 4321);
+
+    /* entries can't be added to the virtual listbox */
+    fail_unless (listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, "extra", NULL) == NULL);
+    fail_unless (l->count == ITEMS_COUNT);
+
+    test_listbox_free (l);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_listbox_virtual_count_changes)
+{
+    WListbox *l;
+    char *text = NULL;
+
+    l = test_listbox_new ();
+
+    /* the owner appends items while the list is shown */
+    listbox_set_virtual (l, 0, get_item);
+    listbox_get_current (l, &text, NULL);
+    fail_unless (text == NULL);
+
+    listbox_set_virtual (l, 100, get_item);
+    listbox_select_entry (l, 50);
+    listbox_set_virtual (l, 200, get_item);
+    fail_unless (l->pos == 50, "\nactual pos %d", l->pos);
+
+    /* current item is kept inside the list when it shrinks */
+    listbox_set_virtual (l, 20, get_item);
+    fail_unless (l->pos == 19, "\nactual pos %d", l->pos);
+    fail_unless (l->top <= l->pos);
+
+    /* back to normal mode */
+    listbox_remove_list (l);
+    fail_unless (l->count == 0 && l->get_item == NULL);
+    fail_unless (listbox_add_item (l, LISTBOX_APPEND_AT_END, 0, "entry", NULL) != NULL);
+    listbox_get_current (l, &text, NULL);
+    fail_unless (strcmp (text, "entry") == 0, "\nactual text '%s'", text);
+
+    test_listbox_free (l);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_listbox_virtual_items);
+    tcase_add_test (tc_core, test_listbox_virtual_count_changes);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "listbox_virtual.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,379 @@
+/*
+   src/viewer - test backward search
+
+   Copyright (C) 2011
+   The Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define TEST_SUITE_NAME "/src/viewer"
+
+#include <config.h>
+
+#include <check.h>
+
+#include "src/viewer/search.c"  /* for testing static functions */
+
+/* --------------------------------------------------------------------------------------------- */
+/* stubs of the viewer and the user interface: the text is viewed as DS_STRING */
+
+int verbose = 0;
+mcview_search_options_t mcview_search_options;
+
+static mcview_t test_view;
+static mcview_nroff_t test_nroff;
+
+gboolean
+mcview_get_byte_string (mcview_t * view, off_t byte_index, int *retval)
+{
+    if (byte_index >= 0 && byte_index < (off_t) view->ds_string_len)
+    {
+        if (retval)
+            *retval = view->ds_string_data[byte_index];
+        return TRUE;
+    }
+    if (retval)
+        *retval = -1;
+    return FALSE;
+}
+
+gboolean
+mcview_get_byte_none (mcview_t * view, off_t byte_index, int *retval)
+{
+    (void) view;
+    (void) byte_index;
+    if (retval)
+        *retval = -1;
+    return FALSE;
+}
+
+gboolean
+mcview_get_byte_growing_buffer (mcview_t * view, off_t p, int *retval)
+{
+    return mcview_get_byte_none (view, p, retval);
+}
+
+void
+mcview_file_load_data (mcview_t * view, off_t byte_index)
+{
+    (void) view;
+    (void) byte_index;
+}
+
+off_t
+mcview_get_filesize (mcview_t * view)
+{
+    return (off_t) view->ds_string_len;
+}
+
+off_t
+mcview_growbuf_filesize (mcview_t * view)
+{
+    return mcview_get_filesize (view);
+}
+
+off_t
+mcview_eol (mcview_t * view, off_t current, off_t limit)
+{
+    int c;
+
+    while (current < limit && mcview_get_byte (view, current, &c))
+    {
+        current++;
+        if (c == '\n')
+            break;
+    }
+    return current;
+}
+
+nroff_type_t
+mcview_nroff_seq_info (mcview_nroff_t * nroff)
+{
+    (void) nroff;
+    return NROFF_TYPE_NONE;
+}
+
+int
+mcview_nroff_seq_next (mcview_nroff_t * nroff)
+{
+    (void) nroff;
+    return 0;
+}
+
+int
+mcview_nroff_seq_prev (mcview_nroff_t * nroff)
+{
+    (void) nroff;
+    return -1;
+}
+
+mcview_nroff_t *
+mcview_nroff_seq_new_num (mcview_t * view, off_t p)
+{
+    (void) view;
+    (void) p;
+    return NULL;
+}
+
+void
+mcview_nroff_seq_free (mcview_nroff_t ** nroff)
+{
+    (void) nroff;
+}
+
+int
+mcview__get_nroff_real_len (mcview_t * view, off_t start, off_t length)
+{
+    (void) view;
+    (void) start;
+    (void) length;
+    return 0;
+}
+
+void
+mcview_moveto_match (mcview_t * view)
+{
+    (void) view;
+}
+
+void
+mcview_update (mcview_t * view)
+{
+    (void) view;
+}
+
+void
+mcview_percent (mcview_t * view, off_t p)
+{
+    (void) view;
+    (void) p;
+}
+
+void
+tty_refresh (void)
+{
+}
+
+void
+tty_enable_interrupt_key (void)
+{
+}
+
+void
+tty_disable_interrupt_key (void)
+{
+}
+
+gboolean
+tty_got_interrupt (void)
+{
+    return FALSE;
+}
+
+struct Dlg_head *
+create_message (int flags, const char *title, const char *text, ...)
+{
+    (void) flags;
+    (void) title;
+    (void) text;
+    return NULL;
+}
+
+void
+message (int flags, const char *title, const char *text, ...)
+{
+    (void) flags;
+    (void) title;
+    (void) text;
+}
+
+int
+query_dialog (const char *header, const char *text, int flags, int count, ...)
+{
+    (void) header;
+    (void) text;
+    (void) flags;
+    (void) count;
+    return 0;
+}
+
+void
+dlg_run_done (Dlg_head * h)
+{
+    (void) h;
+}
+
+void
+destroy_dlg (Dlg_head * h)
+{
+    (void) h;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+teardown (void)
+{
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_view_init (const char *text, size_t text_len, const char *pattern, mc_search_type_t type)
+{
+    memset (&test_view, 0, sizeof (test_view));
+    memset (&test_nroff, 0, sizeof (test_nroff));
+
+    test_view.datasource = DS_STRING;
+    test_view.ds_string_data = (byte *) g_strndup (text, text_len);
+    test_view.ds_string_len = text_len;
+    test_nroff.view = &test_view;
+    test_view.search_nroff_seq = &test_nroff;
+
+    test_view.search = mc_search_new (pattern, -1);
+    test_view.search->search_type = type;
+    test_view.search->is_case_sensitive = TRUE;
+    test_view.search->search_fn = mcview_search_cmd_callback;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+test_view_deinit (void)
+{
+    mc_search_free (test_view.search);
+    g_free (test_view.ds_string_data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_find_backward_overlapping)
+{
+    gsize len = 0;
+
+    /* the last match starts at 1, not at 0 */
+    test_view_init ("aaa", 3, "aa", MC_SEARCH_T_NORMAL);
+    fail_unless (mcview_find_backward (&test_view, 2, &len));
+    fail_unless (test_view.search->normal_offset == 1,
+                 "\nactual offset %ld", (long) test_view.search->normal_offset);
+    fail_unless (len == 2, "\nactual length %lu", (unsigned long) len);
+    test_view_deinit ();
+
+    test_view_init ("abababa", 7, "aba", MC_SEARCH_T_NORMAL);
+    fail_unless (mcview_find_backward (&test_view, 6, &len));
+    fail_unless (test_view.search->normal_offset == 4,
+                 "\nactual offset %ld", (long) test_view.search->normal_offset);
+    fail_unless (mcview_find_backward (&test_view, 3, &len));
+    fail_unless (test_view.search->normal_offset == 2,
+                 "\nactual offset %ld", (long) test_view.search->normal_offset);
+    test_view_deinit ();
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_find_backward_window_boundary)
+{
+    const size_t text_len = 2 * MCVIEW_SEARCH_WINDOW + 10;
+    /* the first window scanned is [text_len - MCVIEW_SEARCH_WINDOW; text_len - 1] */
+    const size_t needle_offset = text_len - MCVIEW_SEARCH_WINDOW - 3;
+    char *text;
+    gsize len = 0;
+
+    text = g_strnfill (text_len, 'x');
+    memcpy (text + needle_offset, "needle", 6);
+
+    test_view_init (text, text_len, "needle", MC_SEARCH_T_NORMAL);
+    fail_unless (mcview_find_backward (&test_view, text_len - 1, &len));
+    fail_unless (test_view.search->normal_offset == (off_t) needle_offset,
+                 "\nactual offset %ld", (long) test_view.search->normal_offset);
+    fail_unless (len == 6, "\nactual length %lu", (unsigned long) len);
+    test_view_deinit ();
+
+    g_free (text);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+START_TEST (test_find_backward_long_match)
+{
+    /* the match is much longer than MCVIEW_SEARCH_MAX_MATCH */
+    const size_t text_len = 3 * MCVIEW_SEARCH_MAX_MATCH + 2;
+    char *text;
+    gsize backward_len = 0, forward_len = 0;
+
+    text = g_strnfill (text_len, 'a');
+    text[0] = 'b';
+    text[text_len - 1] = '\n';
+
+    test_view_init (text, text_len, "ba+", MC_SEARCH_T_REGEX);
+
+    fail_unless (mcview_find_run (&test_view, 0, text_len, &forward_len));
+    fail_unless (test_view.search->normal_offset == 0);
+
+    fail_unless (mcview_find_backward (&test_view, 0, &backward_len));
+    fail_unless (test_view.search->normal_offset == 0,
+                 "\nactual offset %ld", (long) test_view.search->normal_offset);
+    fail_unless (backward_len == forward_len, "\nbackward length %lu, forward length %lu",
+                 (unsigned long) backward_len, (unsigned long) forward_len);
+    fail_unless (backward_len == text_len - 1, "\nactual length %lu",
+                 (unsigned long) backward_len);
+
+    test_view_deinit ();
+    g_free (text);
+}
+END_TEST
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    int number_failed;
+
+    Suite *s = suite_create (TEST_SUITE_NAME);
+    TCase *tc_core = tcase_create ("Core");
+    SRunner *sr;
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_find_backward_overlapping);
+    tcase_add_test (tc_core, test_find_backward_window_boundary);
+    tcase_add_test (tc_core, test_find_backward_long_match);
+    /* *********************************** */
+
+    suite_add_tcase (s, tc_core);
+    sr = srunner_create (s);
+    srunner_set_log (sr, "mcview_find_backward.log");
+    srunner_run_all (sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed (sr);
+    srunner_free (sr);
+    return (number_failed == 0) ? 0 : 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */